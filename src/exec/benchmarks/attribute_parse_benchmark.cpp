@@ -0,0 +1,139 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "benchmark_util.hpp"
+
+// project
+#include "gvs/util/attribute_view.hpp"
+
+// generated
+#include <types.pb.h>
+
+// standard
+#include <iostream>
+#include <numeric>
+
+/*
+ * Measures how quickly geometry can be parsed and made available as a contiguous float buffer
+ * (what the viewer uploads to OpenGL) using the repeated 'value' fields vs. the raw 'data' bytes.
+ *
+ * usage: gvs_attribute_parse_benchmark [num_floats] [iterations]
+ */
+namespace {
+
+template <typename List, typename T>
+void set_values(List* list, const std::vector<T>& values, bool raw_bytes) {
+    if (raw_bytes) {
+        list->set_data(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    } else {
+        *list->mutable_value() = {values.begin(), values.end()};
+    }
+}
+
+std::string serialized_positions(const std::vector<float>& values, bool raw_bytes) {
+    gvs::proto::GeometryInfo3D geometry;
+    set_values(geometry.mutable_positions(), values, raw_bytes);
+    return geometry.SerializeAsString();
+}
+
+std::string serialized_indices(const std::vector<unsigned>& values, bool raw_bytes) {
+    gvs::proto::GeometryInfo3D geometry;
+    set_values(geometry.mutable_indices(), values, raw_bytes);
+    return geometry.SerializeAsString();
+}
+
+template <typename Consume>
+void benchmark_parse(const std::string& name, const std::string& serialized, std::size_t iterations, Consume consume) {
+    float checksum = 0.f;
+
+    gvs::bench::AllocationCounter allocations;
+    auto samples = gvs::bench::time_each(iterations, [&](std::size_t) {
+        gvs::proto::GeometryInfo3D geometry;
+        if (not geometry.ParseFromString(serialized)) {
+            std::cerr << "Failed to parse geometry" << std::endl;
+        }
+        checksum += static_cast<float>(consume(geometry));
+    });
+    gvs::bench::print_row(name, allocations, samples);
+
+    double mean_seconds = gvs::bench::summarize(samples).mean_us * 1e-6;
+    std::printf("%-40s %12.1f MB/s\n", "", static_cast<double>(serialized.size()) / (1024.0 * 1024.0) / mean_seconds);
+
+    // Keeps the work above from being optimized away
+    if (checksum == 0.f) {
+        std::cerr << "Unexpected empty geometry" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t num_floats = 3'000'000;
+    std::size_t iterations = 50;
+
+    if (argc > 1) {
+        num_floats = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        iterations = std::stoul(argv[2]);
+    }
+
+    std::vector<float> values(num_floats);
+    std::iota(values.begin(), values.end(), 1.f);
+
+    // Typical mesh indices are large enough to need several bytes each as varints
+    std::vector<unsigned> indices(num_floats);
+    std::iota(indices.begin(), indices.end(), 1u << 21u);
+
+    std::cout << iterations << " iterations, " << num_floats << " values ("
+              << static_cast<double>(num_floats * sizeof(float)) / (1024.0 * 1024.0) << " MB) per message\n"
+              << std::endl;
+
+    gvs::bench::print_header();
+
+    auto first_position = [](const gvs::proto::GeometryInfo3D& geometry) {
+        return gvs::util::attribute_view(geometry.positions())[0];
+    };
+    auto first_index = [](const gvs::proto::GeometryInfo3D& geometry) {
+        return gvs::util::attribute_view(geometry.indices())[0];
+    };
+
+    const std::string repeated_positions = serialized_positions(values, false);
+    const std::string raw_positions = serialized_positions(values, true);
+
+    // The previous viewer path: parse followed by a copy into a std::vector
+    benchmark_parse("repeated floats: parse + copy", repeated_positions, iterations, [](const auto& geometry) {
+        const auto& positions = geometry.positions().value();
+        std::vector<float> buffer_data(positions.begin(), positions.end());
+        return buffer_data.front();
+    });
+    benchmark_parse("repeated floats: parse + view", repeated_positions, iterations, first_position);
+    benchmark_parse("raw float bytes: parse + view", raw_positions, iterations, first_position);
+
+    const std::string repeated_indices = serialized_indices(indices, false);
+    const std::string raw_indices = serialized_indices(indices, true);
+
+    benchmark_parse("repeated uints: parse + view", repeated_indices, iterations, first_index);
+    benchmark_parse("raw uint bytes: parse + view", raw_indices, iterations, first_index);
+
+    return 0;
+}
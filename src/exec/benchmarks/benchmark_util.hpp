@@ -0,0 +1,176 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+/*
+ * Small helpers shared by the benchmark executables.
+ *
+ * This header replaces the global allocation functions so it must only be
+ * included by a single source file in each executable.
+ */
+
+// standard
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace gvs::bench {
+
+inline std::atomic<std::size_t>& allocation_count() {
+    static std::atomic<std::size_t> count{0};
+    return count;
+}
+
+inline std::atomic<std::size_t>& allocated_bytes() {
+    static std::atomic<std::size_t> bytes{0};
+    return bytes;
+}
+
+/// \brief Counts the heap allocations made between construction and 'count()'/'bytes()'
+class AllocationCounter {
+public:
+    AllocationCounter() : start_count_(allocation_count().load()), start_bytes_(allocated_bytes().load()) {}
+
+    std::size_t count() const { return allocation_count().load() - start_count_; }
+    std::size_t bytes() const { return allocated_bytes().load() - start_bytes_; }
+
+private:
+    std::size_t start_count_;
+    std::size_t start_bytes_;
+};
+
+struct LatencyStats {
+    double mean_us = 0.0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+};
+
+inline LatencyStats summarize(std::vector<double> samples_us) {
+    LatencyStats stats;
+    if (samples_us.empty()) {
+        return stats;
+    }
+
+    std::sort(samples_us.begin(), samples_us.end());
+
+    auto percentile = [&](double p) {
+        auto index = static_cast<std::size_t>(p * static_cast<double>(samples_us.size() - 1));
+        return samples_us[index];
+    };
+
+    for (double sample : samples_us) {
+        stats.mean_us += sample;
+    }
+    stats.mean_us /= static_cast<double>(samples_us.size());
+    stats.p50_us = percentile(0.5);
+    stats.p90_us = percentile(0.9);
+    stats.p99_us = percentile(0.99);
+    return stats;
+}
+
+/// \brief Runs 'func' 'iterations' times and returns the latency of each call in microseconds
+template <typename Func>
+std::vector<double> time_each(std::size_t iterations, Func&& func) {
+    std::vector<double> samples_us;
+    samples_us.reserve(iterations);
+
+    for (std::size_t i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        func(i);
+        auto end = std::chrono::steady_clock::now();
+        samples_us.emplace_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    return samples_us;
+}
+
+inline void print_header() {
+    std::printf("%-40s %12s %12s %10s %10s %10s %10s\n",
+                "benchmark",
+                "allocs/iter",
+                "MB/iter",
+                "mean(us)",
+                "p50(us)",
+                "p90(us)",
+                "p99(us)");
+}
+
+/// \brief Prints the total allocations made over all the samples and the latency of each sample
+inline void print_row(const std::string& name,
+                      std::size_t allocations,
+                      std::size_t allocated_bytes,
+                      const std::vector<double>& samples_us) {
+    auto iterations = static_cast<double>(std::max(samples_us.size(), std::size_t(1)));
+    LatencyStats stats = summarize(samples_us);
+
+    std::printf("%-40s %12.1f %12.2f %10.2f %10.2f %10.2f %10.2f\n",
+                name.c_str(),
+                static_cast<double>(allocations) / iterations,
+                static_cast<double>(allocated_bytes) / iterations / (1024.0 * 1024.0),
+                stats.mean_us,
+                stats.p50_us,
+                stats.p90_us,
+                stats.p99_us);
+}
+
+/// \brief Prints the allocations made since 'allocations' was created and the latency of each sample
+inline void print_row(const std::string& name,
+                      const AllocationCounter& allocations,
+                      const std::vector<double>& samples_us) {
+    print_row(name, allocations.count(), allocations.bytes(), samples_us);
+}
+
+} // namespace gvs::bench
+
+// GCC doesn't recognize these as replacements of the global functions and warns about pairing malloc with free
+#if defined(__GNUC__) && not defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    ++gvs::bench::allocation_count();
+    gvs::bench::allocated_bytes() += size;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && not defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
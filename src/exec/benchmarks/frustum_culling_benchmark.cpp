@@ -0,0 +1,167 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "benchmark_util.hpp"
+
+// project
+#include "gvs/vis-client/scene/bounded_drawable.hpp"
+#include "gvs/vis-client/scene/general_shader_3d.hpp"
+
+// external
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Object.h>
+#include <Magnum/SceneGraph/Scene.h>
+
+// standard
+#include <iostream>
+#include <random>
+
+/*
+ * Measures the CPU side of a frame in a scene where most items are off-screen:
+ *
+ *  1. Drawing every item (the viewer's behaviour before culling)
+ *  2. Culling items against the view frustum before drawing
+ *  3. Culling while a fraction of the items move every frame (their world bounds are recomputed)
+ *
+ * Drawables update their uniforms the same way the viewer does (only when they move) but don't
+ * issue any OpenGL calls so no context is needed.
+ *
+ * usage: gvs_frustum_culling_benchmark [num_items] [num_frames] [percent_moving]
+ */
+namespace {
+
+using namespace Magnum;
+using Scene3D = SceneGraph::Scene<SceneGraph::MatrixTransformation3D>;
+using Object3D = SceneGraph::Object<SceneGraph::MatrixTransformation3D>;
+
+class UniformsDrawable : public gvs::vis::BoundedDrawable {
+public:
+    UniformsDrawable(Object3D& object, SceneGraph::DrawableGroup3D* group, float* sink)
+        : BoundedDrawable{object, group}, sink_(sink) {
+        set_local_bounds({{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}});
+    }
+
+private:
+    void clean(const Matrix4& absolute_transformation_matrix) override {
+        BoundedDrawable::clean(absolute_transformation_matrix);
+        uniforms_changed_ = true;
+    }
+
+    void draw(const Matrix4& /*transformation_matrix*/, SceneGraph::Camera3D& /*camera*/) override {
+        if (uniforms_changed_) {
+            uniforms_.set_world_from_local(world_from_local());
+            uniforms_changed_ = false;
+        }
+        *sink_ += uniforms_.world_from_local_normals[0].x();
+    }
+
+    gvs::vis::ItemUniforms uniforms_;
+    bool uniforms_changed_ = true;
+    float* sink_;
+};
+
+void benchmark_frames(std::size_t num_items, std::size_t num_frames, std::size_t percent_moving) {
+    Scene3D scene;
+    SceneGraph::DrawableGroup3D drawables;
+    float sink = 0.f;
+
+    // Items are spread over a 1000 x 1000 area but the camera only sees a small part of it
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-500.f, 500.f);
+
+    std::vector<Object3D*> objects;
+    objects.reserve(num_items);
+
+    for (std::size_t i = 0; i < num_items; ++i) {
+        auto& object = scene.addChild<Object3D>();
+        object.setTransformation(Matrix4::translation({dist(gen), dist(gen), dist(gen)}));
+        new UniformsDrawable(object, &drawables, &sink); // Owned by the object
+        objects.emplace_back(&object);
+    }
+
+    auto& camera_object = scene.addChild<Object3D>();
+    camera_object.setTransformation(Matrix4::translation({0.f, 0.f, 550.f}));
+    auto& camera = camera_object.addFeature<SceneGraph::Camera3D>();
+    camera.setProjectionMatrix(Matrix4::perspectiveProjection(Deg(45.f), 16.f / 9.f, 0.1f, 200.f));
+
+    gvs::vis::DrawableTransformations visible;
+    std::size_t num_moving = num_items * percent_moving / 100u;
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(num_frames, [&](std::size_t) { camera.draw(drawables); });
+        gvs::bench::print_row("draw all items", allocations, samples);
+    }
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(num_frames, [&](std::size_t) {
+            gvs::vis::collect_visible(drawables, camera, &visible);
+            camera.draw(visible);
+        });
+        gvs::bench::print_row("cull then draw", allocations, samples);
+    }
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(num_frames, [&](std::size_t frame) {
+            for (std::size_t i = 0; i < num_moving; ++i) {
+                objects[(frame * num_moving + i) % num_items]->translate({0.f, 0.01f, 0.f});
+            }
+            gvs::vis::collect_visible(drawables, camera, &visible);
+            camera.draw(visible);
+        });
+        gvs::bench::print_row("cull then draw (" + std::to_string(percent_moving) + "% moving)", allocations, samples);
+    }
+
+    std::cout << "\n" << visible.size() << " of " << num_items << " items visible" << std::endl;
+
+    // Keeps the work above from being optimized away
+    if (sink == 0.f) {
+        std::cerr << "Unexpected empty frames" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t num_items = 50000;
+    std::size_t num_frames = 200;
+    std::size_t percent_moving = 1;
+
+    if (argc > 1) {
+        num_items = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        num_frames = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        percent_moving = std::stoul(argv[3]);
+    }
+
+    std::cout << num_items << " items, " << num_frames << " frames\n" << std::endl;
+
+    gvs::bench::print_header();
+    benchmark_frames(num_items, num_frames, percent_moving);
+
+    return 0;
+}
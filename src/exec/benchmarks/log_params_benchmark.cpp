@@ -0,0 +1,116 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "benchmark_util.hpp"
+
+// project
+#include "gvs/log/log_params.hpp"
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <functional>
+#include <iostream>
+
+/*
+ * Measures heap allocations and latency of building a scene request from a large point buffer
+ * with the 'log_params' builders. Each copy of the buffer shows up as one buffer-sized allocation
+ * so 'MB/iter' divided by the buffer size is the number of times the data was copied.
+ *
+ * usage: gvs_log_params_benchmark [num_floats] [iterations]
+ */
+namespace {
+
+/// \brief The previous builder implementation: a by-value lambda capture wrapped in a std::function
+std::function<std::string(gvs::proto::SceneItemInfo*)> std_function_positions_3d(const std::vector<float>& data) {
+    return [data](gvs::proto::SceneItemInfo* info) {
+        if (info->mutable_geometry_info()->has_positions()) {
+            return "positions_3d";
+        }
+        *(info->mutable_geometry_info()->mutable_positions()->mutable_value()) = {data.begin(), data.end()};
+        return "";
+    };
+}
+
+template <typename MakeParam>
+void benchmark_builder(const std::string& name, std::size_t iterations, bool copy_into_request, MakeParam make_param) {
+    std::size_t total_size = 0;
+
+    gvs::bench::AllocationCounter allocations;
+    auto samples = gvs::bench::time_each(iterations, [&](std::size_t) {
+        gvs::proto::SceneItemInfo info;
+        make_param()(&info);
+
+        gvs::proto::SceneUpdateRequest request;
+        if (copy_into_request) {
+            request.mutable_replace_item()->CopyFrom(info);
+        } else {
+            request.mutable_replace_item()->Swap(&info);
+        }
+        const gvs::proto::FloatList& positions = request.replace_item().geometry_info().positions();
+        total_size += static_cast<std::size_t>(positions.value_size()) + positions.data().size();
+    });
+    gvs::bench::print_row(name, allocations, samples);
+
+    // Keeps the work above from being optimized away
+    if (total_size == 0) {
+        std::cerr << "Unexpected empty requests" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t num_floats = 15'000'000;
+    std::size_t iterations = 20;
+
+    if (argc > 1) {
+        num_floats = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        iterations = std::stoul(argv[2]);
+    }
+
+    const std::vector<float> points(num_floats, 1.f);
+    std::cout << iterations << " iterations, " << num_floats << " floats ("
+              << static_cast<double>(num_floats * sizeof(float)) / (1024.0 * 1024.0) << " MB) per buffer\n"
+              << std::endl;
+
+    gvs::bench::print_header();
+
+    // Copies: lambda capture, std::function copy, proto field, request
+    benchmark_builder("std::function builder + CopyFrom", iterations, true, [&] {
+        return std_function_positions_3d(points);
+    });
+
+    // Copies: proto field
+    benchmark_builder("borrowed lvalue + Swap", iterations, false, [&] { return gvs::positions_3d(points); });
+
+    // Copies: the caller's own copy, proto field (the builder takes ownership without copying)
+    benchmark_builder("moved rvalue + Swap", iterations, false, [&] {
+        std::vector<float> temporary = points;
+        return gvs::positions_3d(std::move(temporary));
+    });
+
+    return 0;
+}
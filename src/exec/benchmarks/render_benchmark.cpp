@@ -0,0 +1,296 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "benchmark_util.hpp"
+
+// project
+#include "gvs/vis-client/app/headless_renderer.hpp"
+#include "gvs/vis-client/scene/prepared_geometry.hpp"
+
+// generated
+#include <scene.pb.h>
+
+// external
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Matrix4.h>
+
+// standard
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+/*
+ * Measures the viewer's frame time without a window so it can run on machines without a GPU
+ * (Mesa's llvmpipe driver is enough). Frames are drawn into an offscreen framebuffer and each
+ * step of a frame is timed separately:
+ *
+ *  - update: scene changes and per-frame bookkeeping ('SceneInterface::update')
+ *  - render: drawing the scene
+ *  - gui:    building and drawing the scene's GUI
+ *
+ * Each step waits for the GPU to finish. The steps are measured with a still camera, an orbiting
+ * camera, and with a tenth of the items moving every frame.
+ *
+ * The scene is either synthetic (a grid of boxes, an instanced item, and a point cloud) or a
+ * 'SceneSnapshot' from the 'GetSceneAt' rpc that was saved with 'SerializeToOstream'.
+ *
+ * usage: gvs_render_benchmark [num_items] [num_frames] [scene_snapshot_file]
+ */
+namespace {
+
+using namespace Magnum;
+
+constexpr std::size_t max_warm_up_frames = 1000;
+
+void set_transformation(gvs::proto::SceneItemInfo* item, const Matrix4& transformation) {
+    auto* data = item->mutable_display_info()->mutable_transformation()->mutable_data();
+    data->Clear();
+    data->Add(transformation.data(), transformation.data() + 16);
+}
+
+void add_box_geometry(gvs::proto::GeometryInfo3D* geometry) {
+    static constexpr std::uint32_t box_indices[] = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+                                                    2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+
+    for (int i = 0; i < 8; ++i) {
+        geometry->mutable_positions()->add_value((i & 1) ? 0.4f : -0.4f);
+        geometry->mutable_positions()->add_value((i & 2) ? 0.4f : -0.4f);
+        geometry->mutable_positions()->add_value((i & 4) ? 0.4f : -0.4f);
+    }
+    for (std::uint32_t index : box_indices) {
+        geometry->mutable_indices()->add_value(index);
+    }
+}
+
+gvs::proto::SceneItemInfo make_item(const std::string& id, std::uint32_t handle) {
+    gvs::proto::SceneItemInfo item;
+    item.mutable_id()->set_value(id);
+    item.mutable_id()->set_handle(handle);
+    item.mutable_display_info()->mutable_readable_id()->set_value(id);
+    item.mutable_display_info()->mutable_geometry_format()->set_value(gvs::proto::GeometryFormat::TRIANGLES);
+    item.mutable_display_info()->mutable_coloring()->set_value(gvs::proto::Coloring::UNIFORM_COLOR);
+    return item;
+}
+
+/// \brief 'num_boxes' boxes on a square grid, one item with 10k box instances, and a 1M point cloud
+gvs::proto::SceneItems make_synthetic_scene(std::size_t num_boxes) {
+    gvs::proto::SceneItems scene;
+
+    auto side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(num_boxes))));
+    auto offset = static_cast<float>(side) * 0.5f;
+
+    for (std::size_t i = 0; i < num_boxes; ++i) {
+        std::string id = "box" + std::to_string(i);
+        gvs::proto::SceneItemInfo item = make_item(id, static_cast<std::uint32_t>(i + 1));
+        add_box_geometry(item.mutable_geometry_info());
+
+        Vector3 position{static_cast<float>(i % side) - offset, 0.f, static_cast<float>(i / side) - offset};
+        set_transformation(&item, Matrix4::translation(position));
+        (*scene.mutable_items())[id] = std::move(item);
+    }
+
+    {
+        std::string id = "instanced boxes";
+        gvs::proto::SceneItemInfo item = make_item(id, static_cast<std::uint32_t>(num_boxes + 1));
+        add_box_geometry(item.mutable_geometry_info());
+
+        for (int i = 0; i < 10'000; ++i) {
+            Vector3 position{static_cast<float>(i % 100) - 50.f, 5.f, static_cast<float>(i / 100) - 50.f};
+            Matrix4 transformation = Matrix4::translation(position) * Matrix4::scaling(Vector3{0.5f});
+            auto* values = item.mutable_geometry_info()->mutable_instance_transformations()->mutable_value();
+            values->Add(transformation.data(), transformation.data() + 16);
+        }
+        (*scene.mutable_items())[id] = std::move(item);
+    }
+
+    {
+        std::string id = "point cloud";
+        gvs::proto::SceneItemInfo item = make_item(id, static_cast<std::uint32_t>(num_boxes + 2));
+        item.mutable_display_info()->mutable_geometry_format()->set_value(gvs::proto::GeometryFormat::POINTS);
+        item.mutable_geometry_info()->set_point_cloud(true);
+
+        // Points on a wavy surface above the boxes
+        auto* positions = item.mutable_geometry_info()->mutable_positions()->mutable_value();
+        positions->Reserve(3'000'000);
+        for (int i = 0; i < 1'000'000; ++i) {
+            float x = static_cast<float>(i % 1000) * 0.1f - 50.f;
+            float z = static_cast<float>(i / 1000) * 0.1f - 50.f;
+            positions->Add(x);
+            positions->Add(10.f + std::sin(x * 0.3f) * std::cos(z * 0.3f));
+            positions->Add(z);
+        }
+        (*scene.mutable_items())[id] = std::move(item);
+    }
+
+    return scene;
+}
+
+bool load_scene_snapshot(const std::string& filename, gvs::proto::SceneItems* scene) {
+    std::ifstream file(filename, std::ios::binary);
+    gvs::proto::SceneSnapshot snapshot;
+
+    if (not file or not snapshot.ParseFromIstream(&file)) {
+        std::cerr << "Failed to read a scene snapshot from '" << filename << "'" << std::endl;
+        return false;
+    }
+    if (not snapshot.error_msg().empty()) {
+        std::cerr << "The scene snapshot contains an error: " << snapshot.error_msg() << std::endl;
+        return false;
+    }
+    *scene = std::move(*snapshot.mutable_items());
+    return true;
+}
+
+/// \brief Samples and allocations of one step of the frame, accumulated over all the frames
+struct StepSamples {
+    std::vector<double> samples_us;
+    std::size_t allocations = 0;
+    std::size_t allocated_bytes = 0;
+
+    template <typename Func>
+    void time(Func&& func) {
+        gvs::bench::AllocationCounter counter;
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        samples_us.emplace_back(std::chrono::duration<double, std::micro>(end - start).count());
+        allocations += counter.count();
+        allocated_bytes += counter.bytes();
+    }
+
+    void print(const std::string& name) const {
+        gvs::bench::print_row(name, allocations, allocated_bytes, samples_us);
+    }
+};
+
+/// \brief Draws 'num_frames' frames, calling 'before_frame(i)' during the update step of each frame
+template <typename BeforeFrame>
+void benchmark_frames(const std::string& name,
+                      gvs::vis::HeadlessRenderer* renderer,
+                      std::size_t num_frames,
+                      BeforeFrame&& before_frame) {
+    StepSamples update, render, gui, frame;
+
+    // Reserved up front so storing the samples doesn't count as an allocation made by the frame
+    for (StepSamples* step : {&update, &render, &gui, &frame}) {
+        step->samples_us.reserve(num_frames);
+    }
+
+    for (std::size_t i = 0; i < num_frames; ++i) {
+        frame.time([&] {
+            update.time([&] {
+                before_frame(i);
+                renderer->update();
+            });
+            render.time([&] { renderer->render(); });
+            gui.time([&] { renderer->draw_gui(); });
+        });
+    }
+
+    update.print(name + ": update");
+    render.print(name + ": render");
+    gui.print(name + ": gui");
+    frame.print(name + ": frame");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t num_items = 10'000;
+    std::size_t num_frames = 200;
+    gvs::proto::SceneItems scene;
+
+    if (argc > 1) {
+        num_items = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        num_frames = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        if (not load_scene_snapshot(argv[3], &scene)) {
+            return 1;
+        }
+    } else {
+        scene = make_synthetic_scene(num_items);
+    }
+
+    gvs::vis::HeadlessRenderer renderer;
+    renderer.look_at({0.f, 40.f, 80.f}, {});
+
+    std::cout << "Rendering " << scene.items_size() << " items for " << num_frames << " frames" << std::endl;
+    gvs::bench::print_header();
+
+    {
+        gvs::proto::SceneUpdate update;
+        *update.mutable_reset_all_items() = scene;
+
+        StepSamples load;
+        load.time([&] {
+            gvs::vis::PreparedUpdate prepared = gvs::vis::prepare_update(std::move(update));
+            renderer.scene().reset(prepared.update->reset_all_items(), prepared.geometry);
+            renderer.draw_frame();
+        });
+        load.print("load scene (prepare, upload, 1 frame)");
+    }
+
+    // Let small items settle into batches and point clouds finish loading before measuring
+    for (std::size_t i = 0; i < max_warm_up_frames; ++i) {
+        renderer.draw_frame();
+
+        if (i > 60 and not renderer.scene().refining()) {
+            break;
+        }
+    }
+
+    benchmark_frames("still camera", &renderer, num_frames, [](std::size_t) {});
+
+    benchmark_frames("orbiting camera", &renderer, num_frames, [&](std::size_t i) {
+        float angle = 2.f * Constants::pi() * static_cast<float>(i) / static_cast<float>(num_frames);
+        renderer.look_at({80.f * std::sin(angle), 40.f, 80.f * std::cos(angle)}, {});
+    });
+    renderer.look_at({0.f, 40.f, 80.f}, {});
+
+    // A tenth of the items bob up and down every frame
+    gvs::proto::SceneUpdate transforms;
+    for (const auto& id_and_item : scene.items()) {
+        const gvs::proto::SceneItemInfo& item = id_and_item.second;
+
+        if (item.id().handle() % 10u == 0u and item.display_info().transformation().data_size() == 16) {
+            transforms.mutable_transforms()->add_handles(item.id().handle());
+            transforms.mutable_transforms()->mutable_transformations()->Add(
+                item.display_info().transformation().data().begin(), item.display_info().transformation().data().end());
+        }
+    }
+
+    benchmark_frames("moving items", &renderer, num_frames, [&](std::size_t i) {
+        auto* data = transforms.mutable_transforms()->mutable_transformations()->mutable_data();
+        float delta = (i % 2u == 0u ? 0.5f : -0.5f);
+
+        // Column major so the y translation is element 13 of each matrix
+        for (int m = 13; m < transforms.transforms().transformations_size(); m += 16) {
+            data[m] += delta;
+        }
+        renderer.scene().update_transforms(transforms.transforms());
+    });
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "benchmark_util.hpp"
+
+// project
+#include "gvs/server/request_arena.hpp"
+#include "gvs/server/scene_server.hpp"
+
+// external
+#include <grpcw/client/grpc_client.hpp>
+
+// standard
+#include <iostream>
+
+/*
+ * Measures heap allocations and latency of the 'UpdateScene' path:
+ *
+ *  1. Building the temporary update that is broadcast to clients (copied vs. borrowed from an arena)
+ *  2. Full 'UpdateScene' rpcs sent to an in-process server
+ *
+ * usage: gvs_update_scene_benchmark [num_requests] [num_positions]
+ */
+namespace {
+
+gvs::proto::SceneItemInfo make_item(const std::string& id, std::size_t num_positions) {
+    gvs::proto::SceneItemInfo item;
+    item.mutable_id()->set_value(id);
+
+    auto* positions = item.mutable_geometry_info()->mutable_positions()->mutable_value();
+    positions->Reserve(static_cast<int>(num_positions * 3));
+    for (std::size_t i = 0; i < num_positions * 3; ++i) {
+        positions->Add(static_cast<float>(i));
+    }
+    item.mutable_display_info()->mutable_readable_id()->set_value(id);
+    return item;
+}
+
+void benchmark_update_construction(std::size_t iterations, std::size_t num_positions) {
+    gvs::proto::SceneItemInfo item = make_item("item", num_positions);
+    std::size_t total_bytes = 0;
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(iterations, [&](std::size_t) {
+            gvs::proto::SceneUpdate update;
+            update.mutable_add_item()->CopyFrom(item);
+            total_bytes += update.ByteSizeLong();
+        });
+        gvs::bench::print_row("copied SceneUpdate", allocations, samples);
+    }
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(iterations, [&](std::size_t) {
+            gvs::server::RequestArena arena;
+            total_bytes += arena.borrowing_add_update(item)->ByteSizeLong();
+        });
+        gvs::bench::print_row("arena SceneUpdate (borrowed item)", allocations, samples);
+    }
+
+    // Keeps the work above from being optimized away
+    if (total_bytes == 0) {
+        std::cerr << "Unexpected empty updates" << std::endl;
+    }
+}
+
+void benchmark_update_scene_rpc(std::size_t iterations, std::size_t num_positions) {
+    gvs::server::SceneServer server;
+
+    grpcw::client::GrpcClient<gvs::proto::Scene> client;
+    client.change_server(server.grpc_server());
+
+    auto send = [&](const gvs::proto::SceneUpdateRequest& request) {
+        client.use_stub([&](auto& stub) {
+            grpc::ClientContext context;
+            gvs::proto::Errors errors;
+            grpc::Status status = stub.UpdateScene(&context, request, &errors);
+
+            if (not status.ok() or not errors.error_msg().empty()) {
+                std::cerr << "UpdateScene failed: " << status.error_message() << errors.error_msg() << std::endl;
+            }
+        });
+    };
+
+    // Pre-build the requests so only the rpc is measured
+    std::vector<gvs::proto::SceneUpdateRequest> add_requests(iterations);
+    std::vector<gvs::proto::SceneUpdateRequest> update_requests(iterations);
+
+    for (std::size_t i = 0; i < iterations; ++i) {
+        std::string id = "item" + std::to_string(i);
+        *add_requests[i].mutable_safe_set_item() = make_item(id, num_positions);
+
+        update_requests[i].mutable_safe_set_item()->mutable_id()->set_value(id);
+        update_requests[i].mutable_safe_set_item()->mutable_display_info()->mutable_uniform_color()->set_x(0.5f);
+    }
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(iterations, [&](std::size_t i) { send(add_requests[i]); });
+        gvs::bench::print_row("UpdateScene rpc (add item)", allocations, samples);
+    }
+
+    {
+        gvs::bench::AllocationCounter allocations;
+        auto samples = gvs::bench::time_each(iterations, [&](std::size_t i) { send(update_requests[i]); });
+        gvs::bench::print_row("UpdateScene rpc (update display info)", allocations, samples);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t num_requests = 2000;
+    std::size_t num_positions = 1000;
+
+    if (argc > 1) {
+        num_requests = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        num_positions = std::stoul(argv[2]);
+    }
+
+    std::cout << num_requests << " iterations, " << num_positions << " positions per item\n" << std::endl;
+
+    gvs::bench::print_header();
+    benchmark_update_construction(num_requests, num_positions);
+    benchmark_update_scene_rpc(num_requests, num_positions);
+
+    return 0;
+}
@@ -114,4 +114,34 @@ int main(int argc, char* argv[]) {
     add_translated_mesh_to_scene(scene, cube_mesh, 0.f, 2.1f, 0.f);
     add_translated_mesh_to_scene(scene, cube_mesh, 0.f, 0.f, -2.1f);
     add_translated_mesh_to_scene(scene, cube_mesh, 0.f, 0.f, 2.1f);
+
+    // A million small boxes drawn with a single instanced draw call
+    {
+        constexpr unsigned grid_size = 1000;
+        constexpr float spacing = 0.1f;
+
+        std::vector<float> transforms;
+        std::vector<float> colors;
+        transforms.reserve(grid_size * grid_size * 16);
+        colors.reserve(grid_size * grid_size * 3);
+
+        for (unsigned yi = 0; yi < grid_size; ++yi) {
+            for (unsigned xi = 0; xi < grid_size; ++xi) {
+                float x = (static_cast<float>(xi) - grid_size * 0.5f) * spacing;
+                float z = (static_cast<float>(yi) - grid_size * 0.5f) * spacing;
+                float scale = spacing * 0.4f;
+
+                transforms.insert(transforms.end(),
+                                  {scale, 0, 0, 0, 0, scale, 0, 0, 0, 0, scale, 0, x, -5.f, z, 1});
+                colors.insert(colors.end(),
+                              {static_cast<float>(xi) / grid_size, 0.5f, static_cast<float>(yi) / grid_size});
+            }
+        }
+
+        auto stream = scene.item_stream("Instanced Boxes")
+            << gvs::positions_3d(cube_mesh.verts) << gvs::normals_3d(cube_mesh.norms) << gvs::triangles(cube_mesh.tris)
+            << gvs::instance_transformations(std::move(transforms)) << gvs::instance_colors(std::move(colors))
+            << gvs::shading(gvs::LambertianShading{{-1.f, -2.f, -3.f}}) << gvs::replace;
+        CHECK_WITH_PRINT(stream);
+    }
 }
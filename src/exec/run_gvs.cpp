@@ -50,6 +50,7 @@ int main(int argc, char** argv) {
     std::string host_address = "0.0.0.0:50055";
     bool client_only = false;
     bool server_only = false;
+    gvs::server::SceneServerSettings server_settings;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -70,11 +71,22 @@ int main(int argc, char** argv) {
             server_only = true;
             client_only = false;
         }
+
+        constexpr auto record_flag = "--record";
+        if (arg.rfind(record_flag, 0) == 0) {
+            server_settings.record_timeline = true;
+        }
+
+        constexpr auto update_tick_flag = "--update-tick=";
+        if (arg.rfind(update_tick_flag, 0) == 0) {
+            server_settings.update_tick = std::chrono::milliseconds(
+                std::stoi(arg.substr(std::string(update_tick_flag).size())));
+        }
     }
 
     std::unique_ptr<gvs::server::SceneServer> server;
     if (!client_only) {
-        server = std::make_unique<gvs::server::SceneServer>(host_address);
+        server = std::make_unique<gvs::server::SceneServer>(host_address, server_settings);
         std::cout << "Server running at '" << host_address << "'" << std::endl;
     }
 
@@ -0,0 +1,562 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "async_sender.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+
+namespace gvs {
+namespace log {
+
+namespace {
+
+SendResult ready_result(const std::string& error) {
+    std::promise<std::string> promise;
+    promise.set_value(error);
+    return promise.get_future().share();
+}
+
+/// \brief The item info in a request, or null if the request can't be merged with others
+proto::SceneItemInfo* mergeable_item(proto::SceneUpdateRequest* request) {
+    switch (request->update_case()) {
+    case proto::SceneUpdateRequest::kSafeSetItem:
+        return request->mutable_safe_set_item();
+    case proto::SceneUpdateRequest::kReplaceItem:
+        return request->mutable_replace_item();
+    case proto::SceneUpdateRequest::kUpdateItem:
+        return request->mutable_update_item();
+    default:
+        // Appended geometry can't be replaced by later data and the other requests aren't specific to an item
+        return nullptr;
+    }
+}
+
+/// \brief Replace any fields in 'item' that are set in 'latest'
+void merge_item_info(proto::SceneItemInfo* item, const proto::SceneItemInfo& latest) {
+    if (latest.has_geometry_info()) {
+        item->mutable_geometry_info()->CopyFrom(latest.geometry_info());
+    }
+
+    if (latest.has_parent()) {
+        item->mutable_parent()->CopyFrom(latest.parent());
+    }
+
+    const proto::DisplayInfo& display = latest.display_info();
+    proto::DisplayInfo* merged_display = item->mutable_display_info();
+
+    if (display.has_readable_id()) {
+        merged_display->mutable_readable_id()->CopyFrom(display.readable_id());
+    }
+    if (display.has_geometry_format()) {
+        merged_display->mutable_geometry_format()->CopyFrom(display.geometry_format());
+    }
+    if (display.has_transformation()) {
+        merged_display->mutable_transformation()->CopyFrom(display.transformation());
+    }
+    if (display.has_uniform_color()) {
+        merged_display->mutable_uniform_color()->CopyFrom(display.uniform_color());
+    }
+    if (display.has_coloring()) {
+        merged_display->mutable_coloring()->CopyFrom(display.coloring());
+    }
+    if (display.has_shading()) {
+        merged_display->mutable_shading()->CopyFrom(display.shading());
+    }
+}
+
+} // namespace
+
+AsyncSender::AsyncSender(SendFunction send_request, AsyncSettings settings, BatchSendFunction send_batch)
+    : send_request_(std::move(send_request)), send_batch_(std::move(send_batch)), settings_(std::move(settings)) {
+    if (settings_.max_queue_size == 0) {
+        settings_.max_queue_size = 1;
+    }
+    if (not send_batch_) {
+        settings_.max_batch_size = 1;
+    }
+    settings_.max_batch_size = std::max(std::size_t(1), std::min(settings_.max_batch_size, settings_.max_queue_size));
+    sender_thread_ = std::thread(&AsyncSender::send_queued_requests, this);
+}
+
+AsyncSender::~AsyncSender() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    queue_changed_.notify_all();
+    sender_thread_.join();
+}
+
+SendResult AsyncSender::enqueue(const std::string& id, proto::SceneUpdateRequest request, HandleTarget handle) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (queue_.size() >= settings_.max_queue_size) {
+        switch (settings_.queue_full_policy) {
+
+        case QueueFullPolicy::drop: {
+            lock.unlock();
+            PendingRequest dropped{id,
+                                   {},
+                                   nullptr,
+                                   ready_result("Send queue is full. The request was dropped."),
+                                   std::chrono::steady_clock::now(),
+                                   nullptr};
+            report(dropped, dropped.result.get());
+            return dropped.result;
+        }
+
+        case QueueFullPolicy::block:
+            queue_changed_.wait(lock, [this] { return queue_.size() < settings_.max_queue_size; });
+            break;
+
+        case QueueFullPolicy::coalesce: {
+            SendResult result;
+            if (coalesce(id, &request, handle, &result)) {
+                return result;
+            }
+
+            PendingRequest oldest = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+
+            std::string error = "Send queue is full. The request was dropped in favor of newer requests.";
+            oldest.promise->set_value(error);
+            report(oldest, error);
+
+            lock.lock();
+        } break;
+        }
+    }
+
+    PendingRequest pending{id,
+                           std::move(request),
+                           std::make_shared<std::promise<std::string>>(),
+                           {},
+                           std::chrono::steady_clock::now(),
+                           std::move(handle)};
+    pending.result = pending.promise->get_future().share();
+    SendResult result = pending.result;
+
+    queue_.emplace_back(std::move(pending));
+    lock.unlock();
+
+    queue_changed_.notify_all();
+    return result;
+}
+
+void AsyncSender::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++flush_requests_;
+    queue_changed_.notify_all(); // partial batches can be sent
+
+    queue_changed_.wait(lock, [this] { return queue_.empty() and not sending_; });
+    --flush_requests_;
+}
+
+bool AsyncSender::coalesce(const std::string& id,
+                           proto::SceneUpdateRequest* request,
+                           const HandleTarget& handle,
+                           SendResult* result) {
+    const proto::SceneItemInfo* latest_item = mergeable_item(request);
+
+    if (id.empty() or latest_item == nullptr) {
+        return false;
+    }
+
+    // Merging into anything but the latest request for the item would send the new data before
+    // requests for the item that were queued after the one it was merged into
+    auto latest = std::find_if(
+        queue_.rbegin(), queue_.rend(), [&id](const PendingRequest& pending) { return pending.id == id; });
+
+    if (latest == queue_.rend() or latest->request.update_case() != request->update_case()) {
+        return false;
+    }
+
+    // A second 'safe_set' with geometry fails on the server ("already exists"). Merging would hide that error.
+    if (request->update_case() == proto::SceneUpdateRequest::kSafeSetItem and latest_item->has_geometry_info()) {
+        return false;
+    }
+
+    merge_item_info(mergeable_item(&latest->request), *latest_item);
+    if (not latest->handle) {
+        latest->handle = handle;
+    }
+    *result = latest->result;
+    return true;
+}
+
+void AsyncSender::report(const PendingRequest& pending, const std::string& error) {
+    if (not error.empty() and settings_.on_error) {
+        settings_.on_error(pending.id, error);
+    }
+}
+
+std::vector<proto::Errors> AsyncSender::send(std::vector<PendingRequest>* batch) {
+    if (batch->size() == 1) {
+        return {send_request_(batch->front().request)};
+    }
+
+    proto::SceneUpdateRequestBatch batch_request;
+    batch_request.mutable_requests()->Reserve(static_cast<int>(batch->size()));
+
+    for (PendingRequest& pending : *batch) {
+        batch_request.add_requests()->Swap(&pending.request);
+    }
+
+    std::vector<proto::Errors> errors = send_batch_(batch_request);
+
+    if (errors.size() != batch->size()) {
+        proto::Errors error;
+        error.set_error_msg(errors.size() == 1 ? errors.front().error_msg() : "");
+        if (error.error_msg().empty()) {
+            error.set_error_msg("Expected " + std::to_string(batch->size()) + " results from the server but received "
+                                + std::to_string(errors.size()));
+        }
+        errors.assign(batch->size(), error);
+    }
+    return errors;
+}
+
+void AsyncSender::send_queued_requests() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        queue_changed_.wait(lock, [this] { return stop_ or not queue_.empty(); });
+
+        // Everything queued before the sender was destroyed is still sent
+        if (queue_.empty()) {
+            break;
+        }
+
+        if (settings_.max_batch_size > 1) {
+            // Wait for a full batch unless the oldest request has already waited long enough
+            auto send_time = queue_.front().queued_time + settings_.max_batch_delay;
+
+            queue_changed_.wait_until(lock, send_time, [this] {
+                return stop_ or flush_requests_ > 0 or queue_.size() >= settings_.max_batch_size;
+            });
+
+            // A full queue may have dropped requests while waiting
+            if (queue_.empty()) {
+                continue;
+            }
+        }
+
+        std::vector<PendingRequest> batch;
+        batch.reserve(std::min(queue_.size(), settings_.max_batch_size));
+
+        while (not queue_.empty() and batch.size() < settings_.max_batch_size) {
+            batch.emplace_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+
+        sending_ = true;
+        lock.unlock();
+        queue_changed_.notify_all(); // there is room in the queue
+
+        std::vector<proto::Errors> errors = send(&batch);
+
+        for (auto i = 0u; i < batch.size(); ++i) {
+            const std::string& error = errors[i].error_msg();
+
+            // Set before the result so anyone waiting on the result sees the handle
+            if (batch[i].handle) {
+                batch[i].handle->store(error.empty() ? errors[i].item_handle() : 0u);
+            }
+            batch[i].promise->set_value(error);
+            report(batch[i], error);
+        }
+
+        lock.lock();
+        sending_ = false;
+        queue_changed_.notify_all(); // may be flushed
+    }
+}
+
+namespace {
+
+/// \brief Identifies requests in the tests below by the readable id of their item
+proto::SceneUpdateRequest item_request(proto::SceneUpdateRequest::UpdateCase type,
+                                       const std::string& label,
+                                       bool with_geometry = false) {
+    proto::SceneUpdateRequest request;
+    proto::SceneItemInfo* item = nullptr;
+
+    switch (type) {
+    case proto::SceneUpdateRequest::kSafeSetItem:
+        item = request.mutable_safe_set_item();
+        break;
+    case proto::SceneUpdateRequest::kReplaceItem:
+        item = request.mutable_replace_item();
+        break;
+    default:
+        item = request.mutable_update_item();
+        break;
+    }
+
+    item->mutable_display_info()->mutable_readable_id()->set_value(label);
+    if (with_geometry) {
+        item->mutable_geometry_info()->mutable_positions()->add_value(0.f);
+    }
+    return request;
+}
+
+std::string label(proto::SceneUpdateRequest request) {
+    const proto::SceneItemInfo* item = mergeable_item(&request);
+    return item ? item->display_info().readable_id().value() : "";
+}
+
+/// \brief Stands in for the server. Sends wait until 'open' is called so tests can fill the queue.
+class FakeServer {
+public:
+    proto::Errors send(const proto::SceneUpdateRequest& request) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sent_.push_back(label(request));
+        changed_.notify_all();
+        changed_.wait(lock, [this] { return open_; });
+        return {};
+    }
+
+    std::vector<proto::Errors> send_batch(const proto::SceneUpdateRequestBatch& batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batch_sizes_.push_back(static_cast<std::size_t>(batch.requests_size()));
+        for (const proto::SceneUpdateRequest& request : batch.requests()) {
+            sent_.push_back(label(request));
+        }
+        changed_.notify_all();
+        changed_.wait(lock, [this] { return open_; });
+        return std::vector<proto::Errors>(static_cast<std::size_t>(batch.requests_size()));
+    }
+
+    AsyncSender::SendFunction send_function() {
+        return [this](const proto::SceneUpdateRequest& request) { return send(request); };
+    }
+
+    AsyncSender::BatchSendFunction batch_send_function() {
+        return [this](const proto::SceneUpdateRequestBatch& batch) { return send_batch(batch); };
+    }
+
+    /// \brief Blocks until the sender has started sending 'count' requests
+    void wait_for_sends(std::size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this, count] { return sent_.size() >= count; });
+    }
+
+    void open() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+        }
+        changed_.notify_all();
+    }
+
+    std::vector<std::string> sent() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sent_;
+    }
+
+    std::vector<std::size_t> batch_sizes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batch_sizes_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool open_ = false;
+    std::vector<std::string> sent_;
+    std::vector<std::size_t> batch_sizes_;
+};
+
+constexpr auto update_case = proto::SceneUpdateRequest::kUpdateItem;
+constexpr auto replace_case = proto::SceneUpdateRequest::kReplaceItem;
+constexpr auto safe_set_case = proto::SceneUpdateRequest::kSafeSetItem;
+
+} // namespace
+
+TEST_CASE("[gvs-log] async_sender_blocks_until_there_is_room") {
+    FakeServer server;
+
+    AsyncSettings settings;
+    settings.max_queue_size = 1;
+    settings.queue_full_policy = QueueFullPolicy::block;
+    AsyncSender sender(server.send_function(), settings);
+
+    sender.enqueue("a", item_request(update_case, "1"));
+    server.wait_for_sends(1); // "1" is being sent, leaving an empty queue
+    sender.enqueue("b", item_request(update_case, "2"));
+
+    std::thread blocked([&sender] { sender.enqueue("c", item_request(update_case, "3")); });
+    server.open();
+    blocked.join();
+
+    sender.flush();
+    CHECK(server.sent() == std::vector<std::string>{"1", "2", "3"});
+}
+
+TEST_CASE("[gvs-log] async_sender_drops_new_requests_when_full") {
+    FakeServer server;
+    std::vector<std::string> error_ids;
+
+    AsyncSettings settings;
+    settings.max_queue_size = 2;
+    settings.queue_full_policy = QueueFullPolicy::drop;
+    settings.on_error = [&error_ids](const std::string& id, const std::string&) { error_ids.push_back(id); };
+    AsyncSender sender(server.send_function(), settings);
+
+    SendResult first = sender.enqueue("a", item_request(update_case, "1"));
+    server.wait_for_sends(1);
+    sender.enqueue("b", item_request(update_case, "2"));
+    sender.enqueue("c", item_request(update_case, "3"));
+
+    // Reported right away on this thread
+    SendResult dropped = sender.enqueue("d", item_request(update_case, "4"));
+    CHECK(dropped.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    CHECK_FALSE(dropped.get().empty());
+    CHECK(error_ids == std::vector<std::string>{"d"});
+
+    server.open();
+    sender.flush();
+    CHECK(first.get().empty());
+    CHECK(server.sent() == std::vector<std::string>{"1", "2", "3"});
+}
+
+TEST_CASE("[gvs-log] async_sender_coalesces_into_the_latest_request_for_an_item") {
+    FakeServer server;
+    std::vector<std::string> error_ids;
+
+    AsyncSettings settings;
+    settings.max_queue_size = 2;
+    settings.queue_full_policy = QueueFullPolicy::coalesce;
+    settings.on_error = [&error_ids](const std::string& id, const std::string&) { error_ids.push_back(id); };
+    AsyncSender sender(server.send_function(), settings);
+
+    sender.enqueue("x", item_request(update_case, "x"));
+    server.wait_for_sends(1);
+
+    SUBCASE("merged") {
+        SendResult a_result = sender.enqueue("a", item_request(update_case, "a1"));
+        sender.enqueue("b", item_request(update_case, "b1"));
+
+        // The queue is full so the newer data replaces the queued request for "a"
+        SendResult merged = sender.enqueue("a", item_request(update_case, "a2"));
+        CHECK(merged.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+
+        server.open();
+        sender.flush();
+        CHECK(merged.get().empty());
+        CHECK(a_result.get().empty());
+        CHECK(error_ids.empty());
+        CHECK(server.sent() == std::vector<std::string>{"x", "a2", "b1"});
+    }
+
+    SUBCASE("latest_request_is_a_different_type") {
+        sender.enqueue("a", item_request(update_case, "update"));
+        sender.enqueue("a", item_request(replace_case, "replace"));
+
+        // Merging into the first update would send the new data before the replace so the oldest is dropped
+        sender.enqueue("a", item_request(update_case, "newer update"));
+
+        server.open();
+        sender.flush();
+        CHECK(error_ids == std::vector<std::string>{"a"});
+        CHECK(server.sent() == std::vector<std::string>{"x", "replace", "newer update"});
+    }
+
+    SUBCASE("safe_sets_with_geometry_are_not_merged") {
+        sender.enqueue("a", item_request(safe_set_case, "first", true));
+        sender.enqueue("b", item_request(update_case, "b"));
+
+        SendResult second = sender.enqueue("a", item_request(safe_set_case, "second", true));
+
+        server.open();
+        sender.flush();
+        CHECK(second.get().empty()); // the fake server accepts everything
+        CHECK(error_ids == std::vector<std::string>{"a"}); // the first safe set was dropped instead
+        CHECK(server.sent() == std::vector<std::string>{"x", "b", "second"});
+    }
+}
+
+TEST_CASE("[gvs-log] async_sender_batches_requests") {
+    FakeServer server;
+
+    AsyncSettings settings;
+    settings.max_queue_size = 8;
+    settings.max_batch_size = 3;
+    settings.max_batch_delay = std::chrono::hours(1); // only full batches or flushes are sent
+    AsyncSender sender(server.send_function(), settings, server.batch_send_function());
+    server.open();
+
+    for (const char* name : {"1", "2", "3", "4", "5"}) {
+        sender.enqueue(name, item_request(update_case, name));
+    }
+
+    server.wait_for_sends(3); // the first batch is full so it is sent without waiting
+    sender.flush(); // the partial batch is sent right away
+
+    CHECK(server.sent() == std::vector<std::string>{"1", "2", "3", "4", "5"});
+    CHECK(server.batch_sizes() == std::vector<std::size_t>{3u, 2u});
+}
+
+TEST_CASE("[gvs-log] async_sender_passes_item_handles_back") {
+    std::vector<proto::SceneUpdateRequest::UpdateCase> sent; // only read after flushing
+
+    AsyncSender sender(
+        [&sent](const proto::SceneUpdateRequest& request) {
+            sent.push_back(request.update_case());
+
+            proto::Errors errors;
+            if (label(request) == "bad") {
+                errors.set_error_msg("bad item");
+            } else if (request.has_update_item()) {
+                errors.set_item_handle(7u);
+            }
+            return errors;
+        },
+        AsyncSettings());
+
+    auto handle = std::make_shared<std::atomic<std::uint32_t>>(0u);
+
+    SendResult result = sender.enqueue("a", item_request(update_case, "good", false), handle);
+    CHECK(result.get().empty());
+    CHECK(handle->load() == 7u);
+
+    // Transforms are sent in order with the item requests
+    proto::SceneUpdateRequest transforms;
+    transforms.mutable_transforms()->add_handles(7u);
+    sender.enqueue("", transforms);
+
+    // Handles are cleared after errors so streams go back to their string ids
+    result = sender.enqueue("a", item_request(update_case, "bad", false), handle);
+    CHECK(result.get() == "bad item");
+    CHECK(handle->load() == 0u);
+
+    sender.flush();
+    CHECK(sent
+          == std::vector<proto::SceneUpdateRequest::UpdateCase>{
+              update_case, proto::SceneUpdateRequest::kTransforms, update_case});
+}
+
+} // namespace log
+} // namespace gvs
@@ -0,0 +1,139 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gvs {
+namespace log {
+
+/// \brief What to do with a new request when the async send queue is full
+enum class QueueFullPolicy : uint8_t {
+    drop, ///< Reject the new request
+    block, ///< Wait until there is room in the queue
+    coalesce, ///< Merge into the latest queued request for the same item if possible, otherwise drop the oldest request
+};
+
+struct AsyncSettings {
+    std::size_t max_queue_size = 256;
+    QueueFullPolicy queue_full_policy = QueueFullPolicy::block;
+
+    /// \brief Queued requests are combined into batches of at most this many requests and sent with a single
+    ///        rpc. A value of 1 sends every request individually. Clamped to 'max_queue_size'.
+    std::size_t max_batch_size = 1;
+
+    /// \brief How long a partial batch waits for more requests before it is sent anyway (measured from when
+    ///        the oldest request in the batch was queued). 'flush()' sends partial batches immediately.
+    std::chrono::milliseconds max_batch_delay = std::chrono::milliseconds::zero();
+
+    /// \brief Called when a request fails. Arguments are the stream id and error message. Sent requests are
+    ///        reported from the sender thread. Requests dropped because the queue is full are reported from
+    ///        the thread that called 'enqueue'.
+    std::function<void(const std::string&, const std::string&)> on_error = nullptr;
+};
+
+/// \brief Holds the error message of a request once it has been sent (empty if the request was successful)
+using SendResult = std::shared_future<std::string>;
+
+/// \brief Set to the handle the server assigned to a request's item once the request has been sent
+///        (0 if the request failed)
+using HandleTarget = std::shared_ptr<std::atomic<std::uint32_t>>;
+
+/// \brief Sends scene update requests from a background thread so callers never wait on the server
+class AsyncSender {
+public:
+    using SendFunction = std::function<proto::Errors(const proto::SceneUpdateRequest&)>;
+    using BatchSendFunction = std::function<std::vector<proto::Errors>(const proto::SceneUpdateRequestBatch&)>;
+
+    /// \param send_request - sends a single request and returns the server's response (an empty error message on
+    ///                       success)
+    /// \param send_batch - sends several requests at once and returns the server's response to each one. Requests
+    ///                     are never batched if this is null.
+    AsyncSender(SendFunction send_request, AsyncSettings settings, BatchSendFunction send_batch = nullptr);
+
+    /// \brief Sends any requests that are still queued before returning
+    ~AsyncSender();
+
+    /// \brief Add a request to the send queue. Requests are sent in the order they are queued.
+    /// \param id - the stream id, used when coalescing requests and reporting errors
+    /// \param handle - if not null, receives the item handle from the server's response
+    SendResult enqueue(const std::string& id, proto::SceneUpdateRequest request, HandleTarget handle = nullptr);
+
+    /// \brief Send any partial batches immediately and block until every queued request has been sent
+    void flush();
+
+private:
+    struct PendingRequest {
+        std::string id;
+        proto::SceneUpdateRequest request;
+        std::shared_ptr<std::promise<std::string>> promise;
+        SendResult result;
+        std::chrono::steady_clock::time_point queued_time;
+        HandleTarget handle;
+    };
+
+    SendFunction send_request_;
+    BatchSendFunction send_batch_;
+    AsyncSettings settings_;
+
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    std::deque<PendingRequest> queue_;
+    bool sending_ = false; ///< True while a request is being sent (it has already been removed from the queue)
+    bool stop_ = false;
+    std::size_t flush_requests_ = 0; ///< The number of threads waiting in 'flush()'
+
+    std::thread sender_thread_;
+
+    /// \brief Merges 'request' into the most recently queued request for the same item. Returns false if
+    ///        that request is a different kind of request or merging would change what the server does.
+    bool coalesce(const std::string& id,
+                  proto::SceneUpdateRequest* request,
+                  const HandleTarget& handle,
+                  SendResult* result);
+
+    void report(const PendingRequest& pending, const std::string& error);
+
+    /// \brief Sends the requests as a single batch (or individually if there is only one)
+    std::vector<proto::Errors> send(std::vector<PendingRequest>* batch);
+
+    void send_queued_requests();
+};
+
+} // namespace log
+} // namespace gvs
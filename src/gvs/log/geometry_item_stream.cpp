@@ -22,30 +22,48 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #include "geometry_item_stream.hpp"
 
+#include <doctest/doctest.h>
+
 namespace gvs {
 namespace log {
 
-GeometryItemStream::GeometryItemStream(std::string id, proto::Scene::Stub* stub) : id_(std::move(id)), stub_(stub) {}
+GeometryItemStream::GeometryItemStream(std::string id, proto::Scene::Stub* stub, AsyncSender* async_sender)
+    : id_(std::move(id)), stub_(stub), async_sender_(async_sender) {}
 
 void GeometryItemStream::send_current_data(SendType type) {
-    info_.mutable_id()->set_value(id_);
+    // Once the server has assigned a handle it's sent instead of the (much longer) string id
+    std::uint32_t handle = handle_->load();
+
+    if (handle != 0u) {
+        info_.mutable_id()->set_handle(handle);
+    } else {
+        info_.mutable_id()->set_value(id_);
+    }
+
     if (stub_) {
         proto::SceneUpdateRequest update;
 
+        // The stream contents are cleared after sending so they can be moved into the request
         switch (type) {
         case SendType::safe:
-            update.mutable_safe_set_item()->CopyFrom(info_);
+            update.mutable_safe_set_item()->Swap(&info_);
             break;
 
         case SendType::replace:
-            update.mutable_replace_item()->CopyFrom(info_);
+            update.mutable_replace_item()->Swap(&info_);
             break;
 
         case SendType::append:
-            update.mutable_append_to_item()->CopyFrom(info_);
+            update.mutable_append_to_item()->Swap(&info_);
             break;
         }
 
+        if (async_sender_) {
+            last_result_ = async_sender_->enqueue(id_, std::move(update), handle_);
+            info_.Clear();
+            return;
+        }
+
         grpc::ClientContext context;
         proto::Errors errors;
 
@@ -60,6 +78,9 @@ void GeometryItemStream::send_current_data(SendType type) {
         } else {
             error_message_ = "";
         }
+
+        // Fall back to the string id after errors in case the handle was invalidated
+        handle_->store(error_message_.empty() ? errors.item_handle() : 0u);
     }
 
     info_.Clear();
@@ -73,6 +94,10 @@ const std::string& GeometryItemStream::id() const {
     return id_;
 }
 
+std::uint32_t GeometryItemStream::handle() const {
+    return handle_->load();
+}
+
 bool GeometryItemStream::success() const {
     return error_message_.empty();
 }
@@ -81,5 +106,84 @@ const std::string& GeometryItemStream::error_message() const {
     return error_message_;
 }
 
+SendResult GeometryItemStream::last_result() const {
+    if (async_sender_ and last_result_.valid()) {
+        return last_result_;
+    }
+
+    std::promise<std::string> result;
+    result.set_value(error_message_);
+    return result.get_future().share();
+}
+
+#if __cplusplus >= 201703L // 'gvs::item' needs C++17
+
+namespace {
+
+/// \brief Applies each param to a new item the same way 'GeometryItemStream::operator<<' does
+template <typename... Params>
+proto::SceneItemInfo apply_params(Params&&... params) {
+    proto::SceneItemInfo info;
+    std::string errors;
+    ((errors += params(&info)), ...);
+    CHECK(errors.empty());
+    return info;
+}
+
+const std::vector<std::array<float, 3>> test_positions = {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}};
+const std::vector<std::array<float, 3>> test_normals = {{0.f, 0.f, 1.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, 1.f}};
+const std::vector<unsigned> test_indices = {0u, 1u, 2u};
+const std::array<float, 3> test_color = {1.f, 0.5f, 0.f};
+
+} // namespace
+
+TEST_CASE("[gvs-log] item_builder_writes_the_same_fields_as_the_params") {
+    proto::SceneItemInfo expected = apply_params(gvs::positions_3d(test_positions),
+                                                 gvs::normals_3d(test_normals),
+                                                 gvs::triangles(test_indices),
+                                                 gvs::uniform_color(test_color),
+                                                 gvs::shading(gvs::LambertianShading{}),
+                                                 gvs::parent("parent"));
+
+    REQUIRE(expected.geometry_info().has_positions());
+    REQUIRE(expected.display_info().has_geometry_format());
+
+    proto::SceneItemInfo info;
+
+    SUBCASE("item_with_params") {
+        auto builder = gvs::item(gvs::positions_3d(test_positions),
+                                 gvs::normals_3d(test_normals),
+                                 gvs::triangles(test_indices),
+                                 gvs::uniform_color(test_color),
+                                 gvs::shading(gvs::LambertianShading{}),
+                                 gvs::parent("parent"));
+        CHECK(builder(&info).empty());
+    }
+
+    SUBCASE("params_streamed_into_an_item") {
+        auto builder = gvs::item() << gvs::positions_3d(test_positions) << gvs::normals_3d(test_normals)
+                                   << gvs::triangles(test_indices) << gvs::uniform_color(test_color)
+                                   << gvs::shading(gvs::LambertianShading{}) << gvs::parent("parent");
+        CHECK(builder(&info).empty());
+    }
+
+    CHECK(info.SerializeAsString() == expected.SerializeAsString());
+}
+
+TEST_CASE("[gvs-log] item_builder_names_the_fields_that_are_already_set") {
+    GeometryItemStream stream("item", nullptr);
+    stream << gvs::positions_3d(test_positions) << gvs::uniform_color(test_color);
+
+    CHECK_THROWS_WITH(stream << gvs::item(gvs::triangles(test_indices),
+                                          gvs::positions_3d(test_positions),
+                                          gvs::uniform_color(test_color)),
+                      "A field from gvs::item (positions_3d, uniform_color) is already set");
+
+    // Nothing from the failed builder was written
+    CHECK_NOTHROW(stream << gvs::triangles(test_indices));
+}
+
+#endif
+
 } // namespace log
 } // namespace gvs
@@ -23,6 +23,8 @@
 #pragma once
 
 // project
+#include "gvs/log/async_sender.hpp"
+#include "gvs/log/item_builder.hpp"
 #include "gvs/log/log_params.hpp"
 #include "gvs/log/send.hpp"
 
@@ -53,7 +55,8 @@ enum class SendType : uint8_t {
 /// \brief A single item stream
 class GeometryItemStream {
 public:
-    explicit GeometryItemStream(std::string id, proto::Scene::Stub* stub);
+    /// \param async_sender - if not null, requests are queued on this sender instead of being sent immediately
+    explicit GeometryItemStream(std::string id, proto::Scene::Stub* stub, AsyncSender* async_sender = nullptr);
 
     /// \brief Sends all the data currently stored in this stream
     void send_current_data(SendType type);
@@ -141,15 +144,27 @@ public:
     /// \brief Get the stream id
     const std::string& id() const;
 
+    /// \brief The handle the server assigned to this stream's item (0 until a send succeeds). Async
+    ///        streams learn it once their first request has been sent.
+    std::uint32_t handle() const;
+
     /// \brief Return true if no errors have occurred while modifying or sending the stream contents
     bool success() const;
 
     /// \brief The associated error message if GeometryItemStream::success returns false
     const std::string& error_message() const;
 
+    /// \brief The result of the most recent send. Async streams report server errors here instead
+    ///        of in 'error_message()'. The contained string is empty if the send was successful.
+    SendResult last_result() const;
+
 private:
     const std::string id_; ///< The id of the stream
+    /// Server-assigned handle used instead of 'id_' once known. Shared with the async sender, which sets it.
+    HandleTarget handle_ = std::make_shared<std::atomic<std::uint32_t>>(0u);
     proto::Scene::Stub* stub_; ///< The RPC stub allowing the stream to send data
+    AsyncSender* async_sender_; ///< Queues requests to be sent on a separate thread (null for blocking sends)
+    SendResult last_result_; ///< The result of the most recent async send
     proto::SceneItemInfo info_; ///< The current state of the stream
 
     std::string error_message_ = ""; ///< error messages for this stream, empty if there are none
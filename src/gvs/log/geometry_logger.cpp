@@ -34,12 +34,64 @@ bool GeometryLogger::connected() const {
     return stub_ != nullptr;
 }
 
+std::string GeometryLogger::enable_async_sends(AsyncSettings settings) {
+    if (async_sender_) {
+        return "Async sends are already enabled";
+    }
+
+    if (not stub_) {
+        return "";
+    }
+
+    proto::Scene::Stub* stub = stub_.get();
+
+    auto send_request = [stub](const proto::SceneUpdateRequest& request) -> proto::Errors {
+        grpc::ClientContext context;
+        proto::Errors errors;
+
+        grpc::Status status = stub->UpdateScene(&context, request, &errors);
+
+        if (not status.ok()) {
+            errors.set_error_msg(status.error_message());
+        }
+        return errors;
+    };
+
+    auto send_batch = [stub](const proto::SceneUpdateRequestBatch& batch) -> std::vector<proto::Errors> {
+        grpc::ClientContext context;
+        proto::BatchErrors batch_errors;
+
+        grpc::Status status = stub->UpdateSceneBatch(&context, batch, &batch_errors);
+
+        if (not status.ok()) {
+            proto::Errors errors;
+            errors.set_error_msg(status.error_message());
+            return {errors};
+        }
+        return {batch_errors.errors().begin(), batch_errors.errors().end()};
+    };
+
+    async_sender_ = std::unique_ptr<AsyncSender>(new AsyncSender(send_request, std::move(settings), send_batch));
+    return "";
+}
+
+void GeometryLogger::flush() {
+    if (async_sender_) {
+        async_sender_->flush();
+    }
+}
+
 std::string GeometryLogger::generate_uuid() const {
     return xg::newGuid().str();
 }
 
 std::string GeometryLogger::clear_all_items() {
-    if (stub_) {
+    if (async_sender_) {
+        proto::SceneUpdateRequest update;
+        update.mutable_clear_all();
+        async_sender_->enqueue("", std::move(update));
+
+    } else if (stub_) {
         proto::SceneUpdateRequest update;
         update.mutable_clear_all();
 
@@ -59,11 +111,41 @@ std::string GeometryLogger::clear_all_items() {
     return "";
 }
 
+std::string GeometryLogger::send_transforms(const std::vector<std::uint32_t>& handles,
+                                            const std::vector<float>& transformations) {
+    if (not stub_) {
+        return "";
+    }
+
+    if (async_sender_) {
+        // Queued behind earlier item requests so they can't overwrite the newer matrices
+        proto::SceneUpdateRequest update;
+        *update.mutable_transforms()->mutable_handles() = {handles.begin(), handles.end()};
+        *update.mutable_transforms()->mutable_transformations() = {transformations.begin(), transformations.end()};
+        async_sender_->enqueue("", std::move(update));
+        return "";
+    }
+
+    proto::TransformBatch batch;
+    *batch.mutable_handles() = {handles.begin(), handles.end()};
+    *batch.mutable_transformations() = {transformations.begin(), transformations.end()};
+
+    grpc::ClientContext context;
+    proto::Errors errors;
+
+    grpc::Status status = stub_->UpdateTransforms(&context, batch, &errors);
+
+    if (not status.ok()) {
+        return status.error_message();
+    }
+    return errors.error_msg();
+}
+
 GeometryItemStream GeometryLogger::item_stream(const std::string& id) const {
     if (id.empty()) {
-        return GeometryItemStream(generate_uuid(), stub_.get());
+        return GeometryItemStream(generate_uuid(), stub_.get(), async_sender_.get());
     }
-    return GeometryItemStream(id, stub_.get());
+    return GeometryItemStream(id, stub_.get(), async_sender_.get());
 }
 
 } // namespace log
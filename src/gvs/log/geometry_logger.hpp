@@ -23,6 +23,7 @@
 #pragma once
 
 // project
+#include "gvs/log/async_sender.hpp"
 #include "gvs/log/geometry_item_stream.hpp"
 
 // third party
@@ -48,14 +49,58 @@ public:
 
     bool connected() const;
 
+    /// \brief Send requests from a background thread so streams never wait on the server
+    ///
+    ///        Only affects streams created after this call. Errors are no longer stored in each
+    ///        stream's 'error_message()' and are instead reported through
+    ///        'GeometryItemStream::last_result()' and 'settings.on_error'.
+    ///
+    ///        Can only be enabled once since existing streams keep using the first sender. Returns
+    ///        an error message (and changes nothing) if async sends are already enabled.
+    ///
+    ///     ```cpp
+    ///     gvs::log::AsyncSettings settings;
+    ///     settings.queue_full_policy = gvs::log::QueueFullPolicy::coalesce;
+    ///     settings.on_error = [](const std::string& id, const std::string& error) { std::cerr << error; };
+    ///     settings.max_batch_size = 64;
+    ///     settings.max_batch_delay = 5ms;
+    ///
+    ///     gvs::log::GeometryLogger scene("localhost:50055", 3s);
+    ///     scene.enable_async_sends(settings);
+    ///     ```
+    std::string enable_async_sends(AsyncSettings settings = AsyncSettings());
+
+    /// \brief Send any partially filled batches and block until all requests queued by async streams have been sent
+    void flush();
+
     std::string generate_uuid() const;
 
+    /// \brief Returns an error message if the request failed. Always returns an empty
+    ///        string when sending asynchronously.
     std::string clear_all_items();
     GeometryItemStream item_stream(const std::string& id = "") const;
 
+    /// \brief Sets the transformations of many items in one small message. Much cheaper than sending
+    ///        a display update per item when animating large numbers of items.
+    ///
+    ///        'transformations' holds 16 column major floats for each handle (see
+    ///        'GeometryItemStream::handle()'). When sending asynchronously the transforms are queued
+    ///        behind earlier stream requests, errors are reported through 'AsyncSettings::on_error',
+    ///        and an empty string is always returned. Otherwise returns an error message if the
+    ///        request failed.
+    ///
+    ///     ```cpp
+    ///     std::vector<std::uint32_t> handles; // one per robot link
+    ///     std::vector<float> transformations; // 16 floats per link, updated every step
+    ///
+    ///     std::string error = scene.send_transforms(handles, transformations);
+    ///     ```
+    std::string send_transforms(const std::vector<std::uint32_t>& handles, const std::vector<float>& transformations);
+
 private:
     std::shared_ptr<grpc::Channel> channel_;
     std::unique_ptr<proto::Scene::Stub> stub_;
+    std::unique_ptr<AsyncSender> async_sender_; ///< null unless sending asynchronously
 };
 
 template <typename Rep, typename Period>
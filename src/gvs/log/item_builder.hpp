@@ -0,0 +1,165 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#if __cplusplus >= 201703L
+
+// project
+#include "gvs/log/log_params.hpp"
+
+// standard
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace gvs {
+
+namespace detail {
+
+template <typename... Params>
+constexpr bool fields_are_unique() {
+    std::uint32_t combined = 0;
+    for (std::uint32_t param_fields : {std::uint32_t(0), Params::fields...}) {
+        if (combined & param_fields) {
+            return false;
+        }
+        combined |= param_fields;
+    }
+    return true;
+}
+
+inline std::uint32_t fields_set_in(const proto::SceneItemInfo& info) {
+    const proto::GeometryInfo3D& geometry = info.geometry_info();
+    const proto::DisplayInfo& display = info.display_info();
+
+    std::uint32_t set = 0;
+    set |= (geometry.has_positions() ? field::positions : 0u);
+    set |= (geometry.has_normals() ? field::normals : 0u);
+    set |= (geometry.has_tex_coords() ? field::tex_coords : 0u);
+    set |= (geometry.has_vertex_colors() ? field::vertex_colors : 0u);
+    set |= (geometry.has_indices() ? field::indices : 0u);
+    set |= (display.has_geometry_format() ? field::geometry_format : 0u);
+    set |= (display.has_coloring() ? field::coloring : 0u);
+    set |= (info.has_parent() ? field::parent : 0u);
+    set |= (display.has_shading() ? field::shading : 0u);
+    set |= (display.has_transformation() ? field::transformation : 0u);
+    set |= (display.has_uniform_color() ? field::uniform_color : 0u);
+    set |= (geometry.has_interleaved_vertices() ? field::interleaved_vertices : 0u);
+    set |= (geometry.has_instance_transformations() ? field::instance_transformations : 0u);
+    set |= (geometry.has_instance_colors() ? field::instance_colors : 0u);
+    set |= (geometry.point_cloud() ? field::point_cloud : 0u);
+    return set;
+}
+
+/// \brief The names of the params that set 'fields', separated by commas
+inline std::string field_names(std::uint32_t fields) {
+    constexpr std::pair<std::uint32_t, const char*> names[] = {
+        {field::positions, "positions_3d"},
+        {field::normals, "normals_3d"},
+        {field::tex_coords, "tex_coords_3d"},
+        {field::vertex_colors, "vertex_colors_3d"},
+        {field::indices, "indices"},
+        {field::geometry_format, "geometry_format"},
+        {field::coloring, "coloring"},
+        {field::parent, "parent"},
+        {field::shading, "shading"},
+        {field::transformation, "transformation"},
+        {field::uniform_color, "uniform_color"},
+        {field::interleaved_vertices, "interleaved_vertices"},
+        {field::instance_transformations, "instance_transformations"},
+        {field::instance_colors, "instance_colors"},
+        {field::point_cloud, "point_cloud"},
+    };
+
+    std::string result;
+    for (const auto& name : names) {
+        if (fields & name.first) {
+            result += (result.empty() ? "" : ", ");
+            result += name.second;
+        }
+    }
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief Combines item params into a single type where every param sets different fields.
+ *
+ * Setting a field twice fails to compile and applying the builder writes each param directly
+ * into the item without heap allocations, type erasure, or "already set" checks for each param.
+ *
+ *     ```cpp
+ *     stream << gvs::item(gvs::positions_3d(points), gvs::triangles(indices), gvs::uniform_color(color))
+ *            << gvs::send;
+ *
+ *     // or
+ *     auto builder = gvs::item() << gvs::positions_3d(points) << gvs::triangles(indices);
+ *     stream << std::move(builder) << gvs::send;
+ *     ```
+ */
+template <typename... Params>
+class ItemBuilder {
+public:
+    static constexpr std::uint32_t fields = (std::uint32_t(0) | ... | Params::fields);
+
+    explicit ItemBuilder(std::tuple<Params...> params) : params_(std::move(params)) {}
+
+    /// \brief Returns a new builder that also sets the fields in 'param'
+    template <typename Param>
+    ItemBuilder<Params..., std::decay_t<Param>> operator<<(Param&& param) && {
+        static_assert((fields & std::decay_t<Param>::fields) == 0, "An item field is set more than once");
+
+        return ItemBuilder<Params..., std::decay_t<Param>>(
+            std::tuple_cat(std::move(params_), std::make_tuple(std::forward<Param>(param))));
+    }
+
+    /// \brief Writes every param into 'info' without checking for fields that are already set
+    void write(proto::SceneItemInfo* info) const {
+        std::apply([info](const auto&... params) { (params.write(info), ...); }, params_);
+    }
+
+    /// \brief Allows the builder to be passed to 'GeometryItemStream::operator<<'.
+    ///        Fails (naming the overlapping fields) if the stream already has any of the builder's fields.
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (std::uint32_t already_set = detail::fields_set_in(*info) & fields) {
+            return "A field from gvs::item (" + detail::field_names(already_set) + ")";
+        }
+        write(info);
+        return "";
+    }
+
+private:
+    std::tuple<Params...> params_;
+};
+
+template <typename... Params>
+ItemBuilder<std::decay_t<Params>...> item(Params&&... params) {
+    static_assert(detail::fields_are_unique<std::decay_t<Params>...>(), "An item field is set more than once");
+    return ItemBuilder<std::decay_t<Params>...>(std::make_tuple(std::forward<Params>(params)...));
+}
+
+} // namespace gvs
+
+#endif
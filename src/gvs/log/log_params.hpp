@@ -27,8 +27,14 @@
 #include <types.pb.h>
 
 // standard
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 template <typename C>
@@ -53,125 +59,364 @@ const float* data_ptr(const T& t) {
 
 namespace gvs {
 
-inline auto positions_3d(const std::vector<float>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_positions()) {
-            return "positions_3d";
-        }
-        *(info->mutable_geometry_info()->mutable_positions()->mutable_value()) = {data.begin(), data.end()};
-        return "";
-    };
+struct UniformColorShading {
+    explicit UniformColorShading() = default;
+};
+
+struct LambertianShading {
+    std::array<float, 3> light_direction;
+    std::array<float, 3> light_color;
+    std::array<float, 3> ambient_color;
+
+    explicit LambertianShading(std::array<float, 3> light_dir = {-1.f, -1.f, -1.f},
+                               std::array<float, 3> light_colour = {1.f, 1.f, 1.f},
+                               std::array<float, 3> ambient_colour = {0.15f, 0.15f, 0.15f})
+        : light_direction(light_dir), light_color(light_colour), ambient_color(ambient_colour) {}
+};
+
+/// \brief Where an attribute is stored in each vertex of an interleaved buffer
+struct VertexAttributeLayout {
+    proto::VertexAttribute attribute;
+    std::size_t offset; ///< bytes from the start of the vertex (usually 'offsetof(Vertex, member)')
+    proto::VertexAttributeType type;
+};
+
+inline VertexAttributeLayout vertex_attribute(proto::VertexAttribute attribute,
+                                              std::size_t offset,
+                                              proto::VertexAttributeType type = proto::FLOAT32) {
+    return VertexAttributeLayout{attribute, offset, type};
 }
 
-inline auto normals_3d(const std::vector<float>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_normals()) {
-            return "normals_3d";
-        }
-        *(info->mutable_geometry_info()->mutable_normals()->mutable_value()) = {data.begin(), data.end()};
-        return "";
-    };
+namespace detail {
+
+/// \brief Flags for the item fields set by each param. Used by 'gvs::item' to reject duplicate fields at compile time.
+namespace field {
+constexpr std::uint32_t positions = 1u << 0u;
+constexpr std::uint32_t normals = 1u << 1u;
+constexpr std::uint32_t tex_coords = 1u << 2u;
+constexpr std::uint32_t vertex_colors = 1u << 3u;
+constexpr std::uint32_t indices = 1u << 4u;
+constexpr std::uint32_t geometry_format = 1u << 5u;
+constexpr std::uint32_t coloring = 1u << 6u;
+constexpr std::uint32_t parent = 1u << 7u;
+constexpr std::uint32_t shading = 1u << 8u;
+constexpr std::uint32_t transformation = 1u << 9u;
+constexpr std::uint32_t uniform_color = 1u << 10u;
+constexpr std::uint32_t interleaved_vertices = 1u << 11u;
+constexpr std::uint32_t instance_transformations = 1u << 12u;
+constexpr std::uint32_t instance_colors = 1u << 13u;
+constexpr std::uint32_t point_cloud = 1u << 14u;
+} // namespace field
+
+inline bool host_is_little_endian() {
+    const std::uint32_t one = 1u;
+    unsigned char first_byte;
+    std::memcpy(&first_byte, &one, 1);
+    return first_byte == 1u;
 }
 
-inline auto tex_coords_3d(const std::vector<float>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_tex_coords()) {
-            return "tex_coords_3d";
+/// \brief Borrows an lvalue buffer or takes ownership of an rvalue buffer.
+///
+///        The data is copied exactly once: directly into the proto when the param is applied to a
+///        stream. Borrowed buffers must outlive the param, which is normally applied right away
+///        (`stream << gvs::positions_3d(data)`).
+template <typename Element, typename Container>
+class BufferParam {
+public:
+    explicit BufferParam(const Container& data) : begin_(elements(data)), end_(begin_ + count(data)) {}
+
+    // Moving a vector keeps its heap buffer so 'begin_' and 'end_' stay valid
+    explicit BufferParam(Container&& data)
+        : owned_(std::move(data)), begin_(elements(owned_)), end_(begin_ + count(owned_)) {}
+
+    BufferParam(BufferParam&&) = default;
+    BufferParam(const BufferParam&) = delete;
+    BufferParam& operator=(const BufferParam&) = delete;
+    BufferParam& operator=(BufferParam&&) = delete;
+
+    /// \brief Stores the buffer as raw little-endian bytes so the receiver can use it without decoding
+    ///        each element. Falls back to the repeated values on big-endian hosts.
+    template <typename List>
+    void copy_to(List* list) const {
+        if (host_is_little_endian()) {
+            copy_bytes_to(list->mutable_data());
+        } else {
+            *list->mutable_value() = {begin_, end_};
         }
-        *(info->mutable_geometry_info()->mutable_tex_coords()->mutable_value()) = {data.begin(), data.end()};
-        return "";
-    };
-}
+    }
+
+    void copy_bytes_to(std::string* bytes) const {
+        bytes->assign(reinterpret_cast<const char*>(begin_), reinterpret_cast<const char*>(end_));
+    }
+
+private:
+    Container owned_; ///< Empty if the buffer is borrowed
+    const Element* begin_;
+    const Element* end_;
+
+    static const Element* elements(const Container& data) { return reinterpret_cast<const Element*>(data.data()); }
+
+    static std::size_t count(const Container& data) {
+        return data.size() * sizeof(typename Container::value_type) / sizeof(Element);
+    }
+};
+
+/*
+ * Geometry fields that can be set by a GeometryParam
+ */
+struct Positions {
+    static constexpr std::uint32_t fields = field::positions;
+    static const char* name() { return "positions_3d"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_positions(); }
+    static proto::FloatList* list(proto::SceneItemInfo* info) {
+        return info->mutable_geometry_info()->mutable_positions();
+    }
+};
+
+struct Normals {
+    static constexpr std::uint32_t fields = field::normals;
+    static const char* name() { return "normals_3d"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_normals(); }
+    static proto::FloatList* list(proto::SceneItemInfo* info) {
+        return info->mutable_geometry_info()->mutable_normals();
+    }
+};
+
+struct TexCoords {
+    static constexpr std::uint32_t fields = field::tex_coords;
+    static const char* name() { return "tex_coords_3d"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_tex_coords(); }
+    static proto::FloatList* list(proto::SceneItemInfo* info) {
+        return info->mutable_geometry_info()->mutable_tex_coords();
+    }
+};
+
+struct VertexColors {
+    static constexpr std::uint32_t fields = field::vertex_colors;
+    static const char* name() { return "vertex_colors_3d"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_vertex_colors(); }
+    static proto::FloatList* list(proto::SceneItemInfo* info) {
+        return info->mutable_geometry_info()->mutable_vertex_colors();
+    }
+};
+
+struct InstanceTransformations {
+    static constexpr std::uint32_t fields = field::instance_transformations;
+    static const char* name() { return "instance_transformations"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_instance_transformations(); }
+    static proto::FloatList* list(proto::SceneItemInfo* info) {
+        return info->mutable_geometry_info()->mutable_instance_transformations();
+    }
+};
+
+struct InstanceColors {
+    static constexpr std::uint32_t fields = field::instance_colors;
+    static const char* name() { return "instance_colors"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_instance_colors(); }
+    static proto::FloatList* list(proto::SceneItemInfo* info) {
+        return info->mutable_geometry_info()->mutable_instance_colors();
+    }
+};
+
+template <proto::GeometryFormat format>
+struct Indices {
+    static constexpr std::uint32_t fields = field::indices | field::geometry_format;
+    static const char* name() { return "indices"; }
+    static bool is_set(const proto::GeometryInfo3D& geometry) { return geometry.has_indices(); }
+    static proto::UIntList* list(proto::SceneItemInfo* info) {
+        info->mutable_display_info()->mutable_geometry_format()->set_value(format);
+        return info->mutable_geometry_info()->mutable_indices();
+    }
+};
 
-inline auto vertex_colors_3d(const std::vector<float>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_vertex_colors()) {
-            return "vertex_colors_3d";
+/// \brief Copies a borrowed or owned buffer into a geometry field when applied to a stream
+template <typename Field, typename Element, typename Container>
+class GeometryParam {
+public:
+    static constexpr std::uint32_t fields = Field::fields;
+
+    explicit GeometryParam(BufferParam<Element, Container> buffer) : buffer_(std::move(buffer)) {}
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (Field::is_set(info->geometry_info())) {
+            return Field::name();
         }
-        *(info->mutable_geometry_info()->mutable_vertex_colors()->mutable_value()) = {data.begin(), data.end()};
+        write(info);
         return "";
-    };
+    }
+
+    void write(proto::SceneItemInfo* info) const { buffer_.copy_to(Field::list(info)); }
+
+private:
+    BufferParam<Element, Container> buffer_;
+};
+
+template <typename Field, typename Element, typename Container>
+GeometryParam<Field, Element, Container> borrow(const Container& data) {
+    return GeometryParam<Field, Element, Container>(BufferParam<Element, Container>(data));
 }
 
-template <proto::GeometryFormat format>
-auto indices(const std::vector<unsigned>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_indices()) {
-            return "indices";
+template <typename Field, typename Element, typename Container>
+GeometryParam<Field, Element, Container> take(Container&& data) {
+    return GeometryParam<Field, Element, Container>(BufferParam<Element, Container>(std::move(data)));
+}
+
+/// \brief Copies a borrowed or owned array of vertex structs into the interleaved vertices when applied to a stream
+template <typename Container>
+class InterleavedVerticesParam {
+public:
+    static constexpr std::uint32_t fields = field::interleaved_vertices;
+
+    InterleavedVerticesParam(BufferParam<char, Container> buffer, std::vector<VertexAttributeLayout> layout)
+        : buffer_(std::move(buffer)), layout_(std::move(layout)) {}
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->geometry_info().has_interleaved_vertices()) {
+            return "interleaved_vertices";
         }
-        *(info->mutable_geometry_info()->mutable_indices()->mutable_value()) = {data.begin(), data.end()};
-        info->mutable_display_info()->mutable_geometry_format()->set_value(format);
+        write(info);
         return "";
-    };
+    }
+
+    void write(proto::SceneItemInfo* info) const {
+        proto::InterleavedVertices* vertices = info->mutable_geometry_info()->mutable_interleaved_vertices();
+        buffer_.copy_bytes_to(vertices->mutable_data());
+        vertices->set_stride(static_cast<std::uint32_t>(sizeof(typename Container::value_type)));
+
+        for (const VertexAttributeLayout& layout : layout_) {
+            proto::VertexAttributeLayout* attribute = vertices->add_attributes();
+            attribute->set_attribute(layout.attribute);
+            attribute->set_offset(static_cast<std::uint32_t>(layout.offset));
+            attribute->set_type(layout.type);
+        }
+    }
+
+private:
+    BufferParam<char, Container> buffer_;
+    std::vector<VertexAttributeLayout> layout_;
+};
+
+template <typename Vertex>
+void check_vertex_type() {
+    static_assert(std::is_trivially_copyable<Vertex>::value, "vertices must be trivially copyable structs");
+}
+
+template <typename T>
+void check_float_pointer_convertible() {
+    static_assert(std::is_same<const float*, decltype(data_ptr(std::declval<T>()))>::value,
+                  "data must be convertible to a const float*");
 }
 
-constexpr auto points = indices<proto::GeometryFormat::POINTS>;
-constexpr auto lines = indices<proto::GeometryFormat::LINES>;
-constexpr auto line_strip = indices<proto::GeometryFormat::LINE_STRIP>;
-constexpr auto triangles = indices<proto::GeometryFormat::TRIANGLES>;
-constexpr auto triangle_strip = indices<proto::GeometryFormat::TRIANGLE_STRIP>;
-constexpr auto triangle_fan = indices<proto::GeometryFormat::TRIANGLE_FAN>;
+template <proto::GeometryFormat format>
+struct IndicesBuilder {
+    GeometryParam<Indices<format>, unsigned, std::vector<unsigned>>
+    operator()(const std::vector<unsigned>& data) const {
+        return borrow<Indices<format>, unsigned>(data);
+    }
+
+    GeometryParam<Indices<format>, unsigned, std::vector<unsigned>> operator()(std::vector<unsigned>&& data) const {
+        return take<Indices<format>, unsigned>(std::move(data));
+    }
+};
+
+struct GeometryFormatParam {
+    static constexpr std::uint32_t fields = field::geometry_format;
+
+    proto::GeometryFormat format;
 
-inline auto geometry_format(const proto::GeometryFormat& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_display_info()->has_geometry_format()) {
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->display_info().has_geometry_format()) {
             return "geometry_format";
         }
-        info->mutable_display_info()->mutable_geometry_format()->set_value(data);
+        write(info);
         return "";
-    };
-}
+    }
+
+    void write(proto::SceneItemInfo* info) const {
+        info->mutable_display_info()->mutable_geometry_format()->set_value(format);
+    }
+};
+
+struct ColoringParam {
+    static constexpr std::uint32_t fields = field::coloring;
+
+    proto::Coloring coloring;
 
-inline auto coloring(const proto::Coloring& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_display_info()->has_coloring()) {
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->display_info().has_coloring()) {
             return "coloring";
         }
-        info->mutable_display_info()->mutable_coloring()->set_value(data);
+        write(info);
         return "";
-    };
-}
+    }
 
-inline auto parent(const std::string& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->has_parent()) {
-            return "parent";
+    void write(proto::SceneItemInfo* info) const {
+        info->mutable_display_info()->mutable_coloring()->set_value(coloring);
+    }
+};
+
+struct PointCloudParam {
+    static constexpr std::uint32_t fields = field::point_cloud;
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->geometry_info().point_cloud()) {
+            return "point_cloud";
         }
-        info->mutable_parent()->set_value(data);
+        write(info);
         return "";
-    };
-}
+    }
 
-struct UniformColorShading {
-    explicit UniformColorShading() = default;
+    void write(proto::SceneItemInfo* info) const { info->mutable_geometry_info()->set_point_cloud(true); }
 };
 
-struct LambertianShading {
-    std::array<float, 3> light_direction;
-    std::array<float, 3> light_color;
-    std::array<float, 3> ambient_color;
+struct ParentParam {
+    static constexpr std::uint32_t fields = field::parent;
 
-    explicit LambertianShading(std::array<float, 3> light_dir = {-1.f, -1.f, -1.f},
-                               std::array<float, 3> light_colour = {1.f, 1.f, 1.f},
-                               std::array<float, 3> ambient_colour = {0.15f, 0.15f, 0.15f})
-        : light_direction(light_dir), light_color(light_colour), ambient_color(ambient_colour) {}
+    std::string parent;
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->has_parent()) {
+            return "parent";
+        }
+        write(info);
+        return "";
+    }
+
+    void write(proto::SceneItemInfo* info) const {
+        info->mutable_parent()->set_value(parent);
+    }
 };
 
-inline auto shading(const UniformColorShading&) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [](proto::SceneItemInfo* info) {
-        if (info->mutable_display_info()->has_shading()) {
+struct UniformColorShadingParam {
+    static constexpr std::uint32_t fields = field::shading;
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->display_info().has_shading()) {
             return "shading";
         }
-        info->mutable_display_info()->mutable_shading()->uniform_color();
+        write(info);
         return "";
-    };
-}
+    }
+
+    void write(proto::SceneItemInfo* info) const {
+        info->mutable_display_info()->mutable_shading()->mutable_uniform_color();
+    }
+};
+
+struct LambertianShadingParam {
+    static constexpr std::uint32_t fields = field::shading;
 
-inline auto shading(const LambertianShading& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_display_info()->has_shading()) {
+    LambertianShading data;
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->display_info().has_shading()) {
             return "shading";
         }
+        write(info);
+        return "";
+    }
+
+    void write(proto::SceneItemInfo* info) const {
         proto::LambertianShading* shading = info->mutable_display_info()->mutable_shading()->mutable_lambertian();
         shading->mutable_light_direction()->set_x(data.light_direction[0]);
         shading->mutable_light_direction()->set_y(data.light_direction[1]);
@@ -184,95 +429,274 @@ inline auto shading(const LambertianShading& data) -> std::function<std::string(
         shading->mutable_ambient_color()->set_x(data.ambient_color[0]);
         shading->mutable_ambient_color()->set_y(data.ambient_color[1]);
         shading->mutable_ambient_color()->set_z(data.ambient_color[2]);
+    }
+};
+
+struct TransformationParam {
+    static constexpr std::uint32_t fields = field::transformation;
+
+    std::array<float, 16> data;
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->display_info().has_transformation()) {
+            return "transformation";
+        }
+        write(info);
+        return "";
+    }
+
+    void write(proto::SceneItemInfo* info) const {
+        *(info->mutable_display_info()->mutable_transformation()->mutable_data()) = {data.begin(), data.end()};
+    }
+};
+
+struct UniformColorParam {
+    static constexpr std::uint32_t fields = field::uniform_color;
+
+    std::array<float, 3> data;
+
+    std::string operator()(proto::SceneItemInfo* info) const {
+        if (info->display_info().has_uniform_color()) {
+            return "uniform_color";
+        }
+        write(info);
         return "";
-    };
+    }
+
+    void write(proto::SceneItemInfo* info) const {
+        proto::Vec3* uniform_color = info->mutable_display_info()->mutable_uniform_color();
+        uniform_color->set_x(data[0]);
+        uniform_color->set_y(data[1]);
+        uniform_color->set_z(data[2]);
+    }
+};
+
+} // namespace detail
+
+/*
+ * Geometry params borrow lvalue buffers and take ownership of rvalue buffers. Either way the
+ * data is only copied once, directly into the proto, when the param is applied to a stream.
+ */
+inline detail::GeometryParam<detail::Positions, float, std::vector<float>>
+positions_3d(const std::vector<float>& data) {
+    return detail::borrow<detail::Positions, float>(data);
+}
+
+inline detail::GeometryParam<detail::Positions, float, std::vector<float>> positions_3d(std::vector<float>&& data) {
+    return detail::take<detail::Positions, float>(std::move(data));
+}
+
+inline detail::GeometryParam<detail::Normals, float, std::vector<float>> normals_3d(const std::vector<float>& data) {
+    return detail::borrow<detail::Normals, float>(data);
+}
+
+inline detail::GeometryParam<detail::Normals, float, std::vector<float>> normals_3d(std::vector<float>&& data) {
+    return detail::take<detail::Normals, float>(std::move(data));
+}
+
+inline detail::GeometryParam<detail::TexCoords, float, std::vector<float>>
+tex_coords_3d(const std::vector<float>& data) {
+    return detail::borrow<detail::TexCoords, float>(data);
+}
+
+inline detail::GeometryParam<detail::TexCoords, float, std::vector<float>> tex_coords_3d(std::vector<float>&& data) {
+    return detail::take<detail::TexCoords, float>(std::move(data));
+}
+
+inline detail::GeometryParam<detail::VertexColors, float, std::vector<float>>
+vertex_colors_3d(const std::vector<float>& data) {
+    return detail::borrow<detail::VertexColors, float>(data);
+}
+
+inline detail::GeometryParam<detail::VertexColors, float, std::vector<float>>
+vertex_colors_3d(std::vector<float>&& data) {
+    return detail::take<detail::VertexColors, float>(std::move(data));
+}
+
+/*
+ * Instanced geometry is drawn once per transformation (16 column major floats each, applied
+ * before the item's transformation) with a single draw call. Instance colors are optional and
+ * replace the uniform color.
+ */
+inline detail::GeometryParam<detail::InstanceTransformations, float, std::vector<float>>
+instance_transformations(const std::vector<float>& data) {
+    return detail::borrow<detail::InstanceTransformations, float>(data);
+}
+
+inline detail::GeometryParam<detail::InstanceTransformations, float, std::vector<float>>
+instance_transformations(std::vector<float>&& data) {
+    return detail::take<detail::InstanceTransformations, float>(std::move(data));
+}
+
+inline detail::GeometryParam<detail::InstanceColors, float, std::vector<float>>
+instance_colors(const std::vector<float>& data) {
+    return detail::borrow<detail::InstanceColors, float>(data);
+}
+
+inline detail::GeometryParam<detail::InstanceColors, float, std::vector<float>>
+instance_colors(std::vector<float>&& data) {
+    return detail::take<detail::InstanceColors, float>(std::move(data));
+}
+
+template <proto::GeometryFormat format>
+detail::GeometryParam<detail::Indices<format>, unsigned, std::vector<unsigned>>
+indices(const std::vector<unsigned>& data) {
+    return detail::borrow<detail::Indices<format>, unsigned>(data);
+}
+
+template <proto::GeometryFormat format>
+detail::GeometryParam<detail::Indices<format>, unsigned, std::vector<unsigned>> indices(std::vector<unsigned>&& data) {
+    return detail::take<detail::Indices<format>, unsigned>(std::move(data));
+}
+
+constexpr detail::IndicesBuilder<proto::GeometryFormat::POINTS> points{};
+constexpr detail::IndicesBuilder<proto::GeometryFormat::LINES> lines{};
+constexpr detail::IndicesBuilder<proto::GeometryFormat::LINE_STRIP> line_strip{};
+constexpr detail::IndicesBuilder<proto::GeometryFormat::TRIANGLES> triangles{};
+constexpr detail::IndicesBuilder<proto::GeometryFormat::TRIANGLE_STRIP> triangle_strip{};
+constexpr detail::IndicesBuilder<proto::GeometryFormat::TRIANGLE_FAN> triangle_fan{};
+
+inline detail::GeometryFormatParam geometry_format(const proto::GeometryFormat& data) {
+    return detail::GeometryFormatParam{data};
+}
+
+inline detail::ColoringParam coloring(const proto::Coloring& data) {
+    return detail::ColoringParam{data};
+}
+
+/// \brief Draws the positions as a point cloud. The viewer builds an octree and draws the most
+///        important points within a per-frame budget, adding detail while the camera is still.
+inline detail::PointCloudParam point_cloud() {
+    return detail::PointCloudParam{};
+}
+
+inline detail::ParentParam parent(const std::string& data) {
+    return detail::ParentParam{data};
+}
+
+inline detail::UniformColorShadingParam shading(const UniformColorShading&) {
+    return detail::UniformColorShadingParam{};
+}
+
+inline detail::LambertianShadingParam shading(const LambertianShading& data) {
+    return detail::LambertianShadingParam{data};
 }
 
 template <typename Vec3 = std::array<float, 3>>
-inline auto positions_3d(const std::vector<Vec3>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_positions()) {
-            return "positions_3d";
-        }
-        static_assert(std::is_same<const float*, decltype(data_ptr(std::declval<Vec3>()))>::value,
-                      "data must be convertible to a const float*");
+detail::GeometryParam<detail::Positions, float, std::vector<Vec3>> positions_3d(const std::vector<Vec3>& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::borrow<detail::Positions, float>(data);
+}
 
-        *(info->mutable_geometry_info()->mutable_positions()->mutable_value())
-            = {reinterpret_cast<const float*>(data.data()), reinterpret_cast<const float*>(data.data() + data.size())};
-        return "";
-    };
+template <typename Vec3 = std::array<float, 3>>
+detail::GeometryParam<detail::Positions, float, std::vector<Vec3>> positions_3d(std::vector<Vec3>&& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::take<detail::Positions, float>(std::move(data));
 }
 
 template <typename Vec3 = std::array<float, 3>>
-inline auto normals_3d(const std::vector<Vec3>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_normals()) {
-            return "normals_3d";
-        }
-        static_assert(std::is_same<const float*, decltype(data_ptr(std::declval<Vec3>()))>::value,
-                      "data must be convertible to a const float*");
+detail::GeometryParam<detail::Normals, float, std::vector<Vec3>> normals_3d(const std::vector<Vec3>& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::borrow<detail::Normals, float>(data);
+}
 
-        *(info->mutable_geometry_info()->mutable_normals()->mutable_value())
-            = {reinterpret_cast<const float*>(data.data()), reinterpret_cast<const float*>(data.data() + data.size())};
-        return "";
-    };
+template <typename Vec3 = std::array<float, 3>>
+detail::GeometryParam<detail::Normals, float, std::vector<Vec3>> normals_3d(std::vector<Vec3>&& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::take<detail::Normals, float>(std::move(data));
 }
 
 template <typename Vec2 = std::array<float, 2>>
-inline auto tex_coords_3d(const std::vector<Vec2>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_tex_coords()) {
-            return "tex_coords_3d";
-        }
-        static_assert(std::is_same<const float*, decltype(data_ptr(std::declval<Vec2>()))>::value,
-                      "data must be convertible to a const float*");
+detail::GeometryParam<detail::TexCoords, float, std::vector<Vec2>> tex_coords_3d(const std::vector<Vec2>& data) {
+    detail::check_float_pointer_convertible<Vec2>();
+    return detail::borrow<detail::TexCoords, float>(data);
+}
 
-        *(info->mutable_geometry_info()->mutable_tex_coords()->mutable_value())
-            = {reinterpret_cast<const float*>(data.data()), reinterpret_cast<const float*>(data.data() + data.size())};
-        return "";
-    };
+template <typename Vec2 = std::array<float, 2>>
+detail::GeometryParam<detail::TexCoords, float, std::vector<Vec2>> tex_coords_3d(std::vector<Vec2>&& data) {
+    detail::check_float_pointer_convertible<Vec2>();
+    return detail::take<detail::TexCoords, float>(std::move(data));
 }
 
 template <typename Vec3 = std::array<float, 3>>
-inline auto vertex_colors_3d(const std::vector<Vec3>& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_geometry_info()->has_vertex_colors()) {
-            return "vertex_colors_3d";
-        }
-        static_assert(std::is_same<const float*, decltype(data_ptr(std::declval<Vec3>()))>::value,
-                      "data must be convertible to a const float*");
+detail::GeometryParam<detail::VertexColors, float, std::vector<Vec3>>
+vertex_colors_3d(const std::vector<Vec3>& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::borrow<detail::VertexColors, float>(data);
+}
 
-        *(info->mutable_geometry_info()->mutable_vertex_colors()->mutable_value())
-            = {reinterpret_cast<const float*>(data.data()), reinterpret_cast<const float*>(data.data() + data.size())};
-        return "";
-    };
+template <typename Vec3 = std::array<float, 3>>
+detail::GeometryParam<detail::VertexColors, float, std::vector<Vec3>> vertex_colors_3d(std::vector<Vec3>&& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::take<detail::VertexColors, float>(std::move(data));
 }
 
 template <typename Mat4 = std::array<float, 16>>
-auto transformation(const Mat4& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_display_info()->has_transformation()) {
-            return "transformation";
-        }
-        proto::Mat4* transformation = info->mutable_display_info()->mutable_transformation();
-        *(transformation->mutable_data()) = {data_ptr(data), data_ptr(data) + 16};
-        return "";
-    };
+detail::GeometryParam<detail::InstanceTransformations, float, std::vector<Mat4>>
+instance_transformations(const std::vector<Mat4>& data) {
+    detail::check_float_pointer_convertible<Mat4>();
+    return detail::borrow<detail::InstanceTransformations, float>(data);
+}
+
+template <typename Mat4 = std::array<float, 16>>
+detail::GeometryParam<detail::InstanceTransformations, float, std::vector<Mat4>>
+instance_transformations(std::vector<Mat4>&& data) {
+    detail::check_float_pointer_convertible<Mat4>();
+    return detail::take<detail::InstanceTransformations, float>(std::move(data));
 }
 
 template <typename Vec3 = std::array<float, 3>>
-auto uniform_color(const Vec3& data) -> std::function<std::string(proto::SceneItemInfo*)> {
-    return [data](proto::SceneItemInfo* info) {
-        if (info->mutable_display_info()->has_uniform_color()) {
-            return "uniform_color";
-        }
-        const float* data_start = data_ptr(data);
-        proto::Vec3* uniform_color = info->mutable_display_info()->mutable_uniform_color();
-        uniform_color->set_x(data_start[0]);
-        uniform_color->set_y(data_start[1]);
-        uniform_color->set_z(data_start[2]);
-        return "";
-    };
+detail::GeometryParam<detail::InstanceColors, float, std::vector<Vec3>> instance_colors(const std::vector<Vec3>& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::borrow<detail::InstanceColors, float>(data);
+}
+
+template <typename Vec3 = std::array<float, 3>>
+detail::GeometryParam<detail::InstanceColors, float, std::vector<Vec3>> instance_colors(std::vector<Vec3>&& data) {
+    detail::check_float_pointer_convertible<Vec3>();
+    return detail::take<detail::InstanceColors, float>(std::move(data));
+}
+
+/// \brief Sends an array of vertex structs as-is. The viewer uploads them without repacking.
+///
+///     ```cpp
+///     struct Vertex {
+///         float position[3];
+///         float normal[3];
+///     };
+///     std::vector<gvs::VertexAttributeLayout> layout
+///         = {gvs::vertex_attribute(gvs::proto::ATTRIBUTE_POSITION, offsetof(Vertex, position)),
+///            gvs::vertex_attribute(gvs::proto::ATTRIBUTE_NORMAL, offsetof(Vertex, normal))};
+///
+///     stream << gvs::interleaved_vertices(vertices, layout);
+///     ```
+template <typename Vertex>
+detail::InterleavedVerticesParam<std::vector<Vertex>>
+interleaved_vertices(const std::vector<Vertex>& vertices, std::vector<VertexAttributeLayout> layout) {
+    detail::check_vertex_type<Vertex>();
+    return detail::InterleavedVerticesParam<std::vector<Vertex>>(
+        detail::BufferParam<char, std::vector<Vertex>>(vertices), std::move(layout));
+}
+
+template <typename Vertex>
+detail::InterleavedVerticesParam<std::vector<Vertex>>
+interleaved_vertices(std::vector<Vertex>&& vertices, std::vector<VertexAttributeLayout> layout) {
+    detail::check_vertex_type<Vertex>();
+    return detail::InterleavedVerticesParam<std::vector<Vertex>>(
+        detail::BufferParam<char, std::vector<Vertex>>(std::move(vertices)), std::move(layout));
+}
+
+template <typename Mat4 = std::array<float, 16>>
+detail::TransformationParam transformation(const Mat4& data) {
+    detail::TransformationParam param;
+    std::copy(data_ptr(data), data_ptr(data) + 16, param.data.begin());
+    return param;
+}
+
+template <typename Vec3 = std::array<float, 3>>
+detail::UniformColorParam uniform_color(const Vec3& data) {
+    const float* data_start = data_ptr(data);
+    return detail::UniformColorParam{{{data_start[0], data_start[1], data_start[2]}}};
 }
 
 } // namespace gvs
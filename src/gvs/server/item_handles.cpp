@@ -0,0 +1,107 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "item_handles.hpp"
+
+// project
+#include "gvs/util/scene_update.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+namespace gvs::server {
+
+ItemHandles::Handle ItemHandles::assign(const std::string& id) {
+    auto iter = handles_.find(id);
+
+    if (iter != handles_.end()) {
+        return iter->second;
+    }
+
+    if (ids_.size() >= util::max_handle_slot) {
+        return null_handle;
+    }
+
+    ids_.emplace_back(id);
+    Handle handle = (generation_ << util::handle_slot_bits) | static_cast<Handle>(ids_.size());
+    handles_.emplace(id, handle);
+    return handle;
+}
+
+ItemHandles::Handle ItemHandles::handle(const std::string& id) const {
+    auto iter = handles_.find(id);
+    return iter == handles_.end() ? null_handle : iter->second;
+}
+
+const std::string* ItemHandles::id(Handle handle) const {
+    Handle slot = util::handle_slot(handle);
+
+    // Handles from before the last clear have an older generation
+    if (slot == 0u or slot > ids_.size() or (handle >> util::handle_slot_bits) != generation_) {
+        return nullptr;
+    }
+    return &ids_[slot - 1u];
+}
+
+void ItemHandles::clear() {
+    ids_.clear();
+    handles_.clear();
+    generation_ = (generation_ + 1u) & (0xFFFFFFFFu >> util::handle_slot_bits);
+}
+
+TEST_CASE("[gvs-server] stale_item_handles_are_rejected_after_clearing") {
+    ItemHandles handles;
+
+    ItemHandles::Handle a = handles.assign("a");
+    ItemHandles::Handle b = handles.assign("b");
+
+    CHECK(a != ItemHandles::null_handle);
+    CHECK(a != b);
+    CHECK(handles.assign("a") == a);
+    CHECK(handles.handle("b") == b);
+    CHECK(handles.handle("c") == ItemHandles::null_handle);
+
+    REQUIRE(handles.id(b));
+    CHECK(*handles.id(b) == "b");
+    CHECK(handles.id(ItemHandles::null_handle) == nullptr);
+    CHECK(handles.id(b + 1u) == nullptr);
+
+    handles.clear();
+    CHECK(handles.id(a) == nullptr);
+    CHECK(handles.handle("a") == ItemHandles::null_handle);
+
+    // The same id gets a new handle after clearing
+    ItemHandles::Handle new_a = handles.assign("a");
+    CHECK(new_a != a);
+    CHECK(handles.id(a) == nullptr);
+    CHECK(*handles.id(new_a) == "a");
+
+    // ...but reuses the first slot so tables indexed by slot don't grow across clears
+    CHECK(util::handle_slot(new_a) == util::handle_slot(a));
+
+    ItemHandles::Handle c = handles.assign("c");
+    CHECK(util::handle_slot(c) == util::handle_slot(b));
+    CHECK(handles.id(b) == nullptr); // same slot, older generation
+    CHECK(*handles.id(c) == "c");
+}
+
+} // namespace gvs::server
@@ -0,0 +1,65 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gvs::server {
+
+/**
+ * @brief Assigns compact integer handles to item ids so hot paths can index flat arrays instead of hashing strings.
+ *
+ * Handles are never 0 (0 means "no handle"). Their low bits are a slot (see 'util::handle_slot') that
+ * starts at 1 again after 'clear()' so arrays indexed by slot stay as small as the scene. The high bits
+ * count the clears so a stale handle held by a logger is rejected instead of silently referring to a
+ * different item. The count wraps around after 256 clears.
+ */
+class ItemHandles {
+public:
+    using Handle = std::uint32_t;
+    static constexpr Handle null_handle = 0u;
+
+    /// \brief Returns the existing handle for 'id' or assigns a new one. Returns 'null_handle' if every
+    ///        slot has been assigned since the last clear.
+    Handle assign(const std::string& id);
+
+    /// \brief The handle for 'id' or 'null_handle' if it hasn't been assigned one
+    Handle handle(const std::string& id) const;
+
+    /// \brief The id for 'handle' or null if the handle is unknown or has been cleared
+    const std::string* id(Handle handle) const;
+
+    /// \brief Invalidates every handle and frees every slot
+    void clear();
+
+private:
+    std::vector<std::string> ids_; ///< Indexed by 'slot - 1'
+    std::unordered_map<std::string, Handle> handles_;
+    Handle generation_ = 0u; ///< Stored above the slot bits of every handle assigned since the last clear
+};
+
+} // namespace gvs::server
@@ -0,0 +1,118 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "request_arena.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+namespace gvs::server {
+
+namespace {
+
+google::protobuf::ArenaOptions initial_block_options(char* initial_block, std::size_t size) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block;
+    options.initial_block_size = size;
+    return options;
+}
+
+} // namespace
+
+RequestArena::RequestArena() : arena_(initial_block_options(initial_block_.data(), initial_block_.size())) {}
+
+// The borrowed messages are never modified through the update so casting away const is safe
+proto::SceneUpdate* RequestArena::borrowing_add_update(const proto::SceneItemInfo& item) {
+    auto* update = create<proto::SceneUpdate>();
+    update->unsafe_arena_set_allocated_add_item(const_cast<proto::SceneItemInfo*>(&item));
+    return update;
+}
+
+proto::SceneUpdate* RequestArena::borrowing_update_update(const proto::SceneItemInfo& item) {
+    auto* update = create<proto::SceneUpdate>();
+    update->unsafe_arena_set_allocated_update_item(const_cast<proto::SceneItemInfo*>(&item));
+    return update;
+}
+
+proto::SceneUpdate* RequestArena::borrowing_reset_update(const proto::SceneItems& items) {
+    auto* update = create<proto::SceneUpdate>();
+    update->unsafe_arena_set_allocated_reset_all_items(const_cast<proto::SceneItems*>(&items));
+    return update;
+}
+
+proto::SceneUpdate* RequestArena::borrowing_transforms_update(const proto::TransformBatch& batch) {
+    auto* update = create<proto::SceneUpdate>();
+    update->unsafe_arena_set_allocated_transforms(const_cast<proto::TransformBatch*>(&batch));
+    return update;
+}
+
+proto::SceneItemInfo* RequestArena::borrowing_item(const proto::SceneItemInfo& item) {
+    auto* copy = create<proto::SceneItemInfo>();
+    *copy->mutable_id() = item.id();
+
+    if (item.has_parent()) {
+        *copy->mutable_parent() = item.parent();
+    }
+    if (item.has_geometry_info()) {
+        copy->unsafe_arena_set_allocated_geometry_info(const_cast<proto::GeometryInfo3D*>(&item.geometry_info()));
+    }
+    if (item.has_display_info()) {
+        copy->unsafe_arena_set_allocated_display_info(const_cast<proto::DisplayInfo*>(&item.display_info()));
+    }
+    return copy;
+}
+
+} // namespace gvs::server
+
+TEST_CASE("[gvs-server] borrowed_updates_match_copied_updates") {
+    gvs::proto::SceneItemInfo item;
+    item.mutable_id()->set_value("borrowed");
+    item.mutable_geometry_info()->mutable_positions()->add_value(1.f);
+    item.mutable_display_info()->mutable_readable_id()->set_value("Borrowed Item");
+
+    gvs::proto::SceneUpdate copied;
+    copied.mutable_add_item()->CopyFrom(item);
+
+    {
+        gvs::server::RequestArena arena;
+        gvs::proto::SceneUpdate* borrowed = arena.borrowing_add_update(item);
+
+        CHECK(&borrowed->add_item() == &item);
+        CHECK(borrowed->SerializeAsString() == copied.SerializeAsString());
+
+        // Copies of a borrowed update own their data
+        gvs::proto::SceneUpdate copy_of_borrowed = *borrowed;
+        CHECK(&copy_of_borrowed.add_item() != &item);
+    }
+
+    {
+        gvs::server::RequestArena arena;
+        gvs::proto::SceneItemInfo* borrowed = arena.borrowing_item(item);
+        borrowed->mutable_id()->set_handle(3u);
+
+        CHECK(&borrowed->geometry_info() == &item.geometry_info());
+        CHECK(item.id().handle() == 0u);
+    }
+
+    // The borrowed item is untouched when the arena is destroyed
+    CHECK(item.display_info().readable_id().value() == "Borrowed Item");
+}
@@ -0,0 +1,68 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// generated
+#include <scene.pb.h>
+
+// external
+#include <google/protobuf/arena.h>
+
+// standard
+#include <array>
+
+namespace gvs::server {
+
+/**
+ * @brief Allocates the temporary messages created while handling a single request.
+ *
+ * The first block lives inside the object (i.e. on the stack) so most requests never touch the heap.
+ */
+class RequestArena {
+public:
+    RequestArena();
+
+    template <typename Message>
+    Message* create() {
+        return google::protobuf::Arena::CreateMessage<Message>(&arena_);
+    }
+
+    /*
+     * The following updates refer to their contents instead of copying them. They must not be
+     * modified and must not outlive the messages they refer to.
+     */
+    proto::SceneUpdate* borrowing_add_update(const proto::SceneItemInfo& item);
+    proto::SceneUpdate* borrowing_update_update(const proto::SceneItemInfo& item);
+    proto::SceneUpdate* borrowing_reset_update(const proto::SceneItems& items);
+    proto::SceneUpdate* borrowing_transforms_update(const proto::TransformBatch& batch);
+
+    /// \brief A copy of 'item' that borrows the geometry and display info. The (small) id and parent
+    ///        are copied so they can be modified.
+    proto::SceneItemInfo* borrowing_item(const proto::SceneItemInfo& item);
+
+private:
+    alignas(8) std::array<char, 512> initial_block_;
+    google::protobuf::Arena arena_;
+};
+
+} // namespace gvs::server
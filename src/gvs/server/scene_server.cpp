@@ -24,16 +24,37 @@
 
 // gvs
 #include "gvs/item_defaults.hpp"
+#include "gvs/server/request_arena.hpp"
 #include "gvs/util/container_util.hpp"
+#include "gvs/util/scene_update.hpp"
+#include "gvs/util/vertex_layout.hpp"
 
 // external
 #include <doctest/doctest.h>
 #include <grpcw/server/grpc_async_server.hpp>
 
+// standard
+#include <limits>
+
 namespace gvs::server {
 
 namespace {
 
+/// \brief Sets an error and returns false if the item's interleaved vertices can't be used
+bool has_valid_geometry(const proto::SceneItemInfo& info, proto::Errors* errors) {
+    std::string error = util::layout_error(info.geometry_info().interleaved_vertices());
+
+    if (error.empty()) {
+        error = util::instance_error(info.geometry_info());
+    }
+
+    if (not error.empty()) {
+        errors->set_error_msg("Item '" + info.id().value() + "': " + error);
+        return false;
+    }
+    return true;
+}
+
 void set_display_defaults(proto::SceneItemInfo* info) {
     proto::DisplayInfo* display_info = info->mutable_display_info();
 
@@ -86,42 +107,15 @@ void set_display_defaults(proto::SceneItemInfo* info) {
     }
 }
 
-void update_display_defaults(proto::SceneItemInfo* old_info, const proto::SceneItemInfo& new_info) {
-    if (new_info.has_display_info()) {
-        proto::DisplayInfo* old_display_info = old_info->mutable_display_info();
-        const proto::DisplayInfo& new_display_info = new_info.display_info();
-
-        if (new_display_info.has_readable_id()) {
-            old_display_info->mutable_readable_id()->CopyFrom(new_display_info.readable_id());
-        }
-
-        if (new_display_info.has_geometry_format()) {
-            old_display_info->mutable_geometry_format()->CopyFrom(new_display_info.geometry_format());
-        }
-
-        if (new_display_info.has_transformation()) {
-            old_display_info->mutable_transformation()->CopyFrom(new_display_info.transformation());
-        }
-
-        if (new_display_info.has_uniform_color()) {
-            old_display_info->mutable_uniform_color()->CopyFrom(new_display_info.uniform_color());
-        }
-
-        if (new_display_info.has_coloring()) {
-            old_display_info->mutable_coloring()->CopyFrom(new_display_info.coloring());
-        }
-
-        if (new_display_info.has_shading()) {
-            old_display_info->mutable_shading()->CopyFrom(new_display_info.shading());
-        }
-    }
-}
-
 } // namespace
 
-SceneServer::SceneServer(const std::string& server_address)
+SceneServer::SceneServer(const std::string& server_address, SceneServerSettings settings)
     : server_(std::make_unique<grpcw::server::GrpcAsyncServer<Service>>(std::make_shared<Service>(), server_address)) {
 
+    if (settings.record_timeline) {
+        timeline_ = std::make_unique<SceneTimeline>(scene_, settings.timeline);
+    }
+
     /*
      * Streaming calls
      */
@@ -143,6 +137,27 @@ SceneServer::SceneServer(const std::string& server_address)
                                 return grpc::Status::OK;
                             });
 
+    server_->register_async(&Service::RequestGetSceneAt,
+                            [this](const proto::SceneTimeRequest& request, proto::SceneSnapshot* snapshot) {
+                                get_scene_at(request, snapshot);
+                                return grpc::Status::OK;
+                            });
+
+    /*
+     * Spatial queries
+     */
+    server_->register_async(&Service::RequestQueryBox,
+                            [this](const proto::BoxQuery& query, proto::SpatialQueryResult* result) {
+                                query_box(query, result);
+                                return grpc::Status::OK;
+                            });
+
+    server_->register_async(&Service::RequestRaycastItems,
+                            [this](const proto::RayQuery& query, proto::SpatialQueryResult* result) {
+                                raycast_items(query, result);
+                                return grpc::Status::OK;
+                            });
+
     /*
      * Setters for current state
      */
@@ -150,6 +165,19 @@ SceneServer::SceneServer(const std::string& server_address)
                             [this](const proto::SceneItems& scene, proto::Errors* /*errors*/) {
                                 // TODO: Error check and set errors if necessary
                                 scene_.CopyFrom(scene);
+
+                                item_handles_.clear();
+                                items_by_handle_.clear();
+                                for (auto& item : *scene_.mutable_items()) {
+                                    assign_handle(&item.second);
+                                }
+
+                                spatial_index_.reset(scene_);
+
+                                if (timeline_) {
+                                    RequestArena arena;
+                                    timeline_->record(*arena.borrowing_reset_update(scene_), scene_);
+                                }
                                 return grpc::Status::OK;
                             });
 
@@ -165,44 +193,146 @@ SceneServer::SceneServer(const std::string& server_address)
 
     server_->register_async(&Service::RequestUpdateScene,
                             [this](const proto::SceneUpdateRequest& update_request, proto::Errors* errors) {
-                                switch (update_request.update_case()) {
-
-                                case proto::SceneUpdateRequest::kSafeSetItem:
-                                    return safe_set_item(update_request.safe_set_item(), errors);
-
-                                case proto::SceneUpdateRequest::kReplaceItem:
-                                    return replace_item(update_request.replace_item(), errors);
-
-                                case proto::SceneUpdateRequest::kAppendToItem:
-                                    return append_to_item(update_request.append_to_item(), errors);
-
-                                case proto::SceneUpdateRequest::kUpdateItem:
-                                case proto::SceneUpdateRequest::kRemoveItem:
-                                    errors->set_error_msg("Action not yet handled by server");
-                                    break;
+                                update_scene(update_request, errors);
+                                return grpc::Status::OK;
+                            });
 
-                                case proto::SceneUpdateRequest::kClearAll: {
-                                    scene_.clear_items();
-                                    proto::SceneUpdate update;
-                                    update.mutable_reset_all_items()->CopyFrom(scene_);
-                                    scene_stream_->write(update);
-                                } break;
+    server_->register_async(&Service::RequestUpdateSceneBatch,
+                            [this](const proto::SceneUpdateRequestBatch& batch, proto::BatchErrors* errors) {
+                                errors->mutable_errors()->Reserve(batch.requests_size());
 
-                                case proto::SceneUpdateRequest::UPDATE_NOT_SET:
-                                    errors->set_error_msg("No update set");
-                                    break;
+                                for (const auto& update_request : batch.requests()) {
+                                    update_scene(update_request, errors->add_errors());
                                 }
+                                return grpc::Status::OK;
+                            });
 
+    server_->register_async(&Service::RequestUpdateTransforms,
+                            [this](const proto::TransformBatch& batch, proto::Errors* errors) {
+                                update_transforms(batch, errors);
                                 return grpc::Status::OK;
                             });
+
+    if (settings.update_tick > std::chrono::milliseconds::zero()) {
+        tick_thread_ = std::thread(&SceneServer::send_pending_updates_every_tick, this, settings.update_tick);
+    }
 }
 
-SceneServer::~SceneServer() = default;
+SceneServer::~SceneServer() {
+    if (tick_thread_.joinable()) {
+        pending_updates_.use_safely([](PendingUpdates& pending) { pending.stop = true; });
+        pending_updates_.notify_all();
+        tick_thread_.join();
+    }
+}
 
 grpc::Server& SceneServer::grpc_server() {
     return server_->server();
 }
 
+void SceneServer::update_scene(const proto::SceneUpdateRequest& update_request, proto::Errors* errors) {
+    switch (update_request.update_case()) {
+
+    case proto::SceneUpdateRequest::kSafeSetItem:
+        handle_item_request(&SceneServer::safe_set_item, update_request.safe_set_item(), errors);
+        break;
+
+    case proto::SceneUpdateRequest::kReplaceItem:
+        handle_item_request(&SceneServer::replace_item, update_request.replace_item(), errors);
+        break;
+
+    case proto::SceneUpdateRequest::kAppendToItem:
+        handle_item_request(&SceneServer::append_to_item, update_request.append_to_item(), errors);
+        break;
+
+    case proto::SceneUpdateRequest::kUpdateItem:
+    case proto::SceneUpdateRequest::kRemoveItem:
+        errors->set_error_msg("Action not yet handled by server");
+        break;
+
+    case proto::SceneUpdateRequest::kClearAll: {
+        scene_.clear_items();
+        item_handles_.clear();
+        items_by_handle_.clear();
+        RequestArena arena;
+        send_update(*arena.borrowing_reset_update(scene_));
+    } break;
+
+    case proto::SceneUpdateRequest::kTransforms:
+        update_transforms(update_request.transforms(), errors);
+        break;
+
+    case proto::SceneUpdateRequest::UPDATE_NOT_SET:
+        errors->set_error_msg("No update set");
+        break;
+    }
+}
+
+void SceneServer::handle_item_request(ItemHandler handler, const proto::SceneItemInfo& info, proto::Errors* errors) {
+    if (not has_valid_geometry(info, errors)) {
+        return;
+    }
+
+    RequestArena arena;
+    const proto::SceneItemInfo* resolved = resolve_handles(info, &arena, errors);
+
+    if (not resolved) {
+        return;
+    }
+
+    (this->*handler)(*resolved, errors);
+
+    if (errors->error_msg().empty()) {
+        // Only items sent by string id need a lookup (new items are assigned a handle by the handler)
+        ItemHandles::Handle handle = resolved->id().handle();
+        errors->set_item_handle(handle != ItemHandles::null_handle ? handle
+                                                                   : item_handles_.handle(resolved->id().value()));
+    }
+}
+
+const proto::SceneItemInfo*
+SceneServer::resolve_handles(const proto::SceneItemInfo& info, RequestArena* arena, proto::Errors* errors) const {
+    // Returns the id to use, or null if the handle is unknown
+    auto resolve = [this, errors](const proto::ID& id) -> const std::string* {
+        if (id.handle() == ItemHandles::null_handle) {
+            return &id.value();
+        }
+
+        const std::string* resolved_id = item_handles_.id(id.handle());
+        if (not resolved_id) {
+            errors->set_error_msg("Unknown item handle " + std::to_string(id.handle())
+                                  + ". Handles are invalidated when the scene is cleared.");
+        }
+        return resolved_id;
+    };
+
+    const std::string* id = resolve(info.id());
+    const std::string* parent = info.has_parent() ? resolve(info.parent()) : nullptr;
+
+    if (not id or (info.has_parent() and not parent)) {
+        return nullptr;
+    }
+
+    // A resolved handle is already known to be valid so only string ids are looked up
+    ItemHandles::Handle handle
+        = (info.id().handle() != ItemHandles::null_handle ? info.id().handle() : item_handles_.handle(*id));
+    bool parent_resolved = not info.has_parent() or *parent == info.parent().value();
+
+    // Most requests already match so nothing needs to be copied
+    if (*id == info.id().value() and handle == info.id().handle() and parent_resolved) {
+        return &info;
+    }
+
+    proto::SceneItemInfo* resolved = arena->borrowing_item(info);
+    resolved->mutable_id()->set_value(*id);
+    resolved->mutable_id()->set_handle(handle);
+
+    if (info.has_parent()) {
+        resolved->mutable_parent()->set_value(*parent);
+    }
+    return resolved;
+}
+
 /*
  * See the full table in "scene_server.hpp"
  *
@@ -289,23 +419,13 @@ grpc::Status SceneServer::append_to_item(const proto::SceneItemInfo& info, proto
             return grpc::Status::OK;
         }
 
-        proto::SceneUpdate update;
-        update.mutable_update_item()->CopyFrom(info);
-
-        scene_stream_->write(update);
+        RequestArena arena;
+        send_update(*arena.borrowing_update_update(info));
 
     } else {
         // Item doesn't yet exist. Add it.
         // TODO: Error check? (has_geometry, etc.)
-        scene_.mutable_items()->insert({id, info});
-        // TODO: Handle parent and children updates
-
-        set_display_defaults(&scene_.mutable_items()->at(id));
-
-        proto::SceneUpdate update;
-        update.mutable_add_item()->CopyFrom(scene_.mutable_items()->at(id));
-
-        scene_stream_->write(update);
+        add_item_and_send_update(info, errors);
     }
 
     return grpc::Status::OK;
@@ -318,30 +438,171 @@ void SceneServer::add_item_and_send_update(const proto::SceneItemInfo& info, pro
     scene_.mutable_items()->insert({id, info});
     // TODO: Handle parent and children updates
 
-    set_display_defaults(&scene_.mutable_items()->at(id));
+    proto::SceneItemInfo& item = scene_.mutable_items()->at(id);
+    assign_handle(&item);
+    set_display_defaults(&item);
 
-    proto::SceneUpdate update;
-    update.mutable_add_item()->CopyFrom(scene_.mutable_items()->at(id));
-    scene_stream_->write(update);
+    RequestArena arena;
+    send_update(*arena.borrowing_add_update(scene_.items().at(id)));
 }
 
 void SceneServer::update_item_and_send_update(const proto::SceneItemInfo& info, proto::Errors* /*errors*/) {
     const std::string& id = info.id().value();
 
-    update_display_defaults(&scene_.mutable_items()->at(id), info);
+    util::update_display_info(&scene_.mutable_items()->at(id), info);
 
     // TODO: Handle parent and children updates
 
-    proto::SceneUpdate update;
-    update.mutable_update_item()->CopyFrom(info);
-
-    scene_stream_->write(update);
+    RequestArena arena;
+    send_update(*arena.borrowing_update_update(info));
 }
 
 void SceneServer::remove_item_and_send_update(const proto::SceneItemInfo& /*info*/, proto::Errors* /*errors*/) {
     // TODO
 }
 
+void SceneServer::update_transforms(const proto::TransformBatch& batch, proto::Errors* errors) {
+    std::string error = util::transform_batch_error(batch);
+
+    if (not error.empty()) {
+        errors->set_error_msg(error);
+        return;
+    }
+
+    for (std::uint32_t handle : batch.handles()) {
+        std::uint32_t slot = util::handle_slot(handle);
+
+        if (not item_handles_.id(handle) or slot >= items_by_handle_.size() or not items_by_handle_[slot]) {
+            errors->set_error_msg("Unknown item handle " + std::to_string(handle)
+                                  + ". Handles are invalidated when the scene is cleared.");
+            return;
+        }
+    }
+
+    const float* transformation = batch.transformations().data();
+
+    for (std::uint32_t handle : batch.handles()) {
+        util::set_transformation(items_by_handle_[util::handle_slot(handle)], transformation);
+        transformation += util::transform_size;
+    }
+
+    RequestArena arena;
+    send_update(*arena.borrowing_transforms_update(batch));
+}
+
+void SceneServer::assign_handle(proto::SceneItemInfo* item) {
+    ItemHandles::Handle handle = item_handles_.assign(item->id().value());
+    item->mutable_id()->set_handle(handle);
+
+    if (handle == ItemHandles::null_handle) {
+        return; // out of slots, the item can only be referred to by its string id
+    }
+
+    // Map values are never moved so the pointer stays valid until the item is erased
+    std::uint32_t slot = util::handle_slot(handle);
+    if (slot >= items_by_handle_.size()) {
+        items_by_handle_.resize(slot + 1u, nullptr);
+    }
+    items_by_handle_[slot] = item;
+}
+
+void SceneServer::get_scene_at(const proto::SceneTimeRequest& request, proto::SceneSnapshot* snapshot) const {
+    if (not timeline_) {
+        snapshot->set_error_msg("The server is not recording a timeline");
+        return;
+    }
+
+    util::Result<proto::SceneSnapshot> result = tl::make_unexpected(MAKE_ERROR("No time set"));
+
+    switch (request.time_case()) {
+    case proto::SceneTimeRequest::kVersion:
+        result = timeline_->scene_at_version(request.version());
+        break;
+
+    case proto::SceneTimeRequest::kTimestampMs:
+        result = timeline_->scene_at_time(SceneTimeline::Clock::time_point{}
+                                          + std::chrono::milliseconds(request.timestamp_ms()));
+        break;
+
+    case proto::SceneTimeRequest::TIME_NOT_SET:
+        break;
+    }
+
+    if (result) {
+        *snapshot = std::move(result.value());
+    } else {
+        snapshot->set_error_msg(result.error().error_message());
+    }
+}
+
+void SceneServer::query_box(const proto::BoxQuery& query, proto::SpatialQueryResult* result) const {
+    util::Aabb box;
+    box.expand({query.min().x(), query.min().y(), query.min().z()});
+    box.expand({query.max().x(), query.max().y(), query.max().z()});
+
+    for (const std::string& id : spatial_index_.query_box(box)) {
+        result->add_items()->set_value(id);
+    }
+}
+
+void SceneServer::raycast_items(const proto::RayQuery& query, proto::SpatialQueryResult* result) const {
+    util::Vec3f origin = {query.origin().x(), query.origin().y(), query.origin().z()};
+    util::Vec3f direction = {query.direction().x(), query.direction().y(), query.direction().z()};
+
+    if (direction == util::Vec3f{0.f, 0.f, 0.f}) {
+        result->set_error_msg("Ray direction must be non-zero");
+        return;
+    }
+
+    float max_distance = query.max_distance();
+    if (max_distance <= 0.f) {
+        max_distance = std::numeric_limits<float>::infinity();
+    }
+
+    for (const RaycastHit& hit : spatial_index_.raycast(origin, direction, max_distance)) {
+        result->add_items()->set_value(hit.id);
+        result->add_distances(hit.distance);
+    }
+}
+
+void SceneServer::send_update(const proto::SceneUpdate& update) {
+    if (timeline_) {
+        timeline_->record(update, scene_);
+    }
+
+    spatial_index_.apply(update, scene_);
+
+    if (tick_thread_.joinable()) {
+        pending_updates_.use_safely([&](PendingUpdates& pending) { pending.aggregator.add(update); });
+    } else {
+        scene_stream_->write(update);
+    }
+}
+
+void SceneServer::send_pending_updates_every_tick(std::chrono::milliseconds update_tick) {
+    auto tick_millis = static_cast<unsigned>(update_tick.count());
+
+    bool stop = false;
+
+    while (not stop) {
+        // Wait for one tick unless the server is shutting down
+        stop = pending_updates_.wait_to_use_safely(
+            tick_millis, [](const PendingUpdates& pending) { return pending.stop; }, [](const PendingUpdates&) {});
+
+        proto::SceneUpdate combined;
+
+        pending_updates_.use_safely([&](PendingUpdates& pending) {
+            if (not pending.aggregator.empty()) {
+                combined = pending.aggregator.take_combined();
+            }
+        });
+
+        if (combined.update_case() != proto::SceneUpdate::UPDATE_NOT_SET) {
+            scene_stream_->write(combined);
+        }
+    }
+}
+
 } // namespace gvs::server
 
 // //////////////////////////////////////////////////////////////////////////////////// //
@@ -353,7 +614,9 @@ void SceneServer::remove_item_and_send_update(const proto::SceneItemInfo& /*info
 #include <grpc++/create_channel.h>
 #include <grpcw/client/grpc_client.hpp>
 
+#include <algorithm>
 #include <thread>
+#include <type_traits>
 
 namespace {
 class SceneTestClient {
@@ -388,6 +651,81 @@ public:
         return errors;
     };
 
+    /**
+     * @brief Send a batch of requests, make sure it was sent successfully, return the errors for each request.
+     */
+    gvs::proto::BatchErrors send_batch(const gvs::proto::SceneUpdateRequestBatch& batch) {
+        gvs::proto::BatchErrors errors;
+
+        bool successfully_sent [[maybe_unused]] = grpc_client_.use_stub([&](auto& stub) {
+            grpc::ClientContext context;
+            grpc::Status status = stub.UpdateSceneBatch(&context, batch, &errors);
+
+            REQUIRE(status.ok());
+        });
+        REQUIRE(successfully_sent);
+
+        return errors;
+    }
+
+    /**
+     * @brief Send a batch of transformations, make sure it was sent successfully, return any errors.
+     */
+    gvs::proto::Errors send_transforms(const gvs::proto::TransformBatch& batch) {
+        gvs::proto::Errors errors;
+
+        bool successfully_sent [[maybe_unused]] = grpc_client_.use_stub([&](auto& stub) {
+            grpc::ClientContext context;
+            grpc::Status status = stub.UpdateTransforms(&context, batch, &errors);
+
+            REQUIRE(status.ok());
+        });
+        REQUIRE(successfully_sent);
+
+        return errors;
+    }
+
+    /**
+     * @brief Request a past scene state, make sure it was sent successfully, return the snapshot.
+     */
+    gvs::proto::SceneSnapshot get_scene_at(const gvs::proto::SceneTimeRequest& request) {
+        gvs::proto::SceneSnapshot snapshot;
+
+        bool successfully_sent [[maybe_unused]] = grpc_client_.use_stub([&](auto& stub) {
+            grpc::ClientContext context;
+            grpc::Status status = stub.GetSceneAt(&context, request, &snapshot);
+
+            REQUIRE(status.ok());
+        });
+        REQUIRE(successfully_sent);
+
+        return snapshot;
+    }
+
+    /**
+     * @brief Run a spatial query, make sure it was sent successfully, return the result.
+     */
+    template <typename Query>
+    gvs::proto::SpatialQueryResult spatial_query(const Query& query) {
+        gvs::proto::SpatialQueryResult result;
+
+        bool successfully_sent [[maybe_unused]] = grpc_client_.use_stub([&](auto& stub) {
+            grpc::ClientContext context;
+            grpc::Status status;
+
+            if constexpr (std::is_same_v<Query, gvs::proto::BoxQuery>) {
+                status = stub.QueryBox(&context, query, &result);
+            } else {
+                status = stub.RaycastItems(&context, query, &result);
+            }
+
+            REQUIRE(status.ok());
+        });
+        REQUIRE(successfully_sent);
+
+        return result;
+    }
+
     // keeps track of scene updates received on a separate thread
     gvs::util::BlockingQueue<gvs::proto::SceneUpdate> updates;
 
@@ -410,6 +748,207 @@ TEST_CASE("[gvs-server] test_no_update_set") {
     CHECK(errors.error_msg() == "No update set");
 }
 
+TEST_CASE("[gvs-server] batched_requests_report_errors_in_order") {
+    std::string server_address = "0.0.0.0:50050";
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    gvs::proto::SceneUpdateRequestBatch batch;
+
+    // Valid request
+    auto* info = batch.add_requests()->mutable_safe_set_item();
+    info->mutable_id()->set_value("item");
+    info->mutable_geometry_info()->mutable_positions()->add_value(1.f);
+
+    // No update set
+    batch.add_requests();
+
+    // Item already exists
+    batch.add_requests()->CopyFrom(batch.requests(0));
+
+    gvs::proto::BatchErrors errors = client.send_batch(batch);
+    REQUIRE(errors.errors_size() == 3);
+    CHECK(errors.errors(0).error_msg().empty());
+    CHECK(errors.errors(1).error_msg() == "No update set");
+    CHECK_FALSE(errors.errors(2).error_msg().empty());
+
+    // The successful request is still applied
+    gvs::proto::SceneUpdate update = client.updates.pop_front();
+    CHECK(update.update_case() == gvs::proto::SceneUpdate::kAddItem);
+}
+
+TEST_CASE("[gvs-server] invalid_interleaved_vertices_are_rejected") {
+    std::string server_address = "0.0.0.0:50050";
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    gvs::proto::SceneUpdateRequest request;
+    request.mutable_safe_set_item()->mutable_id()->set_value("item");
+
+    gvs::proto::InterleavedVertices* vertices
+        = request.mutable_safe_set_item()->mutable_geometry_info()->mutable_interleaved_vertices();
+    vertices->set_data(std::string(20, '\0'));
+    vertices->set_stride(12); // not a multiple of the data size
+    vertices->add_attributes()->set_attribute(gvs::proto::ATTRIBUTE_POSITION);
+
+    CHECK_FALSE(client.send_request(request).error_msg().empty());
+
+    vertices->set_stride(10);
+    CHECK_FALSE(client.send_request(request).error_msg().empty()); // positions don't fit in the stride
+
+    vertices->set_data(std::string(24, '\0'));
+    vertices->set_stride(12);
+    CHECK(client.send_request(request).error_msg().empty());
+}
+
+TEST_CASE("[gvs-server] invalid_instances_are_rejected") {
+    std::string server_address = "0.0.0.0:50050";
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    gvs::proto::SceneUpdateRequest request;
+    request.mutable_safe_set_item()->mutable_id()->set_value("item");
+
+    gvs::proto::GeometryInfo3D* geometry = request.mutable_safe_set_item()->mutable_geometry_info();
+    geometry->mutable_positions()->add_value(1.f);
+    geometry->mutable_instance_transformations()->mutable_value()->Resize(20, 0.f); // not a multiple of 16
+
+    CHECK_FALSE(client.send_request(request).error_msg().empty());
+
+    geometry->mutable_instance_transformations()->mutable_value()->Resize(32, 0.f);
+    geometry->mutable_instance_colors()->mutable_value()->Resize(3, 1.f);
+    CHECK_FALSE(client.send_request(request).error_msg().empty()); // one color for two instances
+
+    geometry->mutable_instance_colors()->mutable_value()->Resize(6, 1.f);
+    CHECK(client.send_request(request).error_msg().empty());
+}
+
+TEST_CASE("[gvs-server] items_can_be_updated_by_handle") {
+    std::string server_address = "0.0.0.0:50050";
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    gvs::proto::SceneUpdateRequest request;
+    request.mutable_safe_set_item()->mutable_id()->set_value("item");
+    request.mutable_safe_set_item()->mutable_geometry_info()->mutable_positions()->add_value(1.f);
+
+    gvs::proto::Errors errors = client.send_request(request);
+    REQUIRE(errors.error_msg().empty());
+
+    std::uint32_t handle = errors.item_handle();
+    CHECK(handle != 0u);
+
+    gvs::proto::SceneUpdate update = client.updates.pop_front();
+    CHECK(update.add_item().id().handle() == handle);
+
+    // Send an update using only the handle
+    request.mutable_safe_set_item()->Clear();
+    request.mutable_safe_set_item()->mutable_id()->set_handle(handle);
+    request.mutable_safe_set_item()->mutable_display_info()->mutable_readable_id()->set_value("Renamed");
+
+    errors = client.send_request(request);
+    CHECK(errors.error_msg().empty());
+    CHECK(errors.item_handle() == handle);
+
+    // Clients still receive the full id
+    update = client.updates.pop_front();
+    CHECK(update.update_item().id().value() == "item");
+    CHECK(update.update_item().id().handle() == handle);
+
+    // Unknown handles are rejected
+    request.mutable_safe_set_item()->mutable_id()->set_handle(handle + 1u);
+    CHECK_FALSE(client.send_request(request).error_msg().empty());
+
+    // Clearing the scene invalidates handles
+    gvs::proto::SceneUpdateRequest clear_request;
+    clear_request.mutable_clear_all();
+    CHECK(client.send_request(clear_request).error_msg().empty());
+
+    request.mutable_safe_set_item()->mutable_id()->set_handle(handle);
+    CHECK_FALSE(client.send_request(request).error_msg().empty());
+}
+
+TEST_CASE("[gvs-server] transforms_are_updated_by_handle") {
+    std::string server_address = "0.0.0.0:50050";
+
+    gvs::server::SceneServerSettings settings;
+    settings.record_timeline = true;
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address, settings);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    gvs::proto::SceneUpdateRequest request;
+    request.mutable_safe_set_item()->mutable_id()->set_value("link");
+    request.mutable_safe_set_item()->mutable_geometry_info()->mutable_positions()->add_value(1.f);
+
+    std::uint32_t handle = client.send_request(request).item_handle();
+    client.updates.pop_front();
+
+    gvs::proto::TransformBatch batch;
+    batch.add_handles(handle);
+    for (float value : {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 2, 3, 4, 1}) {
+        batch.add_transformations(value);
+    }
+
+    CHECK(client.send_transforms(batch).error_msg().empty());
+
+    // Clients receive the batch as is
+    gvs::proto::SceneUpdate update = client.updates.pop_front();
+    REQUIRE(update.update_case() == gvs::proto::SceneUpdate::kTransforms);
+    CHECK(update.transforms().SerializeAsString() == batch.SerializeAsString());
+
+    // Unknown handles and incomplete matrices are rejected without changing anything
+    batch.add_handles(handle + 1u);
+    CHECK_FALSE(client.send_transforms(batch).error_msg().empty());
+
+    for (int i = 0; i < gvs::util::transform_size; ++i) {
+        batch.add_transformations(0.f);
+    }
+    CHECK_FALSE(client.send_transforms(batch).error_msg().empty());
+
+    // The stored item was updated
+    gvs::proto::SceneTimeRequest time_request;
+    time_request.set_version(2);
+    gvs::proto::SceneSnapshot snapshot = client.get_scene_at(time_request);
+    REQUIRE(snapshot.error_msg().empty());
+
+    const gvs::proto::Mat4& transformation = snapshot.items().items().at("link").display_info().transformation();
+    REQUIRE(transformation.data_size() == gvs::util::transform_size);
+    CHECK(transformation.data(12) == 2.f);
+    CHECK(transformation.data(14) == 4.f);
+
+    // Batches can also be sent as scene update requests so they stay in order with item requests
+    gvs::proto::SceneUpdateRequest transforms_request;
+    transforms_request.mutable_transforms()->add_handles(handle);
+    for (float value : {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 5, 6, 7, 1}) {
+        transforms_request.mutable_transforms()->add_transformations(value);
+    }
+    CHECK(client.send_request(transforms_request).error_msg().empty());
+
+    update = client.updates.pop_front();
+    REQUIRE(update.update_case() == gvs::proto::SceneUpdate::kTransforms);
+    CHECK(update.transforms().transformations(12) == 5.f);
+}
+
 TEST_CASE("[gvs-server] test_safe_send") {
     std::string server_address = "0.0.0.0:50050";
 
@@ -688,3 +1227,149 @@ TEST_CASE("[gvs-server] check_lambertian_defaults_are_set_properly") {
     CHECK(shading.ambient_color().y() == gvs::default_ambient_color[1]);
     CHECK(shading.ambient_color().z() == gvs::default_ambient_color[2]);
 }
+
+TEST_CASE("[gvs-server] get_scene_at_past_versions") {
+    std::string server_address = "0.0.0.0:50050";
+
+    gvs::server::SceneServerSettings settings;
+    settings.record_timeline = true;
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address, settings);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    // Add an item and then change its readable id
+    {
+        gvs::proto::SceneUpdateRequest request;
+        request.mutable_safe_set_item()->mutable_id()->set_value("timeline_item");
+        request.mutable_safe_set_item()->mutable_geometry_info()->mutable_positions();
+        request.mutable_safe_set_item()->mutable_display_info()->mutable_readable_id()->set_value("first");
+        CHECK(client.send_request(request).error_msg().empty());
+
+        request.mutable_safe_set_item()->clear_geometry_info();
+        request.mutable_safe_set_item()->mutable_display_info()->mutable_readable_id()->set_value("second");
+        CHECK(client.send_request(request).error_msg().empty());
+    }
+
+    gvs::proto::SceneTimeRequest request;
+
+    request.set_version(0);
+    gvs::proto::SceneSnapshot snapshot = client.get_scene_at(request);
+    CHECK(snapshot.error_msg().empty());
+    CHECK(snapshot.items().items().empty());
+
+    request.set_version(1);
+    snapshot = client.get_scene_at(request);
+    CHECK(snapshot.error_msg().empty());
+    REQUIRE(snapshot.items().items().count("timeline_item") == 1);
+    CHECK(snapshot.items().items().at("timeline_item").display_info().readable_id().value() == "first");
+
+    request.set_version(2);
+    snapshot = client.get_scene_at(request);
+    CHECK(snapshot.error_msg().empty());
+    CHECK(snapshot.items().items().at("timeline_item").display_info().readable_id().value() == "second");
+
+    request.set_version(3);
+    snapshot = client.get_scene_at(request);
+    CHECK_FALSE(snapshot.error_msg().empty());
+}
+
+TEST_CASE("[gvs-server] spatial_queries_use_world_bounds") {
+    std::string server_address = "0.0.0.0:50050";
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    // A row of unit boxes along the x axis
+    for (int i = 0; i < 10; ++i) {
+        gvs::proto::SceneUpdateRequest request;
+        gvs::proto::SceneItemInfo* item = request.mutable_safe_set_item();
+        item->mutable_id()->set_value("box" + std::to_string(i));
+
+        auto x = static_cast<float>(i * 2);
+        std::vector<float> corners = {x, 0.f, 0.f, x + 1.f, 1.f, 1.f};
+        *item->mutable_geometry_info()->mutable_positions()->mutable_value() = {corners.begin(), corners.end()};
+        CHECK(client.send_request(request).error_msg().empty());
+    }
+
+    gvs::proto::BoxQuery box_query;
+    box_query.mutable_min()->set_x(3.5f);
+    box_query.mutable_max()->set_x(6.5f);
+    box_query.mutable_max()->set_y(1.f);
+    box_query.mutable_max()->set_z(1.f);
+
+    gvs::proto::SpatialQueryResult result = client.spatial_query(box_query);
+    CHECK(result.error_msg().empty());
+
+    std::vector<std::string> ids;
+    for (const auto& id : result.items()) {
+        ids.emplace_back(id.value());
+    }
+    std::sort(ids.begin(), ids.end());
+    CHECK(ids == std::vector<std::string>{"box2", "box3"});
+
+    // Move an item out of the way and cast a ray along the row
+    {
+        gvs::proto::SceneUpdateRequest request;
+        gvs::proto::SceneItemInfo* item = request.mutable_safe_set_item();
+        item->mutable_id()->set_value("box1");
+        std::vector<float> translation = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 10, 0, 1};
+        *item->mutable_display_info()->mutable_transformation()->mutable_data()
+            = {translation.begin(), translation.end()};
+        CHECK(client.send_request(request).error_msg().empty());
+    }
+
+    gvs::proto::RayQuery ray_query;
+    ray_query.mutable_origin()->set_x(-1.f);
+    ray_query.mutable_origin()->set_y(0.5f);
+    ray_query.mutable_origin()->set_z(0.5f);
+    ray_query.mutable_direction()->set_x(1.f);
+    ray_query.set_max_distance(6.f);
+
+    result = client.spatial_query(ray_query);
+    CHECK(result.error_msg().empty());
+    REQUIRE(result.items_size() == 2);
+    CHECK(result.items(0).value() == "box0");
+    CHECK(result.distances(0) == doctest::Approx(1.f));
+    CHECK(result.items(1).value() == "box2");
+    CHECK(result.distances(1) == doctest::Approx(5.f));
+
+    ray_query.clear_direction();
+    CHECK_FALSE(client.spatial_query(ray_query).error_msg().empty());
+}
+
+TEST_CASE("[gvs-server] updates_are_combined_every_tick") {
+    std::string server_address = "0.0.0.0:50050";
+
+    gvs::server::SceneServerSettings settings;
+    settings.update_tick = std::chrono::milliseconds(50);
+
+    // Set up the scene server
+    gvs::server::SceneServer server(server_address, settings);
+
+    // Set up the scene client
+    SceneTestClient client(server.grpc_server());
+
+    constexpr int num_items = 10;
+
+    for (int i = 0; i < num_items; ++i) {
+        gvs::proto::SceneUpdateRequest request;
+        request.mutable_replace_item()->mutable_id()->set_value("item" + std::to_string(i));
+        request.mutable_replace_item()->mutable_geometry_info()->mutable_positions()->add_value(float(i));
+        CHECK(client.send_request(request).error_msg().empty());
+    }
+
+    // All the items arrive once the pending updates are sent
+    gvs::proto::SceneItems items;
+
+    while (items.items_size() < num_items) {
+        gvs::util::apply_update(&items, client.updates.pop_front());
+    }
+
+    CHECK(items.items().at("item3").geometry_info().positions().value(0) == 3.f);
+}
@@ -22,6 +22,14 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+// project
+#include "gvs/server/item_handles.hpp"
+#include "gvs/server/request_arena.hpp"
+#include "gvs/server/scene_timeline.hpp"
+#include "gvs/server/spatial_index.hpp"
+#include "gvs/util/atomic_data.hpp"
+#include "gvs/util/scene_update_aggregator.hpp"
+
 // generated
 #include <scene.grpc.pb.h>
 
@@ -30,11 +38,24 @@
 #include <grpc++/server.h>
 #include <grpcw/forward_declarations.hpp>
 
+// standard
+#include <thread>
+
 namespace gvs::server {
 
+struct SceneServerSettings {
+    /// Keep a history of scene states that can be requested with the 'GetSceneAt' rpc
+    bool record_timeline = false;
+    TimelineSettings timeline = {};
+
+    /// If non-zero, all scene changes made during a tick are combined and sent to
+    /// clients as a single update at the end of the tick.
+    std::chrono::milliseconds update_tick = std::chrono::milliseconds::zero();
+};
+
 class SceneServer {
 public:
-    explicit SceneServer(const std::string& server_address = "");
+    explicit SceneServer(const std::string& server_address = "", SceneServerSettings settings = {});
     ~SceneServer();
 
     grpc::Server& grpc_server();
@@ -50,6 +71,18 @@ private:
     grpcw::server::StreamInterface<proto::Message>* message_stream_;
     grpcw::server::StreamInterface<proto::SceneUpdate>* scene_stream_;
 
+    std::unique_ptr<SceneTimeline> timeline_; ///< null if the timeline is not being recorded
+    SpatialIndex spatial_index_;
+    ItemHandles item_handles_;
+    std::vector<proto::SceneItemInfo*> items_by_handle_; ///< Indexed by handle slot. Points into 'scene_'.
+
+    struct PendingUpdates {
+        util::SceneUpdateAggregator aggregator;
+        bool stop = false;
+    };
+    util::AtomicData<PendingUpdates> pending_updates_;
+    std::thread tick_thread_; ///< Only runs if updates are being combined every tick
+
     /*
      * How items are handled based on the update request:
      *
@@ -63,6 +96,19 @@ private:
      * | `gvs::append`  |       *No*        | Updates item                    | **Error**           |
      */
 
+    /// \brief Handles a single 'UpdateScene' request (or one request from an 'UpdateSceneBatch')
+    void update_scene(const proto::SceneUpdateRequest& update_request, proto::Errors* errors);
+
+    using ItemHandler = grpc::Status (SceneServer::*)(const proto::SceneItemInfo&, proto::Errors*);
+
+    /// \brief Resolves item handles, passes the item to 'handler', and returns the item's handle in 'errors'
+    void handle_item_request(ItemHandler handler, const proto::SceneItemInfo& info, proto::Errors* errors);
+
+    /// \brief Returns 'info' with both the string id and handle filled in for the item and its parent.
+    ///        Returns null and sets an error if a handle is unknown.
+    const proto::SceneItemInfo*
+    resolve_handles(const proto::SceneItemInfo& info, RequestArena* arena, proto::Errors* errors) const;
+
     grpc::Status safe_set_item(const proto::SceneItemInfo& info, proto::Errors* errors);
     grpc::Status replace_item(const proto::SceneItemInfo& info, proto::Errors* errors);
     grpc::Status append_to_item(const proto::SceneItemInfo& info, proto::Errors* errors);
@@ -70,6 +116,23 @@ private:
     void add_item_and_send_update(const proto::SceneItemInfo& info, proto::Errors* errors);
     void update_item_and_send_update(const proto::SceneItemInfo& info, proto::Errors* errors);
     void remove_item_and_send_update(const proto::SceneItemInfo& info, proto::Errors* errors);
+
+    /// \brief Writes the matrices straight into the items. Nothing is changed if any handle is unknown.
+    void update_transforms(const proto::TransformBatch& batch, proto::Errors* errors);
+
+    /// \brief Assigns the item a handle and stores the item so it can be found with the handle
+    void assign_handle(proto::SceneItemInfo* item);
+
+    void get_scene_at(const proto::SceneTimeRequest& request, proto::SceneSnapshot* snapshot) const;
+    void query_box(const proto::BoxQuery& query, proto::SpatialQueryResult* result) const;
+    void raycast_items(const proto::RayQuery& query, proto::SpatialQueryResult* result) const;
+
+    /// \brief Records the update in the timeline (if enabled), updates the spatial index,
+    ///        and sends the update to all connected clients
+    void send_update(const proto::SceneUpdate& update);
+
+    /// \brief Sends all the pending updates to clients once per tick until the server is destroyed
+    void send_pending_updates_every_tick(std::chrono::milliseconds update_tick);
 };
 
 } // namespace gvs::server
@@ -0,0 +1,240 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "scene_timeline.hpp"
+
+// project
+#include "gvs/util/scene_update.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+
+namespace gvs::server {
+
+namespace {
+
+std::int64_t to_millis(SceneTimeline::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+SceneTimeline::SceneTimeline(const proto::SceneItems& initial_scene,
+                             TimelineSettings settings,
+                             Clock::time_point start_time)
+    : settings_(settings) {
+    settings_.keyframe_interval = std::max(settings_.keyframe_interval, std::size_t(1));
+    add_keyframe(0, start_time, initial_scene);
+}
+
+void SceneTimeline::record(const proto::SceneUpdate& update, const proto::SceneItems& scene, Clock::time_point time) {
+    ++latest_version_;
+
+    // A reset already contains the full scene so it is stored as a keyframe.
+    if (update.update_case() == proto::SceneUpdate::kResetAllItems
+        or segments_.back().deltas.size() >= settings_.keyframe_interval) {
+        add_keyframe(latest_version_, time, scene);
+
+    } else {
+        Segment& segment = segments_.back();
+        segment.deltas.push_back({latest_version_, time, update});
+
+        std::size_t delta_size = update.ByteSizeLong();
+        segment.byte_size += delta_size;
+        memory_bytes_ += delta_size;
+    }
+
+    discard_old_segments();
+}
+
+util::Result<proto::SceneSnapshot> SceneTimeline::scene_at_version(std::uint64_t version) const {
+    if (version > latest_version_) {
+        return tl::make_unexpected(MAKE_ERROR("Version " + std::to_string(version)
+                                              + " has not been recorded yet. The latest version is "
+                                              + std::to_string(latest_version_)));
+    }
+
+    if (version < earliest_version()) {
+        return tl::make_unexpected(MAKE_ERROR("Version " + std::to_string(version)
+                                              + " is no longer stored. The earliest version is "
+                                              + std::to_string(earliest_version())));
+    }
+
+    // The last segment starting at or before 'version'
+    auto segment = std::prev(std::upper_bound(segments_.begin(),
+                                              segments_.end(),
+                                              version,
+                                              [](std::uint64_t v, const Segment& s) { return v < s.version; }));
+
+    auto num_deltas = static_cast<std::size_t>(version - segment->version);
+    return rebuild(*segment, num_deltas);
+}
+
+util::Result<proto::SceneSnapshot> SceneTimeline::scene_at_time(Clock::time_point time) const {
+    if (time < segments_.front().time) {
+        return tl::make_unexpected(MAKE_ERROR("Time " + std::to_string(to_millis(time))
+                                              + "ms is no longer stored. The earliest time is "
+                                              + std::to_string(to_millis(segments_.front().time)) + "ms"));
+    }
+
+    // The last segment starting at or before 'time'
+    auto segment = std::prev(std::upper_bound(segments_.begin(),
+                                              segments_.end(),
+                                              time,
+                                              [](Clock::time_point t, const Segment& s) { return t < s.time; }));
+
+    // The number of updates in the segment that happened at or before 'time'
+    auto last_delta = std::upper_bound(segment->deltas.begin(),
+                                       segment->deltas.end(),
+                                       time,
+                                       [](Clock::time_point t, const Delta& d) { return t < d.time; });
+
+    auto num_deltas = static_cast<std::size_t>(std::distance(segment->deltas.begin(), last_delta));
+    return rebuild(*segment, num_deltas);
+}
+
+std::uint64_t SceneTimeline::latest_version() const {
+    return latest_version_;
+}
+
+std::uint64_t SceneTimeline::earliest_version() const {
+    return segments_.front().version;
+}
+
+std::size_t SceneTimeline::memory_bytes() const {
+    return memory_bytes_;
+}
+
+void SceneTimeline::add_keyframe(std::uint64_t version, Clock::time_point time, const proto::SceneItems& scene) {
+    std::size_t keyframe_size = scene.ByteSizeLong();
+    segments_.push_back({version, time, scene, {}, keyframe_size});
+    segments_.back().deltas.reserve(settings_.keyframe_interval);
+    memory_bytes_ += keyframe_size;
+}
+
+void SceneTimeline::discard_old_segments() {
+    // Always keep the most recent segment so the latest state can be rebuilt
+    while (memory_bytes_ > settings_.max_memory_bytes and segments_.size() > 1) {
+        memory_bytes_ -= segments_.front().byte_size;
+        segments_.pop_front();
+    }
+}
+
+proto::SceneSnapshot SceneTimeline::rebuild(const Segment& segment, std::size_t num_deltas) const {
+    proto::SceneSnapshot snapshot;
+    snapshot.mutable_items()->CopyFrom(segment.keyframe);
+    snapshot.set_version(segment.version);
+    snapshot.set_timestamp_ms(to_millis(segment.time));
+
+    for (std::size_t i = 0; i < num_deltas; ++i) {
+        const Delta& delta = segment.deltas[i];
+        util::apply_update(snapshot.mutable_items(), delta.update);
+        snapshot.set_version(delta.version);
+        snapshot.set_timestamp_ms(to_millis(delta.time));
+    }
+
+    return snapshot;
+}
+
+} // namespace gvs::server
+
+// //////////////////////////////////////////////////////////////////////////////////// //
+// ///////////////////////////////////  TESTING  ////////////////////////////////////// //
+// //////////////////////////////////////////////////////////////////////////////////// //
+namespace {
+
+gvs::proto::SceneUpdate make_add_update(const std::string& id, std::size_t num_positions = 3) {
+    gvs::proto::SceneUpdate update;
+    update.mutable_add_item()->mutable_id()->set_value(id);
+    for (std::size_t i = 0; i < num_positions; ++i) {
+        update.mutable_add_item()->mutable_geometry_info()->mutable_positions()->add_value(static_cast<float>(i));
+    }
+    return update;
+}
+
+} // namespace
+
+TEST_CASE("[gvs-server] timeline_rebuilds_past_versions") {
+    using namespace std::chrono_literals;
+
+    gvs::server::TimelineSettings settings;
+    settings.keyframe_interval = 3;
+
+    auto start = gvs::server::SceneTimeline::Clock::time_point{} + 1000ms;
+
+    gvs::proto::SceneItems scene;
+    gvs::server::SceneTimeline timeline(scene, settings, start);
+
+    // Add ten items, one every 10 milliseconds
+    for (int i = 1; i <= 10; ++i) {
+        gvs::proto::SceneUpdate update = make_add_update("item" + std::to_string(i));
+        gvs::util::apply_update(&scene, update);
+        timeline.record(update, scene, start + i * 10ms);
+    }
+
+    CHECK(timeline.earliest_version() == 0);
+    CHECK(timeline.latest_version() == 10);
+
+    for (std::uint64_t version = 0; version <= 10; ++version) {
+        auto snapshot = timeline.scene_at_version(version);
+        REQUIRE(snapshot);
+        CHECK(snapshot->version() == version);
+        CHECK(snapshot->items().items_size() == static_cast<int>(version));
+    }
+
+    auto snapshot = timeline.scene_at_time(start + 55ms);
+    REQUIRE(snapshot);
+    CHECK(snapshot->version() == 5);
+    CHECK(snapshot->timestamp_ms() == 1050);
+    CHECK(snapshot->items().items_size() == 5);
+
+    CHECK_FALSE(timeline.scene_at_version(11));
+    CHECK_FALSE(timeline.scene_at_time(start - 1ms));
+}
+
+TEST_CASE("[gvs-server] timeline_memory_is_bounded") {
+    gvs::server::TimelineSettings settings;
+    settings.keyframe_interval = 4;
+    settings.max_memory_bytes = 4096;
+
+    gvs::proto::SceneItems scene;
+    gvs::server::SceneTimeline timeline(scene, settings);
+
+    for (int i = 1; i <= 200; ++i) {
+        gvs::proto::SceneUpdate update = make_add_update("item" + std::to_string(i % 8), 16);
+        gvs::util::apply_update(&scene, update);
+        timeline.record(update, scene);
+    }
+
+    CHECK(timeline.latest_version() == 200);
+    CHECK(timeline.earliest_version() > 0);
+    CHECK(timeline.memory_bytes() <= settings.max_memory_bytes);
+
+    CHECK_FALSE(timeline.scene_at_version(0));
+
+    auto latest = timeline.scene_at_version(timeline.latest_version());
+    REQUIRE(latest);
+    CHECK(latest->items().items_size() == 8);
+}
@@ -0,0 +1,117 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/result.hpp"
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace gvs::server {
+
+struct TimelineSettings {
+    /// The number of updates stored between full copies of the scene. This bounds
+    /// the number of updates applied when rebuilding a past scene state.
+    std::size_t keyframe_interval = 256;
+
+    /// Approximate upper bound on the serialized size of everything stored in the
+    /// timeline. The oldest keyframes (and their updates) are discarded first.
+    std::size_t max_memory_bytes = std::size_t(1) << 30u; // 1 GiB
+};
+
+/**
+ * @brief Records scene updates so past states of the scene can be rebuilt.
+ *
+ * The timeline is stored as a series of segments. Each segment starts with a full
+ * copy of the scene (a keyframe) followed by at most 'keyframe_interval' updates.
+ * Rebuilding a past state copies the nearest earlier keyframe and applies the
+ * updates recorded after it.
+ */
+class SceneTimeline {
+public:
+    using Clock = std::chrono::system_clock;
+
+    explicit SceneTimeline(const proto::SceneItems& initial_scene,
+                           TimelineSettings settings = {},
+                           Clock::time_point start_time = Clock::now());
+
+    /**
+     * @brief Record an update. 'scene' is the full scene after 'update' was applied.
+     */
+    void record(const proto::SceneUpdate& update,
+                const proto::SceneItems& scene,
+                Clock::time_point time = Clock::now());
+
+    /**
+     * @brief Rebuild the scene as it was directly after the update with the given version.
+     */
+    util::Result<proto::SceneSnapshot> scene_at_version(std::uint64_t version) const;
+
+    /**
+     * @brief Rebuild the scene as it was at the given time.
+     */
+    util::Result<proto::SceneSnapshot> scene_at_time(Clock::time_point time) const;
+
+    /// \brief The version of the most recently recorded update (0 before any updates are recorded)
+    std::uint64_t latest_version() const;
+
+    /// \brief The oldest version that can still be rebuilt
+    std::uint64_t earliest_version() const;
+
+    /// \brief Approximate number of bytes used by the stored keyframes and updates
+    std::size_t memory_bytes() const;
+
+private:
+    struct Delta {
+        std::uint64_t version;
+        Clock::time_point time;
+        proto::SceneUpdate update;
+    };
+
+    struct Segment {
+        std::uint64_t version; ///< The version of the keyframe
+        Clock::time_point time;
+        proto::SceneItems keyframe;
+        std::vector<Delta> deltas;
+        std::size_t byte_size;
+    };
+
+    TimelineSettings settings_;
+    std::deque<Segment> segments_; ///< Never empty
+    std::uint64_t latest_version_ = 0;
+    std::size_t memory_bytes_ = 0;
+
+    void add_keyframe(std::uint64_t version, Clock::time_point time, const proto::SceneItems& scene);
+    void discard_old_segments();
+
+    proto::SceneSnapshot rebuild(const Segment& segment, std::size_t num_deltas) const;
+};
+
+} // namespace gvs::server
@@ -0,0 +1,432 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "spatial_index.hpp"
+
+// project
+#include "gvs/item_defaults.hpp"
+#include "gvs/server/item_handles.hpp"
+#include "gvs/util/container_util.hpp"
+#include "gvs/util/scene_update.hpp"
+#include "gvs/util/vertex_layout.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+
+namespace gvs::server {
+
+namespace {
+
+using Transform = std::array<float, 16>;
+
+Transform multiply(const Transform& a, const Transform& b) {
+    Transform result = {};
+    for (auto col = 0u; col < 4u; ++col) {
+        for (auto row = 0u; row < 4u; ++row) {
+            for (auto k = 0u; k < 4u; ++k) {
+                result[col * 4u + row] += a[k * 4u + row] * b[col * 4u + k];
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+void SpatialIndex::apply(const proto::SceneUpdate& update, const proto::SceneItems& scene) {
+    switch (update.update_case()) {
+
+    case proto::SceneUpdate::kAddItem: {
+        const proto::SceneItemInfo& item = update.add_item();
+        remove_item(item.id().value());
+        update_item(item, item);
+    } break;
+
+    case proto::SceneUpdate::kUpdateItem: {
+        const std::string& id = update.update_item().id().value();
+
+        if (util::has_key(scene.items(), id)) {
+            update_item(scene.items().at(id), update.update_item());
+        }
+    } break;
+
+    case proto::SceneUpdate::kRemoveItem:
+        remove_item(update.remove_item().id().value());
+        break;
+
+    case proto::SceneUpdate::kResetAllItems:
+        reset(update.reset_all_items());
+        break;
+
+    case proto::SceneUpdate::kBatch:
+        for (const proto::SceneUpdate& batched_update : update.batch().updates()) {
+            apply(batched_update, scene);
+        }
+        break;
+
+    case proto::SceneUpdate::kTransforms:
+        apply_transforms(update.transforms());
+        break;
+
+    case proto::SceneUpdate::UPDATE_NOT_SET:
+        break;
+    }
+}
+
+void SpatialIndex::reset(const proto::SceneItems& scene) {
+    entries_.clear();
+    children_.clear();
+    ids_by_handle_.clear();
+    tree_.clear();
+
+    for (const auto& id_and_item : scene.items()) {
+        update_item(id_and_item.second, id_and_item.second);
+    }
+}
+
+std::vector<std::string> SpatialIndex::query_box(const util::Aabb& box) const {
+    std::vector<std::string> ids;
+
+    tree_.query(box, [&](auto proxy) {
+        const std::string& id = tree_.data(proxy);
+
+        // The tree stores padded bounds so check the exact bounds too
+        if (entries_.at(id).world_bounds.overlaps(box)) {
+            ids.emplace_back(id);
+        }
+        return true;
+    });
+
+    return ids;
+}
+
+std::vector<RaycastHit>
+SpatialIndex::raycast(const util::Vec3f& origin, const util::Vec3f& direction, float max_distance) const {
+    const util::Vec3f inverse_direction = {1.f / direction[0], 1.f / direction[1], 1.f / direction[2]};
+
+    std::vector<RaycastHit> hits;
+
+    tree_.raycast(origin, direction, max_distance, [&](auto proxy, float /*padded_distance*/) {
+        const std::string& id = tree_.data(proxy);
+        float distance = util::ray_entry_distance(entries_.at(id).world_bounds, origin, inverse_direction, max_distance);
+
+        if (distance <= max_distance) {
+            hits.push_back({id, distance});
+        }
+        return max_distance;
+    });
+
+    std::sort(hits.begin(), hits.end(), [](const auto& lhs, const auto& rhs) { return lhs.distance < rhs.distance; });
+    return hits;
+}
+
+util::Aabb SpatialIndex::world_bounds(const std::string& id) const {
+    if (not util::has_key(entries_, id)) {
+        return {};
+    }
+    return entries_.at(id).world_bounds;
+}
+
+void SpatialIndex::update_item(const proto::SceneItemInfo& item, const proto::SceneItemInfo& changes) {
+    const std::string& id = item.id().value();
+    bool new_item = not util::has_key(entries_, id);
+    Entry& entry = entries_[id];
+
+    if (new_item) {
+        entry.local_transform = default_transformation;
+
+        std::uint32_t slot = util::handle_slot(item.id().handle());
+
+        if (slot != 0u) {
+            if (slot >= ids_by_handle_.size()) {
+                ids_by_handle_.resize(slot + 1u);
+            }
+            ids_by_handle_[slot] = {item.id().handle(), id};
+        }
+    }
+
+    if (changes.has_geometry_info()) {
+        entry.local_bounds = util::geometry_bounds(item.geometry_info());
+    }
+
+    const auto& transformation = changes.display_info().transformation().data();
+    if (changes.display_info().has_transformation() and transformation.size() == 16) {
+        std::copy(transformation.begin(), transformation.end(), entry.local_transform.begin());
+    }
+
+    if (new_item or changes.has_parent()) {
+        set_parent(id, item.parent().value());
+    }
+
+    update_world_bounds(id);
+}
+
+void SpatialIndex::remove_item(const std::string& id) {
+    if (not util::has_key(entries_, id)) {
+        return;
+    }
+
+    Entry& entry = entries_.at(id);
+
+    if (entry.proxy != util::AabbTree<std::string>::null_proxy) {
+        tree_.remove(entry.proxy);
+    }
+    children_[entry.parent].erase(id);
+    entries_.erase(id);
+
+    // Children of removed items are positioned relative to the world until their parent is added again
+    if (util::has_key(children_, id)) {
+        for (const std::string& child : children_.at(id)) {
+            update_world_bounds(child);
+        }
+    }
+}
+
+void SpatialIndex::apply_transforms(const proto::TransformBatch& batch) {
+    if (not util::transform_batch_error(batch).empty()) {
+        return;
+    }
+
+    const float* transformation = batch.transformations().data();
+
+    for (std::uint32_t handle : batch.handles()) {
+        std::uint32_t slot = util::handle_slot(handle);
+
+        if (slot < ids_by_handle_.size() and ids_by_handle_[slot].handle == handle
+            and util::has_key(entries_, ids_by_handle_[slot].id)) {
+            const std::string& id = ids_by_handle_[slot].id;
+            std::copy(transformation, transformation + util::transform_size, entries_.at(id).local_transform.begin());
+            update_world_bounds(id);
+        }
+        transformation += util::transform_size;
+    }
+}
+
+void SpatialIndex::set_parent(const std::string& id, const std::string& parent) {
+    Entry& entry = entries_.at(id);
+    children_[entry.parent].erase(id);
+
+    // Ignore parents that would create a cycle
+    entry.parent = parent;
+    for (std::string ancestor = parent; util::has_key(entries_, ancestor); ancestor = entries_.at(ancestor).parent) {
+        if (ancestor == id) {
+            entry.parent.clear();
+            break;
+        }
+    }
+
+    children_[entry.parent].insert(id);
+}
+
+void SpatialIndex::update_world_bounds(const std::string& id) {
+    update_world_bounds(id, parent_world_transform(id));
+}
+
+void SpatialIndex::update_world_bounds(const std::string& id, const Transform& parent_transform) {
+    Entry& entry = entries_.at(id);
+    entry.world_transform = multiply(parent_transform, entry.local_transform);
+    entry.world_bounds = entry.local_bounds.transformed(entry.world_transform.data());
+
+    if (entry.world_bounds.empty()) {
+        if (entry.proxy != util::AabbTree<std::string>::null_proxy) {
+            tree_.remove(entry.proxy);
+            entry.proxy = util::AabbTree<std::string>::null_proxy;
+        }
+    } else if (entry.proxy == util::AabbTree<std::string>::null_proxy) {
+        entry.proxy = tree_.insert(entry.world_bounds, id);
+    } else {
+        tree_.update(entry.proxy, entry.world_bounds);
+    }
+
+    if (util::has_key(children_, id)) {
+        for (const std::string& child : children_.at(id)) {
+            update_world_bounds(child, entry.world_transform);
+        }
+    }
+}
+
+SpatialIndex::Transform SpatialIndex::parent_world_transform(const std::string& id) const {
+    const std::string& parent = entries_.at(id).parent;
+
+    if (util::has_key(entries_, parent)) {
+        return entries_.at(parent).world_transform;
+    }
+    return default_transformation;
+}
+
+} // namespace gvs::server
+
+namespace {
+
+gvs::proto::SceneItemInfo make_item(const std::string& id, const std::vector<float>& positions) {
+    gvs::proto::SceneItemInfo item;
+    item.mutable_id()->set_value(id);
+    *item.mutable_geometry_info()->mutable_positions()->mutable_value() = {positions.begin(), positions.end()};
+    return item;
+}
+
+gvs::proto::SceneUpdate make_add(const gvs::proto::SceneItemInfo& item, gvs::proto::SceneItems* scene) {
+    (*scene->mutable_items())[item.id().value()] = item;
+    gvs::proto::SceneUpdate update;
+    *update.mutable_add_item() = item;
+    return update;
+}
+
+gvs::proto::SceneUpdate
+make_translation(const std::string& id, float x, float y, float z, gvs::proto::SceneItems* scene) {
+    gvs::proto::SceneUpdate update;
+    update.mutable_update_item()->mutable_id()->set_value(id);
+    std::vector<float> translation = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1};
+    *update.mutable_update_item()->mutable_display_info()->mutable_transformation()->mutable_data()
+        = {translation.begin(), translation.end()};
+    scene->mutable_items()->at(id).mutable_display_info()->CopyFrom(update.update_item().display_info());
+    return update;
+}
+
+} // namespace
+
+TEST_CASE("[gvs-server] spatial_index_uses_parent_transforms") {
+    gvs::server::SpatialIndex index;
+    gvs::proto::SceneItems scene;
+
+    index.apply(make_add(make_item("parent", {0, 0, 0, 1, 1, 1}), &scene), scene);
+
+    auto child = make_item("child", {0, 0, 0, 1, 1, 1});
+    child.mutable_parent()->set_value("parent");
+    index.apply(make_add(child, &scene), scene);
+
+    index.apply(make_add(make_item("empty", {}), &scene), scene);
+
+    CHECK(index.world_bounds("child").min == gvs::util::Vec3f{0.f, 0.f, 0.f});
+    CHECK(index.world_bounds("empty").empty());
+
+    // Moving the parent moves the child
+    index.apply(make_translation("parent", 10.f, 0.f, 0.f, &scene), scene);
+    CHECK(index.world_bounds("parent").min == gvs::util::Vec3f{10.f, 0.f, 0.f});
+    CHECK(index.world_bounds("child").min == gvs::util::Vec3f{10.f, 0.f, 0.f});
+
+    index.apply(make_translation("child", 0.f, 5.f, 0.f, &scene), scene);
+    CHECK(index.world_bounds("child").min == gvs::util::Vec3f{10.f, 5.f, 0.f});
+
+    gvs::util::Aabb box;
+    box.expand({9.5f, -1.f, -1.f}).expand({10.5f, 1.f, 1.f});
+    CHECK(index.query_box(box) == std::vector<std::string>{"parent"});
+
+    auto hits = index.raycast({10.5f, 100.f, 0.5f}, {0.f, -1.f, 0.f}, 1000.f);
+    REQUIRE(hits.size() == 2);
+    CHECK(hits[0].id == "child");
+    CHECK(hits[0].distance == doctest::Approx(94.f));
+    CHECK(hits[1].id == "parent");
+    CHECK(hits[1].distance == doctest::Approx(99.f));
+
+    // Removing the parent leaves the child relative to the world
+    gvs::proto::SceneUpdate remove;
+    remove.mutable_remove_item()->mutable_id()->set_value("parent");
+    scene.mutable_items()->erase("parent");
+    index.apply(remove, scene);
+    CHECK(index.world_bounds("child").min == gvs::util::Vec3f{0.f, 5.f, 0.f});
+    CHECK(index.raycast({10.5f, 100.f, 0.5f}, {0.f, -1.f, 0.f}, 1000.f).empty());
+}
+
+TEST_CASE("[gvs-server] spatial_index_applies_transforms_by_handle") {
+    gvs::server::SpatialIndex index;
+    gvs::proto::SceneItems scene;
+
+    auto item = make_item("item", {0, 0, 0, 1, 1, 1});
+    item.mutable_id()->set_handle(4u);
+    index.apply(make_add(item, &scene), scene);
+
+    gvs::proto::SceneUpdate update;
+    update.mutable_transforms()->add_handles(4u);
+    for (float value : {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, -3, 1}) {
+        update.mutable_transforms()->add_transformations(value);
+    }
+    index.apply(update, scene);
+
+    CHECK(index.world_bounds("item").min == gvs::util::Vec3f{0.f, 0.f, -3.f});
+    CHECK(index.world_bounds("item").max == gvs::util::Vec3f{1.f, 1.f, -2.f});
+}
+
+TEST_CASE("[gvs-server] spatial_index_applies_transforms_to_items_added_after_clearing") {
+    gvs::server::SpatialIndex index;
+    gvs::server::ItemHandles handles;
+    gvs::proto::SceneItems scene;
+
+    auto old_item = make_item("old", {0, 0, 0, 1, 1, 1});
+    old_item.mutable_id()->set_handle(handles.assign("old"));
+    index.apply(make_add(old_item, &scene), scene);
+
+    // Clearing the scene starts the slots over with a new generation
+    handles.clear();
+    scene.Clear();
+    gvs::proto::SceneUpdate clear;
+    clear.mutable_reset_all_items();
+    index.apply(clear, scene);
+
+    auto item = make_item("item", {0, 0, 0, 1, 1, 1});
+    item.mutable_id()->set_handle(handles.assign("item"));
+    index.apply(make_add(item, &scene), scene);
+
+    REQUIRE(gvs::util::handle_slot(item.id().handle()) == gvs::util::handle_slot(old_item.id().handle()));
+    REQUIRE(item.id().handle() != old_item.id().handle());
+
+    auto translate = [&](std::uint32_t handle, float z) {
+        gvs::proto::SceneUpdate update;
+        update.mutable_transforms()->add_handles(handle);
+        for (float value : {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, z, 1.f}) {
+            update.mutable_transforms()->add_transformations(value);
+        }
+        index.apply(update, scene);
+    };
+
+    translate(item.id().handle(), -3.f);
+    CHECK(index.world_bounds("item").min == gvs::util::Vec3f{0.f, 0.f, -3.f});
+
+    // The stale handle from before the clear is ignored
+    translate(old_item.id().handle(), 7.f);
+    CHECK(index.world_bounds("item").min == gvs::util::Vec3f{0.f, 0.f, -3.f});
+}
+
+TEST_CASE("[gvs-server] spatial_index_reads_interleaved_positions") {
+    struct Vertex {
+        float normal[3];
+        float position[3];
+    };
+    std::vector<Vertex> vertices = {{{0.f, 0.f, 1.f}, {-1.f, 2.f, 0.f}}, {{0.f, 0.f, 1.f}, {3.f, 4.f, 5.f}}};
+
+    gvs::proto::SceneItemInfo item = make_item("interleaved", {100.f, 100.f, 100.f});
+    gvs::proto::InterleavedVertices* interleaved = item.mutable_geometry_info()->mutable_interleaved_vertices();
+    interleaved->set_data(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+    interleaved->set_stride(sizeof(Vertex));
+    interleaved->add_attributes()->set_offset(offsetof(Vertex, position));
+
+    gvs::server::SpatialIndex index;
+    gvs::proto::SceneItems scene;
+    index.apply(make_add(item, &scene), scene);
+
+    // Interleaved positions are used instead of the separate list
+    CHECK(index.world_bounds("interleaved").min == gvs::util::Vec3f{-1.f, 2.f, 0.f});
+    CHECK(index.world_bounds("interleaved").max == gvs::util::Vec3f{3.f, 4.f, 5.f});
+}
@@ -0,0 +1,102 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/aabb_tree.hpp"
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace gvs::server {
+
+struct RaycastHit {
+    std::string id;
+    float distance; ///< Distance along the ray to the item's bounding box
+};
+
+/**
+ * @brief Keeps a bounding volume hierarchy of the world space bounds of every scene item.
+ *
+ * World space bounds are computed from each item's positions and the transformations of
+ * the item and all its parents. Updates only touch the changed item and its descendants.
+ */
+class SpatialIndex {
+public:
+    /// \brief Updates the index to match 'scene' after 'update' was applied to it
+    void apply(const proto::SceneUpdate& update, const proto::SceneItems& scene);
+
+    /// \brief Rebuilds the entire index from 'scene'
+    void reset(const proto::SceneItems& scene);
+
+    /// \brief Ids of all the items whose world space bounds overlap 'box'
+    std::vector<std::string> query_box(const util::Aabb& box) const;
+
+    /// \brief All items whose world space bounds are hit by the ray, sorted from nearest to farthest
+    std::vector<RaycastHit>
+    raycast(const util::Vec3f& origin, const util::Vec3f& direction, float max_distance) const;
+
+    /// \brief The world space bounds of an item (empty if the item has no positions)
+    util::Aabb world_bounds(const std::string& id) const;
+
+private:
+    using Transform = std::array<float, 16>; ///< Column major
+
+    struct Entry {
+        util::Aabb local_bounds;
+        Transform local_transform;
+        Transform world_transform;
+        util::Aabb world_bounds;
+        std::string parent;
+        util::AabbTree<std::string>::ProxyId proxy = util::AabbTree<std::string>::null_proxy;
+    };
+
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> children_; ///< parent id -> child ids
+    struct HandleSlot {
+        std::uint32_t handle = 0u; ///< The full handle so handles from before a clear are rejected
+        std::string id;
+    };
+    std::vector<HandleSlot> ids_by_handle_; ///< Indexed by 'util::handle_slot', used to apply transform batches
+    util::AabbTree<std::string> tree_;
+
+    void update_item(const proto::SceneItemInfo& item, const proto::SceneItemInfo& changes);
+    void remove_item(const std::string& id);
+    void apply_transforms(const proto::TransformBatch& batch);
+    void set_parent(const std::string& id, const std::string& parent);
+
+    /// \brief Recomputes world transforms and bounds for an item and all its descendants
+    void update_world_bounds(const std::string& id);
+    void update_world_bounds(const std::string& id, const Transform& parent_transform);
+
+    Transform parent_world_transform(const std::string& id) const;
+};
+
+} // namespace gvs::server
@@ -47,18 +47,47 @@ layout(location = 0) in vec3 world_position;
 layout(location = 1) in vec3 world_normal;
 layout(location = 2) in vec2 texture_coordinates;
 layout(location = 3) in vec3 vertex_color;
+#ifdef INSTANCED_DRAWS
+layout(location = 5) flat in vec3 instance_color;
+#endif
 
 /*
  * Uniforms
  */
-uniform int coloring = COLORING_UNIFORM_COLOR;
-uniform vec3 uniform_color = {1.f, 0.9f, 0.7f};
-uniform float opacity = 1.f;
+// Must match 'ItemUniforms' in general_shader_3d.hpp
+struct ItemData
+{
+    mat4 world_from_local;
+    mat3 world_from_local_normals;
+
+    vec3 uniform_color;
+    int coloring;
+
+    vec3 light_direction;
+    int shading;
+
+    vec3 light_color;
+    float opacity;
 
-uniform int shading = SHADING_COLOR;
-uniform vec3 light_direction = {-1.f, -1.f, -1.f};
-uniform vec3 light_color = {1.f, 1.f, 1.f};
-uniform vec3 ambient_color = {0.15f, 0.15f, 0.15f};
+    vec3 ambient_color;
+    int has_instance_colors;
+};
+
+#ifdef BATCHED_DRAWS
+layout(location = 4) flat in uint item_index;
+
+layout(std430, binding = 2) readonly buffer BatchedItems
+{
+    ItemData batched_items[];
+};
+#define ITEM batched_items[item_index]
+#else
+layout(std140, binding = 1) uniform ItemUniforms
+{
+    ItemData item_uniforms;
+};
+#define ITEM item_uniforms
+#endif
 
 layout(location = 0) out vec4 out_color;
 
@@ -66,7 +95,7 @@ void main()
 {
     vec3 shape_color = {1.f, 1.f, 1.f};
 
-    switch (coloring) {
+    switch (ITEM.coloring) {
         case COLORING_POSITIONS:
             shape_color = world_position;
             break;
@@ -84,7 +113,12 @@ void main()
             break;
 
         case COLORING_UNIFORM_COLOR:
-            shape_color = uniform_color;
+            shape_color = ITEM.uniform_color;
+#ifdef INSTANCED_DRAWS
+            if (ITEM.has_instance_colors != 0) {
+                shape_color = instance_color;
+            }
+#endif
             break;
 
         case COLORING_TEXTURE: // TODO
@@ -96,18 +130,18 @@ void main()
     vec3 final_color = {1.f, 1.f, 1.f};
 
     vec3 surface_normal = normalize(world_normal);
-    vec3 direction_to_light = normalize(-light_direction);
+    vec3 direction_to_light = normalize(-ITEM.light_direction);
 
-    switch (shading) {
+    switch (ITEM.shading) {
         case SHADING_COLOR:
             final_color = shape_color;
             break;
 
         case SHADING_LAMBERTIAN:
-            vec3 diffuse_lighting = max(0.f, dot(surface_normal, direction_to_light)) * light_color;
-            final_color = (diffuse_lighting + ambient_color) * shape_color;
+            vec3 diffuse_lighting = max(0.f, dot(surface_normal, direction_to_light)) * ITEM.light_color;
+            final_color = (diffuse_lighting + ITEM.ambient_color) * shape_color;
             break;
     }
 
-    out_color = vec4(final_color, opacity);
+    out_color = vec4(final_color, ITEM.opacity);
 }
@@ -27,15 +27,63 @@ layout(location = 0) in vec4 local_position;
 layout(location = 1) in vec3 local_normal;
 layout(location = 2) in vec2 texture_coordinates;
 layout(location = 3) in vec3 vertex_color;
+#ifdef INSTANCED_DRAWS
+// One of each per instance (see 'GeneralShader3D::InstanceTransformation')
+layout(location = 5) in mat4 instance_from_local;
+layout(location = 9) in vec3 instance_color;
+#endif
 
-uniform mat4 world_from_local = mat4(1.f);
-uniform mat3 world_from_local_normals = mat3(1.f);
-uniform mat4 projection_from_local = mat4(1.f);
+// Must match 'FrameUniforms' and 'ItemUniforms' in general_shader_3d.hpp
+layout(std140, binding = 0) uniform FrameUniforms
+{
+    mat4 projection_from_world;
+};
+
+struct ItemData
+{
+    mat4 world_from_local;
+    mat3 world_from_local_normals;
+
+    vec3 uniform_color;
+    int coloring;
+
+    vec3 light_direction;
+    int shading;
+
+    vec3 light_color;
+    float opacity;
+
+    vec3 ambient_color;
+    int has_instance_colors;
+};
+
+#ifdef BATCHED_DRAWS
+// Each draw in a batch finds its item with the base instance (see 'MeshBatch')
+layout(location = 4) in uint item_index;
+
+layout(std430, binding = 2) readonly buffer BatchedItems
+{
+    ItemData batched_items[];
+};
+#define ITEM batched_items[item_index]
+#else
+layout(std140, binding = 1) uniform ItemUniforms
+{
+    ItemData item_uniforms;
+};
+#define ITEM item_uniforms
+#endif
 
 layout(location = 0) out vec3 world_position_out;
 layout(location = 1) out vec3 world_normal_out;
 layout(location = 2) out vec2 texture_coordinates_out;
 layout(location = 3) out vec3 vertex_color_out;
+#ifdef BATCHED_DRAWS
+layout(location = 4) flat out uint item_index_out;
+#endif
+#ifdef INSTANCED_DRAWS
+layout(location = 5) flat out vec3 instance_color_out;
+#endif
 
 out gl_PerVertex
 {
@@ -44,10 +92,23 @@ out gl_PerVertex
 
 void main()
 {
-    world_position_out       = vec3(world_from_local * local_position);
-    world_normal_out         = world_from_local_normals * local_normal;
+#ifdef INSTANCED_DRAWS
+    // Normals assume instances are only rotated and uniformly scaled
+    vec4 world_position = ITEM.world_from_local * instance_from_local * local_position;
+    vec3 world_normal   = ITEM.world_from_local_normals * mat3(instance_from_local) * local_normal;
+    instance_color_out  = instance_color;
+#else
+    vec4 world_position = ITEM.world_from_local * local_position;
+    vec3 world_normal   = ITEM.world_from_local_normals * local_normal;
+#endif
+
+    world_position_out       = vec3(world_position);
+    world_normal_out         = world_normal;
     texture_coordinates_out = texture_coordinates;
     vertex_color_out        = vertex_color;
+#ifdef BATCHED_DRAWS
+    item_index_out          = item_index;
+#endif
 
-    gl_Position = projection_from_local * local_position;
+    gl_Position = projection_from_world * world_position;
 }
@@ -0,0 +1,252 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "aabb_tree.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace gvs::util {
+
+bool Aabb::empty() const {
+    return min[0] > max[0] || min[1] > max[1] || min[2] > max[2];
+}
+
+float Aabb::surface_area() const {
+    if (empty()) {
+        return 0.f;
+    }
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+    return 2.f * (dx * dy + dy * dz + dz * dx);
+}
+
+Aabb& Aabb::expand(const Vec3f& point) {
+    for (auto i = 0u; i < 3u; ++i) {
+        min[i] = std::min(min[i], point[i]);
+        max[i] = std::max(max[i], point[i]);
+    }
+    return *this;
+}
+
+Aabb Aabb::padded(float amount) const {
+    Aabb result = *this;
+    for (auto i = 0u; i < 3u; ++i) {
+        result.min[i] -= amount;
+        result.max[i] += amount;
+    }
+    return result;
+}
+
+bool Aabb::contains(const Aabb& other) const {
+    for (auto i = 0u; i < 3u; ++i) {
+        if (other.min[i] < min[i] || other.max[i] > max[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Aabb::overlaps(const Aabb& other) const {
+    for (auto i = 0u; i < 3u; ++i) {
+        if (other.max[i] < min[i] || other.min[i] > max[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Aabb Aabb::transformed(const float* m) const {
+    if (empty()) {
+        return *this;
+    }
+
+    // Arvo's method: each output axis is the translation plus the min/max contribution of each input axis
+    Aabb result;
+    for (auto row = 0u; row < 3u; ++row) {
+        result.min[row] = result.max[row] = m[12 + row];
+
+        for (auto col = 0u; col < 3u; ++col) {
+            float a = m[col * 4 + row] * min[col];
+            float b = m[col * 4 + row] * max[col];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+Aabb merge(const Aabb& a, const Aabb& b) {
+    Aabb result;
+    for (auto i = 0u; i < 3u; ++i) {
+        result.min[i] = std::min(a.min[i], b.min[i]);
+        result.max[i] = std::max(a.max[i], b.max[i]);
+    }
+    return result;
+}
+
+float ray_entry_distance(const Aabb& box, const Vec3f& origin, const Vec3f& inverse_direction, float max_distance) {
+    float t_min = 0.f;
+    float t_max = max_distance;
+
+    for (auto i = 0u; i < 3u; ++i) {
+        float t1 = (box.min[i] - origin[i]) * inverse_direction[i];
+        float t2 = (box.max[i] - origin[i]) * inverse_direction[i];
+
+        // NaN occurs when the ray lies exactly on a slab boundary with a zero direction component
+        if (std::isnan(t1) || std::isnan(t2)) {
+            continue;
+        }
+
+        t_min = std::max(t_min, std::min(t1, t2));
+        t_max = std::min(t_max, std::max(t1, t2));
+    }
+
+    return (t_min <= t_max ? t_min : std::numeric_limits<float>::infinity());
+}
+
+TEST_CASE("[util] aabb helpers") {
+    Aabb box;
+    CHECK(box.empty());
+
+    box.expand(Vec3f{0.f, 0.f, 0.f}).expand(Vec3f{1.f, 2.f, 3.f});
+    CHECK_FALSE(box.empty());
+    CHECK(box.surface_area() == doctest::Approx(2.f * (2.f + 6.f + 3.f)));
+
+    Aabb inside;
+    inside.expand(Vec3f{0.5f, 0.5f, 0.5f});
+    CHECK(box.contains(inside));
+    CHECK(box.overlaps(inside));
+    CHECK_FALSE(inside.contains(box));
+
+    // clang-format off
+    const float translate_and_scale[] = {
+        2.f, 0.f, 0.f, 0.f,
+        0.f, 2.f, 0.f, 0.f,
+        0.f, 0.f, 2.f, 0.f,
+        1.f, 1.f, 1.f, 1.f,
+    };
+    // clang-format on
+    Aabb moved = box.transformed(translate_and_scale);
+    CHECK(moved.min == Vec3f{1.f, 1.f, 1.f});
+    CHECK(moved.max == Vec3f{3.f, 5.f, 7.f});
+
+    constexpr auto inf = std::numeric_limits<float>::infinity();
+    Vec3f origin = {-1.f, 0.5f, 0.5f};
+    CHECK(ray_entry_distance(box, origin, {1.f, inf, inf}, 100.f) == doctest::Approx(1.f));
+    CHECK(std::isinf(ray_entry_distance(box, origin, {-1.f, inf, inf}, 100.f)));
+    CHECK(std::isinf(ray_entry_distance(box, origin, {1.f, inf, inf}, 0.5f)));
+}
+
+TEST_CASE("[util] aabb tree matches brute force queries") {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> position(-100.f, 100.f);
+    std::uniform_real_distribution<float> size(0.1f, 5.f);
+
+    auto random_box = [&] {
+        Vec3f p = {position(gen), position(gen), position(gen)};
+        Aabb box;
+        box.expand(p).expand(Vec3f{p[0] + size(gen), p[1] + size(gen), p[2] + size(gen)});
+        return box;
+    };
+
+    AabbTree<int> tree;
+    std::vector<Aabb> boxes;
+    std::vector<AabbTree<int>::ProxyId> proxies;
+
+    for (auto i = 0u; i < 1000u; ++i) {
+        boxes.emplace_back(random_box());
+        proxies.emplace_back(tree.insert(boxes.back(), static_cast<int>(i)));
+    }
+
+    // Move half and remove a quarter of the boxes
+    for (auto i = 0u; i < 500u; ++i) {
+        boxes[i] = random_box();
+        tree.update(proxies[i], boxes[i]);
+    }
+    for (auto i = 750u; i < 1000u; ++i) {
+        tree.remove(proxies[i]);
+    }
+    boxes.resize(750);
+
+    CHECK(tree.size() == 750u);
+    CHECK(tree.height() < 30); // a balanced tree of 750 leaves has a height close to 10
+
+    SUBCASE("box queries") {
+        for (int q = 0; q < 50; ++q) {
+            Aabb query_box = random_box().padded(10.f);
+
+            std::vector<int> found;
+            tree.query(query_box, [&](auto proxy) {
+                // The tree returns fat bounds so filter using the exact bounds
+                if (boxes[static_cast<std::size_t>(tree.data(proxy))].overlaps(query_box)) {
+                    found.emplace_back(tree.data(proxy));
+                }
+                return true;
+            });
+
+            std::vector<int> expected;
+            for (auto i = 0u; i < boxes.size(); ++i) {
+                if (boxes[i].overlaps(query_box)) {
+                    expected.emplace_back(static_cast<int>(i));
+                }
+            }
+
+            std::sort(found.begin(), found.end());
+            CHECK(found == expected);
+        }
+    }
+
+    SUBCASE("ray queries") {
+        Vec3f origin = {-200.f, 0.f, 0.f};
+        Vec3f direction = {1.f, 0.01f, -0.02f};
+        Vec3f inverse_direction = {1.f / direction[0], 1.f / direction[1], 1.f / direction[2]};
+
+        std::vector<int> found;
+        tree.raycast(origin, direction, 1000.f, [&](auto proxy, float) {
+            auto index = tree.data(proxy);
+            const Aabb& box = boxes[static_cast<std::size_t>(index)];
+            if (not std::isinf(ray_entry_distance(box, origin, inverse_direction, 1000.f))) {
+                found.emplace_back(index);
+            }
+            return 1000.f;
+        });
+
+        std::vector<int> expected;
+        for (auto i = 0u; i < boxes.size(); ++i) {
+            if (not std::isinf(ray_entry_distance(boxes[i], origin, inverse_direction, 1000.f))) {
+                expected.emplace_back(static_cast<int>(i));
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+    }
+}
+
+} // namespace gvs::util
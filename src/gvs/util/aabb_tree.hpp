@@ -0,0 +1,486 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace gvs::util {
+
+using Vec3f = std::array<float, 3>;
+
+/**
+ * @brief An axis aligned bounding box. Default constructed boxes are empty.
+ */
+struct Aabb {
+    Vec3f min = {std::numeric_limits<float>::infinity(),
+                 std::numeric_limits<float>::infinity(),
+                 std::numeric_limits<float>::infinity()};
+    Vec3f max = {-std::numeric_limits<float>::infinity(),
+                 -std::numeric_limits<float>::infinity(),
+                 -std::numeric_limits<float>::infinity()};
+
+    bool empty() const;
+    float surface_area() const;
+
+    Aabb& expand(const Vec3f& point);
+
+    /// \brief Grow the box by 'amount' in every direction
+    Aabb padded(float amount) const;
+
+    bool contains(const Aabb& other) const;
+    bool overlaps(const Aabb& other) const;
+
+    /// \brief The bounds of this box after transforming it by a column major 4x4 matrix
+    Aabb transformed(const float* column_major_matrix) const;
+};
+
+Aabb merge(const Aabb& a, const Aabb& b);
+
+/**
+ * @brief Returns the distance along the ray at which it enters the box, or infinity if it misses.
+ *
+ * 'inverse_direction' is 1 / direction (component-wise) so it can be reused for many boxes.
+ */
+float ray_entry_distance(const Aabb& box, const Vec3f& origin, const Vec3f& inverse_direction, float max_distance);
+
+/**
+ * @brief A dynamic bounding volume hierarchy over objects of type T.
+ *
+ * Leaves store "fat" bounds that are padded by a fraction of the object's size so small
+ * movements don't require any changes to the tree. Insertion picks the sibling that
+ * minimizes the added surface area and the tree is kept balanced with rotations.
+ *
+ * Based on the dynamic tree in Box2D (https://github.com/erincatto/box2d).
+ */
+template <typename T>
+class AabbTree {
+public:
+    using ProxyId = std::uint32_t;
+    static constexpr ProxyId null_proxy = std::numeric_limits<ProxyId>::max();
+
+    /// \param margin_fraction - leaf bounds are padded by this fraction of their largest dimension
+    explicit AabbTree(float margin_fraction = 0.1f);
+
+    ProxyId insert(const Aabb& bounds, T data);
+    void remove(ProxyId proxy);
+
+    /// \brief Move an object. Returns true if the tree structure changed.
+    bool update(ProxyId proxy, const Aabb& bounds);
+
+    void clear();
+
+    const T& data(ProxyId proxy) const;
+    T& data(ProxyId proxy);
+
+    const Aabb& fat_bounds(ProxyId proxy) const;
+
+    std::size_t size() const;
+    int height() const;
+
+    /// \brief Calls 'callback(ProxyId)' for every leaf whose fat bounds overlap 'box'.
+    ///        Stops early if the callback returns false.
+    template <typename Callback>
+    void query(const Aabb& box, Callback&& callback) const;
+
+    /// \brief Calls 'callback(ProxyId, float entry_distance)' for every leaf whose fat bounds
+    ///        are hit by the ray. The callback returns the new maximum distance to search
+    ///        (return 'max_distance' to find all hits, 0 to stop).
+    template <typename Callback>
+    void raycast(const Vec3f& origin, const Vec3f& direction, float max_distance, Callback&& callback) const;
+
+private:
+    struct Node {
+        Aabb bounds;
+        T data = {};
+        ProxyId parent_or_next = null_proxy; ///< Parent if allocated, next free node otherwise
+        ProxyId child1 = null_proxy;
+        ProxyId child2 = null_proxy;
+        int height = -1; ///< 0 for leaves, -1 for free nodes
+
+        bool is_leaf() const { return child1 == null_proxy; }
+    };
+
+    std::vector<Node> nodes_;
+    ProxyId root_ = null_proxy;
+    ProxyId free_list_ = null_proxy;
+    std::size_t size_ = 0;
+    float margin_fraction_;
+
+    ProxyId allocate_node();
+    void free_node(ProxyId node);
+
+    Aabb fatten(const Aabb& bounds) const;
+
+    void insert_leaf(ProxyId leaf);
+    void remove_leaf(ProxyId leaf);
+    void refit_ancestors(ProxyId node);
+    ProxyId balance(ProxyId a);
+};
+
+template <typename T>
+AabbTree<T>::AabbTree(float margin_fraction) : margin_fraction_(margin_fraction) {}
+
+template <typename T>
+typename AabbTree<T>::ProxyId AabbTree<T>::insert(const Aabb& bounds, T data) {
+    ProxyId proxy = allocate_node();
+    nodes_[proxy].bounds = fatten(bounds);
+    nodes_[proxy].data = std::move(data);
+    nodes_[proxy].height = 0;
+    insert_leaf(proxy);
+    ++size_;
+    return proxy;
+}
+
+template <typename T>
+void AabbTree<T>::remove(ProxyId proxy) {
+    assert(proxy < nodes_.size() && nodes_[proxy].is_leaf());
+    remove_leaf(proxy);
+    free_node(proxy);
+    --size_;
+}
+
+template <typename T>
+bool AabbTree<T>::update(ProxyId proxy, const Aabb& bounds) {
+    assert(proxy < nodes_.size() && nodes_[proxy].is_leaf());
+
+    if (nodes_[proxy].bounds.contains(bounds)) {
+        return false;
+    }
+
+    remove_leaf(proxy);
+    nodes_[proxy].bounds = fatten(bounds);
+    insert_leaf(proxy);
+    return true;
+}
+
+template <typename T>
+void AabbTree<T>::clear() {
+    nodes_.clear();
+    root_ = null_proxy;
+    free_list_ = null_proxy;
+    size_ = 0;
+}
+
+template <typename T>
+const T& AabbTree<T>::data(ProxyId proxy) const {
+    return nodes_[proxy].data;
+}
+
+template <typename T>
+T& AabbTree<T>::data(ProxyId proxy) {
+    return nodes_[proxy].data;
+}
+
+template <typename T>
+const Aabb& AabbTree<T>::fat_bounds(ProxyId proxy) const {
+    return nodes_[proxy].bounds;
+}
+
+template <typename T>
+std::size_t AabbTree<T>::size() const {
+    return size_;
+}
+
+template <typename T>
+int AabbTree<T>::height() const {
+    return root_ == null_proxy ? 0 : nodes_[root_].height;
+}
+
+template <typename T>
+template <typename Callback>
+void AabbTree<T>::query(const Aabb& box, Callback&& callback) const {
+    std::vector<ProxyId> stack;
+    stack.reserve(64);
+    stack.push_back(root_);
+
+    while (not stack.empty()) {
+        ProxyId id = stack.back();
+        stack.pop_back();
+
+        if (id == null_proxy) {
+            continue;
+        }
+
+        const Node& node = nodes_[id];
+
+        if (node.bounds.overlaps(box)) {
+            if (node.is_leaf()) {
+                if (not callback(id)) {
+                    return;
+                }
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+}
+
+template <typename T>
+template <typename Callback>
+void AabbTree<T>::raycast(const Vec3f& origin,
+                          const Vec3f& direction,
+                          float max_distance,
+                          Callback&& callback) const {
+    const Vec3f inverse_direction = {1.f / direction[0], 1.f / direction[1], 1.f / direction[2]};
+
+    std::vector<ProxyId> stack;
+    stack.reserve(64);
+    stack.push_back(root_);
+
+    while (not stack.empty()) {
+        ProxyId id = stack.back();
+        stack.pop_back();
+
+        if (id == null_proxy) {
+            continue;
+        }
+
+        const Node& node = nodes_[id];
+        float distance = ray_entry_distance(node.bounds, origin, inverse_direction, max_distance);
+
+        if (distance > max_distance) {
+            continue;
+        }
+
+        if (node.is_leaf()) {
+            max_distance = callback(id, distance);
+
+            if (max_distance <= 0.f) {
+                return;
+            }
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename T>
+typename AabbTree<T>::ProxyId AabbTree<T>::allocate_node() {
+    if (free_list_ == null_proxy) {
+        nodes_.emplace_back();
+        return static_cast<ProxyId>(nodes_.size() - 1);
+    }
+
+    ProxyId node = free_list_;
+    free_list_ = nodes_[node].parent_or_next;
+    nodes_[node] = Node{};
+    return node;
+}
+
+template <typename T>
+void AabbTree<T>::free_node(ProxyId node) {
+    nodes_[node] = Node{};
+    nodes_[node].parent_or_next = free_list_;
+    free_list_ = node;
+}
+
+template <typename T>
+Aabb AabbTree<T>::fatten(const Aabb& bounds) const {
+    float largest_dimension = 0.f;
+    for (auto i = 0u; i < 3u; ++i) {
+        largest_dimension = std::max(largest_dimension, bounds.max[i] - bounds.min[i]);
+    }
+    return bounds.padded(largest_dimension * margin_fraction_);
+}
+
+template <typename T>
+void AabbTree<T>::insert_leaf(ProxyId leaf) {
+    if (root_ == null_proxy) {
+        root_ = leaf;
+        nodes_[root_].parent_or_next = null_proxy;
+        return;
+    }
+
+    // Find the best sibling by descending towards the child with the lowest cost
+    const Aabb leaf_bounds = nodes_[leaf].bounds;
+    ProxyId index = root_;
+
+    while (not nodes_[index].is_leaf()) {
+        const Node& node = nodes_[index];
+
+        float area = node.bounds.surface_area();
+        float combined_area = merge(node.bounds, leaf_bounds).surface_area();
+
+        // Cost of creating a new parent for this node and the new leaf
+        float cost = 2.f * combined_area;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritance_cost = 2.f * (combined_area - area);
+
+        auto descend_cost = [&](ProxyId child) {
+            const Aabb merged = merge(leaf_bounds, nodes_[child].bounds);
+            if (nodes_[child].is_leaf()) {
+                return merged.surface_area() + inheritance_cost;
+            }
+            return merged.surface_area() - nodes_[child].bounds.surface_area() + inheritance_cost;
+        };
+
+        float cost1 = descend_cost(node.child1);
+        float cost2 = descend_cost(node.child2);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+
+        index = (cost1 < cost2 ? node.child1 : node.child2);
+    }
+
+    ProxyId sibling = index;
+
+    // Create a new parent
+    ProxyId old_parent = nodes_[sibling].parent_or_next;
+    ProxyId new_parent = allocate_node();
+    nodes_[new_parent].parent_or_next = old_parent;
+    nodes_[new_parent].bounds = merge(leaf_bounds, nodes_[sibling].bounds);
+    nodes_[new_parent].height = nodes_[sibling].height + 1;
+    nodes_[new_parent].child1 = sibling;
+    nodes_[new_parent].child2 = leaf;
+    nodes_[sibling].parent_or_next = new_parent;
+    nodes_[leaf].parent_or_next = new_parent;
+
+    if (old_parent == null_proxy) {
+        root_ = new_parent;
+    } else if (nodes_[old_parent].child1 == sibling) {
+        nodes_[old_parent].child1 = new_parent;
+    } else {
+        nodes_[old_parent].child2 = new_parent;
+    }
+
+    refit_ancestors(new_parent);
+}
+
+template <typename T>
+void AabbTree<T>::remove_leaf(ProxyId leaf) {
+    if (leaf == root_) {
+        root_ = null_proxy;
+        return;
+    }
+
+    ProxyId parent = nodes_[leaf].parent_or_next;
+    ProxyId grand_parent = nodes_[parent].parent_or_next;
+    ProxyId sibling = (nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1);
+
+    if (grand_parent == null_proxy) {
+        root_ = sibling;
+        nodes_[sibling].parent_or_next = null_proxy;
+        free_node(parent);
+        return;
+    }
+
+    // Connect the sibling to the grand parent and destroy the parent
+    if (nodes_[grand_parent].child1 == parent) {
+        nodes_[grand_parent].child1 = sibling;
+    } else {
+        nodes_[grand_parent].child2 = sibling;
+    }
+    nodes_[sibling].parent_or_next = grand_parent;
+    free_node(parent);
+
+    refit_ancestors(grand_parent);
+}
+
+template <typename T>
+void AabbTree<T>::refit_ancestors(ProxyId node) {
+    while (node != null_proxy) {
+        node = balance(node);
+
+        Node& n = nodes_[node];
+        n.height = 1 + std::max(nodes_[n.child1].height, nodes_[n.child2].height);
+        n.bounds = merge(nodes_[n.child1].bounds, nodes_[n.child2].bounds);
+
+        node = n.parent_or_next;
+    }
+}
+
+// Performs a left or right rotation if node 'a' is imbalanced. Returns the new root index.
+template <typename T>
+typename AabbTree<T>::ProxyId AabbTree<T>::balance(ProxyId a) {
+    if (nodes_[a].is_leaf() || nodes_[a].height < 2) {
+        return a;
+    }
+
+    ProxyId b = nodes_[a].child1;
+    ProxyId c = nodes_[a].child2;
+    int height_difference = nodes_[c].height - nodes_[b].height;
+
+    // Rotate the taller child up. 'rotate(x, y)' lifts child 'x' of 'a' where 'y' is the other child.
+    auto rotate = [&](ProxyId up, ProxyId other, bool up_is_child2) {
+        ProxyId f = nodes_[up].child1;
+        ProxyId g = nodes_[up].child2;
+
+        // Swap 'a' and 'up'
+        nodes_[up].child1 = a;
+        nodes_[up].parent_or_next = nodes_[a].parent_or_next;
+        nodes_[a].parent_or_next = up;
+
+        ProxyId up_parent = nodes_[up].parent_or_next;
+        if (up_parent == null_proxy) {
+            root_ = up;
+        } else if (nodes_[up_parent].child1 == a) {
+            nodes_[up_parent].child1 = up;
+        } else {
+            nodes_[up_parent].child2 = up;
+        }
+
+        // Keep the taller grandchild under 'up' and give the shorter one to 'a'
+        ProxyId keep = (nodes_[f].height > nodes_[g].height ? f : g);
+        ProxyId give = (keep == f ? g : f);
+
+        nodes_[up].child2 = keep;
+        if (up_is_child2) {
+            nodes_[a].child2 = give;
+        } else {
+            nodes_[a].child1 = give;
+        }
+        nodes_[give].parent_or_next = a;
+
+        nodes_[a].bounds = merge(nodes_[other].bounds, nodes_[give].bounds);
+        nodes_[a].height = 1 + std::max(nodes_[other].height, nodes_[give].height);
+
+        nodes_[up].bounds = merge(nodes_[a].bounds, nodes_[keep].bounds);
+        nodes_[up].height = 1 + std::max(nodes_[a].height, nodes_[keep].height);
+
+        return up;
+    };
+
+    if (height_difference > 1) {
+        return rotate(c, b, true);
+    }
+
+    if (height_difference < -1) {
+        return rotate(b, c, false);
+    }
+
+    return a;
+}
+
+} // namespace gvs::util
@@ -0,0 +1,97 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "attribute_view.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Raw attribute bytes are little-endian and can only be viewed directly on little-endian hosts"
+#endif
+
+namespace gvs::util {
+
+namespace {
+
+template <typename T, typename List>
+AttributeView<T> view(const List& list) {
+    const std::string& bytes = list.data();
+
+    if (bytes.empty()) {
+        return {list.value().data(), static_cast<std::size_t>(list.value_size())};
+    }
+
+    // Protobuf strings are heap allocated (or stored inline in a std::string) so they are always
+    // aligned well enough for 4-byte elements
+    assert(reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) == 0);
+    return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+}
+
+} // namespace
+
+AttributeView<float> attribute_view(const proto::FloatList& list) {
+    return view<float>(list);
+}
+
+AttributeView<unsigned> attribute_view(const proto::UIntList& list) {
+    return view<unsigned>(list);
+}
+
+TEST_CASE("[util] attribute_view_reads_values_or_raw_bytes") {
+    std::vector<float> floats = {1.f, -2.5f, 3.f, 1e6f};
+
+    gvs::proto::FloatList repeated;
+    *repeated.mutable_value() = {floats.begin(), floats.end()};
+
+    gvs::proto::FloatList raw;
+    raw.set_data(reinterpret_cast<const char*>(floats.data()), floats.size() * sizeof(float));
+
+    // Both encodings survive a round trip through the wire format
+    gvs::proto::FloatList parsed;
+    REQUIRE(parsed.ParseFromString(raw.SerializeAsString()));
+
+    AttributeView<float> repeated_view = attribute_view(repeated);
+    AttributeView<float> parsed_view = attribute_view(parsed);
+    CHECK(std::equal(repeated_view.begin(), repeated_view.end(), floats.begin(), floats.end()));
+    CHECK(std::equal(parsed_view.begin(), parsed_view.end(), floats.begin(), floats.end()));
+
+    // Raw bytes are used in place
+    CHECK(attribute_view(raw).data() == reinterpret_cast<const float*>(raw.data().data()));
+
+    gvs::proto::UIntList indices;
+    std::vector<unsigned> index_values = {0u, 1u, 2u, 0xffffffffu};
+    indices.set_data(reinterpret_cast<const char*>(index_values.data()), index_values.size() * sizeof(unsigned));
+
+    AttributeView<unsigned> index_view = attribute_view(indices);
+    CHECK(std::equal(index_view.begin(), index_view.end(), index_values.begin(), index_values.end()));
+
+    CHECK(attribute_view(gvs::proto::UIntList{}).empty());
+}
+
+} // namespace gvs::util
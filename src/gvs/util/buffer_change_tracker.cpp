@@ -0,0 +1,151 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "buffer_change_tracker.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <string_view>
+
+namespace gvs::util {
+
+BufferChangeTracker::BufferChangeTracker(std::size_t chunk_size) : chunk_size_(std::max(chunk_size, std::size_t(1))) {}
+
+std::vector<std::size_t>
+BufferChangeTracker::hash_chunks(const void* data, std::size_t size, std::size_t chunk_size) {
+    const char* bytes = static_cast<const char*>(data);
+    chunk_size = std::max(chunk_size, std::size_t(1));
+
+    std::vector<std::size_t> hashes;
+    hashes.reserve((size + chunk_size - 1u) / chunk_size);
+
+    for (std::size_t offset = 0; offset < size; offset += chunk_size) {
+        std::string_view chunk(bytes + offset, std::min(chunk_size, size - offset));
+        hashes.emplace_back(std::hash<std::string_view>{}(chunk));
+    }
+    return hashes;
+}
+
+std::vector<ByteRange> BufferChangeTracker::update(const void* data, std::size_t size) {
+    return update(hash_chunks(data, size, chunk_size_), size);
+}
+
+std::vector<ByteRange> BufferChangeTracker::update(std::vector<std::size_t> chunk_hashes, std::size_t size) {
+    bool resized = (size != size_ or chunk_hashes.size() != chunk_hashes_.size());
+
+    std::vector<ByteRange> changed;
+
+    for (std::size_t chunk = 0; chunk < chunk_hashes.size(); ++chunk) {
+        if (not resized and chunk_hashes[chunk] == chunk_hashes_[chunk]) {
+            continue;
+        }
+
+        std::size_t offset = chunk * chunk_size_;
+        std::size_t chunk_size = std::min(chunk_size_, size - offset);
+
+        if (not changed.empty() and changed.back().offset + changed.back().size == offset) {
+            changed.back().size += chunk_size;
+        } else {
+            changed.push_back({offset, chunk_size});
+        }
+    }
+
+    size_ = size;
+    chunk_hashes_ = std::move(chunk_hashes);
+
+    return changed;
+}
+
+std::size_t BufferChangeTracker::chunk_size() const {
+    return chunk_size_;
+}
+
+void BufferChangeTracker::clear() {
+    size_ = 0;
+    chunk_hashes_.clear();
+}
+
+std::size_t grown_capacity(std::size_t capacity, std::size_t required) {
+    if (required <= capacity) {
+        return capacity;
+    }
+    return std::max(required, capacity * 2u);
+}
+
+TEST_CASE("[util] buffer change tracker") {
+    BufferChangeTracker tracker(4u);
+
+    std::vector<char> data(10u, 'a');
+
+    // Everything is new
+    std::vector<ByteRange> changed = tracker.update(data.data(), data.size());
+    REQUIRE(changed.size() == 1u);
+    CHECK(changed[0].offset == 0u);
+    CHECK(changed[0].size == 10u);
+
+    CHECK(tracker.update(data.data(), data.size()).empty());
+
+    // Only the modified chunks are reported and adjacent chunks are merged
+    data[1] = 'b';
+    data[9] = 'b';
+    changed = tracker.update(data.data(), data.size());
+    REQUIRE(changed.size() == 2u);
+    CHECK(changed[0].offset == 0u);
+    CHECK(changed[0].size == 4u);
+    CHECK(changed[1].offset == 8u);
+    CHECK(changed[1].size == 2u);
+
+    data[4] = 'b';
+    data[8] = 'c';
+    changed = tracker.update(data.data(), data.size());
+    REQUIRE(changed.size() == 1u);
+    CHECK(changed[0].offset == 4u);
+    CHECK(changed[0].size == 6u);
+
+    // Resizing or clearing reports everything
+    data.push_back('a');
+    CHECK(tracker.update(data.data(), data.size()).front().size == 11u);
+
+    tracker.clear();
+    CHECK(tracker.update(data.data(), data.size()).front().size == 11u);
+
+    CHECK(tracker.update(nullptr, 0u).empty());
+
+    // Hashes can be computed ahead of time
+    data[0] = 'z';
+    auto hashes = BufferChangeTracker::hash_chunks(data.data(), data.size(), tracker.chunk_size());
+    CHECK(hashes.size() == 3u);
+    CHECK(tracker.update(hashes, data.size()).front().size == 11u);
+    CHECK(tracker.update(hashes, data.size()).empty());
+}
+
+TEST_CASE("[util] grown capacity") {
+    CHECK(grown_capacity(0u, 10u) == 10u);
+    CHECK(grown_capacity(10u, 5u) == 10u);
+    CHECK(grown_capacity(10u, 11u) == 20u);
+    CHECK(grown_capacity(10u, 25u) == 25u);
+}
+
+} // namespace gvs::util
@@ -0,0 +1,77 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <cstddef>
+#include <vector>
+
+namespace gvs::util {
+
+struct ByteRange {
+    std::size_t offset;
+    std::size_t size;
+};
+
+/**
+ * @brief Finds the parts of a buffer that changed since it was last seen so only those
+ *        parts have to be uploaded again.
+ *
+ * The buffer is split into fixed size chunks and a hash of each chunk is kept instead of
+ * a copy of the data.
+ */
+class BufferChangeTracker {
+public:
+    static constexpr std::size_t default_chunk_size = 64u * 1024u;
+
+    explicit BufferChangeTracker(std::size_t chunk_size = default_chunk_size);
+
+    /// \brief Hashes each chunk of 'data'. Can be called on any thread and passed to 'update' later.
+    static std::vector<std::size_t>
+    hash_chunks(const void* data, std::size_t size, std::size_t chunk_size = default_chunk_size);
+
+    /// \brief Returns the ranges of 'data' that differ from the data passed to the previous call
+    ///        (adjacent ranges are merged). Everything has changed if the size is different.
+    std::vector<ByteRange> update(const void* data, std::size_t size);
+
+    /// \brief Same as above using hashes from 'hash_chunks' computed with this tracker's chunk size
+    std::vector<ByteRange> update(std::vector<std::size_t> chunk_hashes, std::size_t size);
+
+    std::size_t chunk_size() const;
+
+    /// \brief Forgets the previous data so the next update reports everything as changed
+    void clear();
+
+private:
+    std::size_t chunk_size_;
+    std::size_t size_ = 0;
+    std::vector<std::size_t> chunk_hashes_;
+};
+
+/**
+ * @brief The capacity to allocate so 'required' bytes fit. Grows geometrically so buffers
+ *        that keep getting bigger are only reallocated a logarithmic number of times.
+ */
+std::size_t grown_capacity(std::size_t capacity, std::size_t required);
+
+} // namespace gvs::util
@@ -0,0 +1,237 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "frame_profiler.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace gvs::util {
+
+namespace {
+
+int to_thread_id(FrameProfiler::Track track) {
+    switch (track) {
+    case FrameProfiler::Track::RenderThread:
+        return 1;
+    case FrameProfiler::Track::Workers:
+        return 2;
+    case FrameProfiler::Track::Gpu:
+        return 3;
+    }
+    return 0;
+}
+
+void write_json_string(std::ostream& out, const std::string& str) {
+    out << '"';
+    for (char c : str) {
+        switch (c) {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20u) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+            } else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+void write_event(std::ostream& out, const FrameProfiler::Event& event, std::uint64_t frame_index) {
+    out << ",\n{\"name\":";
+    write_json_string(out, event.name);
+    out << ",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << to_thread_id(event.track)
+        << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us << ",\"args\":{\"frame\":" << frame_index;
+
+    if (not event.detail.empty()) {
+        out << ",\"detail\":";
+        write_json_string(out, event.detail);
+    }
+    out << "}}";
+}
+
+} // namespace
+
+FrameProfiler::Scope::Scope(FrameProfiler* profiler, const char* name)
+    : profiler_(profiler), name_(name), start_(Clock::now()) {}
+
+FrameProfiler::Scope::~Scope() {
+    profiler_->add_event(name_, start_, Clock::now());
+}
+
+FrameProfiler::FrameProfiler(std::size_t max_frames) : max_frames_(std::max(max_frames, std::size_t(1))) {}
+
+void FrameProfiler::begin_frame() {
+    if (frames_.size() == max_frames_) {
+        frames_.pop_front();
+    }
+    ++frame_index_;
+    frames_.push_back({frame_index_, to_us(Clock::now()), 0.0, {}});
+}
+
+void FrameProfiler::end_frame() {
+    if (not frames_.empty()) {
+        frames_.back().duration_us = to_us(Clock::now()) - frames_.back().start_us;
+    }
+}
+
+FrameProfiler::Scope FrameProfiler::scope(const char* name) {
+    return Scope(this, name);
+}
+
+void FrameProfiler::add_event(
+    const char* name, Clock::time_point start, Clock::time_point end, Track track, std::string detail) {
+    if (frames_.empty()) {
+        return;
+    }
+    double start_us = to_us(start);
+    frames_.back().events.push_back({name, std::move(detail), start_us, to_us(end) - start_us, track});
+}
+
+void FrameProfiler::add_gpu_time(std::uint64_t frame_index, const char* name, double duration_us) {
+    if (frames_.empty() or frame_index < frames_.front().index or frame_index > frames_.back().index) {
+        return;
+    }
+    // Frame indices are consecutive so the frame can be found directly
+    Frame& frame = frames_[static_cast<std::size_t>(frame_index - frames_.front().index)];
+    frame.events.push_back({name, "", frame.start_us, duration_us, Track::Gpu});
+}
+
+std::uint64_t FrameProfiler::frame_index() const {
+    return frame_index_;
+}
+
+const std::deque<FrameProfiler::Frame>& FrameProfiler::frames() const {
+    return frames_;
+}
+
+double FrameProfiler::total_us(const Frame& frame, const char* name) {
+    double total = 0.0;
+    for (const Event& event : frame.events) {
+        if (std::strcmp(event.name, name) == 0) {
+            total += event.duration_us;
+        }
+    }
+    return total;
+}
+
+std::string FrameProfiler::chrome_trace() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    // Names for each track
+    out << "{\"traceEvents\":[\n"
+        << R"({"name":"thread_name","ph":"M","pid":1,"tid":1,"args":{"name":"render thread"}},)"
+        << "\n"
+        << R"({"name":"thread_name","ph":"M","pid":1,"tid":2,"args":{"name":"worker threads"}},)"
+        << "\n"
+        << R"({"name":"thread_name","ph":"M","pid":1,"tid":3,"args":{"name":"gpu"}})";
+
+    for (const Frame& frame : frames_) {
+        write_event(out, {"frame", "", frame.start_us, frame.duration_us, Track::RenderThread}, frame.index);
+
+        for (const Event& event : frame.events) {
+            write_event(out, event, frame.index);
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out.str();
+}
+
+bool FrameProfiler::write_chrome_trace(const std::string& filename) const {
+    std::ofstream file(filename);
+    file << chrome_trace();
+    return static_cast<bool>(file);
+}
+
+void FrameProfiler::clear() {
+    frames_.clear();
+}
+
+double FrameProfiler::to_us(Clock::time_point time) const {
+    return std::chrono::duration<double, std::micro>(time - start_).count();
+}
+
+TEST_CASE("[util] frame profiler") {
+    FrameProfiler profiler(2u);
+    auto start = FrameProfiler::Clock::now();
+
+    // Events outside of a frame are ignored
+    profiler.add_event("update", start, start + std::chrono::milliseconds(1));
+    CHECK(profiler.frames().empty());
+
+    for (int i = 0; i < 3; ++i) {
+        profiler.begin_frame();
+        { auto scope = profiler.scope("render"); }
+        profiler.add_event("upload", start, start + std::chrono::milliseconds(1), FrameProfiler::Track::RenderThread);
+        profiler.add_event("upload", start, start + std::chrono::milliseconds(2), FrameProfiler::Track::RenderThread);
+        profiler.end_frame();
+    }
+
+    // Only the last two frames are kept
+    REQUIRE(profiler.frames().size() == 2u);
+    CHECK(profiler.frame_index() == 3u);
+    CHECK(profiler.frames().front().index == 2u);
+    CHECK(profiler.frames().back().index == 3u);
+
+    const FrameProfiler::Frame& frame = profiler.frames().back();
+    CHECK(frame.events.size() == 3u);
+    CHECK(FrameProfiler::total_us(frame, "upload") == doctest::Approx(3000.0));
+    CHECK(FrameProfiler::total_us(frame, "swap") == 0.0);
+
+    // GPU times are added to stored frames only
+    profiler.add_gpu_time(1u, "gpu render", 10.0);
+    profiler.add_gpu_time(2u, "gpu render", 20.0);
+    CHECK(FrameProfiler::total_us(profiler.frames().front(), "gpu render") == doctest::Approx(20.0));
+    CHECK(profiler.frames().front().events.back().track == FrameProfiler::Track::Gpu);
+
+    // Details are escaped in the trace
+    profiler.add_event("upload", start, start, FrameProfiler::Track::Workers, "item \"a\"\n");
+    std::string trace = profiler.chrome_trace();
+    CHECK(trace.find(R"("detail":"item \"a\"\n")") != std::string::npos);
+    CHECK(trace.find(R"("name":"gpu render")") != std::string::npos);
+    CHECK(trace.find(R"("tid":2)") != std::string::npos);
+
+    profiler.clear();
+    CHECK(profiler.frames().empty());
+}
+
+} // namespace gvs::util
@@ -0,0 +1,126 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief Records when each phase of a frame started and how long it took for the last few
+ *        hundred frames so stutters can be traced back to the work that caused them.
+ *
+ * Only used from the render thread. Work done on other threads is added afterwards with
+ * the times it started and ended. GPU times are usually only known a few frames later so
+ * they are added to the frame they belong to with 'add_gpu_time'.
+ */
+class FrameProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Track {
+        RenderThread,
+        Workers,
+        Gpu,
+    };
+
+    struct Event {
+        const char* name; ///< Events with the same name are summed per frame
+        std::string detail; ///< Shown with the event in traces (an item id for example)
+        double start_us;
+        double duration_us;
+        Track track;
+    };
+
+    struct Frame {
+        std::uint64_t index;
+        double start_us;
+        double duration_us;
+        std::vector<Event> events;
+    };
+
+    /// \brief Times from when the scope is created until it is destroyed
+    class Scope {
+    public:
+        Scope(FrameProfiler* profiler, const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameProfiler* profiler_;
+        const char* name_;
+        Clock::time_point start_;
+    };
+
+    explicit FrameProfiler(std::size_t max_frames = 600);
+
+    void begin_frame();
+    void end_frame();
+
+    Scope scope(const char* name);
+
+    /// \brief Adds an event to the current frame. 'name' must outlive the profiler (use string literals).
+    void add_event(const char* name,
+                   Clock::time_point start,
+                   Clock::time_point end,
+                   Track track = Track::RenderThread,
+                   std::string detail = "");
+
+    /// \brief Nothing happens if the frame is no longer stored. The GPU doesn't report when the work
+    ///        started so the event is placed at the start of the frame.
+    void add_gpu_time(std::uint64_t frame_index, const char* name, double duration_us);
+
+    /// \brief The index of the frame that was last started
+    std::uint64_t frame_index() const;
+
+    /// \brief The stored frames, oldest first
+    const std::deque<Frame>& frames() const;
+
+    /// \brief The sum of all the events in 'frame' called 'name'
+    static double total_us(const Frame& frame, const char* name);
+
+    /// \brief All the stored frames in the Chrome trace event format (chrome://tracing or ui.perfetto.dev)
+    std::string chrome_trace() const;
+
+    /// \brief Returns false if the file could not be written
+    bool write_chrome_trace(const std::string& filename) const;
+
+    void clear();
+
+private:
+    std::size_t max_frames_;
+    Clock::time_point start_ = Clock::now();
+    std::uint64_t frame_index_ = 0;
+    std::deque<Frame> frames_;
+
+    double to_us(Clock::time_point time) const;
+};
+
+} // namespace gvs::util
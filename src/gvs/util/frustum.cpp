@@ -0,0 +1,86 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "frustum.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+namespace gvs::util {
+
+Frustum::Frustum(const float* m) {
+    // Gribb & Hartmann: each plane is the last row of the matrix plus or minus one of the other rows
+    auto row = [m](unsigned r, unsigned col) { return m[col * 4u + r]; };
+
+    for (auto axis = 0u; axis < 3u; ++axis) {
+        for (auto col = 0u; col < 4u; ++col) {
+            planes_[axis * 2u][col] = row(3u, col) + row(axis, col);
+            planes_[axis * 2u + 1u][col] = row(3u, col) - row(axis, col);
+        }
+    }
+}
+
+bool Frustum::intersects(const Aabb& box) const {
+    if (box.empty()) {
+        return false;
+    }
+
+    for (const auto& plane : planes_) {
+        // The corner of the box furthest along the plane normal
+        float distance = plane[3];
+        for (auto i = 0u; i < 3u; ++i) {
+            distance += plane[i] * (plane[i] >= 0.f ? box.max[i] : box.min[i]);
+        }
+
+        if (distance < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("[util] frustum culls boxes outside the view") {
+    // Orthographic projection of the box [-1, 1] x [-1, 1] x [-1, -11] looking down -z
+    // clang-format off
+    const float clip_from_world[] = {
+        1.f, 0.f,  0.f,  0.f,
+        0.f, 1.f,  0.f,  0.f,
+        0.f, 0.f, -0.2f, 0.f,
+        0.f, 0.f, -1.2f, 1.f,
+    };
+    // clang-format on
+    Frustum frustum(clip_from_world);
+
+    auto box = [](Vec3f min, Vec3f max) { return Aabb{min, max}; };
+
+    CHECK(frustum.intersects(box({-0.5f, -0.5f, -5.f}, {0.5f, 0.5f, -4.f})));
+    CHECK(frustum.intersects(box({0.5f, 0.5f, -2.f}, {5.f, 5.f, -1.5f}))); // partly inside
+    CHECK(frustum.intersects(box({-5.f, -5.f, -20.f}, {5.f, 5.f, 5.f}))); // contains the frustum
+
+    CHECK_FALSE(frustum.intersects(box({2.f, -0.5f, -5.f}, {3.f, 0.5f, -4.f}))); // right
+    CHECK_FALSE(frustum.intersects(box({-0.5f, -3.f, -5.f}, {0.5f, -2.f, -4.f}))); // below
+    CHECK_FALSE(frustum.intersects(box({-0.5f, -0.5f, 1.f}, {0.5f, 0.5f, 2.f}))); // behind
+    CHECK_FALSE(frustum.intersects(box({-0.5f, -0.5f, -30.f}, {0.5f, 0.5f, -20.f}))); // too far
+    CHECK_FALSE(frustum.intersects(Aabb{}));
+}
+
+} // namespace gvs::util
@@ -0,0 +1,50 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/aabb_tree.hpp"
+
+// standard
+#include <array>
+
+namespace gvs::util {
+
+/**
+ * @brief The six planes of a view frustum. Used to skip items that can't be seen.
+ */
+class Frustum {
+public:
+    /// \brief Extracts the planes from a column major 'projection * view' matrix (OpenGL clip space)
+    explicit Frustum(const float* clip_from_world);
+
+    /// \brief False if 'box' is completely outside the frustum. Empty boxes are never visible.
+    ///        Boxes near a corner can pass even if they are outside so this is only for culling.
+    bool intersects(const Aabb& box) const;
+
+private:
+    /// (a, b, c, d) for each plane where a*x + b*y + c*z + d >= 0 inside the frustum
+    std::array<std::array<float, 4>, 6> planes_;
+};
+
+} // namespace gvs::util
@@ -0,0 +1,73 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "lock_free_queue.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace gvs::util {
+
+TEST_CASE("[util] lock free queue keeps the order of each producer") {
+    LockFreeQueue<std::unique_ptr<int>> queue; // move only values
+
+    constexpr int num_producers = 4;
+    constexpr int values_per_producer = 10000;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < values_per_producer; ++i) {
+                queue.push(std::make_unique<int>(p * values_per_producer + i));
+            }
+        });
+    }
+
+    std::vector<int> last_value(num_producers, -1);
+    int num_popped = 0;
+
+    while (num_popped < num_producers * values_per_producer) {
+        std::optional<std::unique_ptr<int>> value = queue.pop();
+
+        if (not value) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        auto producer = static_cast<std::size_t>(**value / values_per_producer);
+        CHECK(**value > last_value[producer]);
+        last_value[producer] = **value;
+        ++num_popped;
+    }
+
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    CHECK_FALSE(queue.pop());
+}
+
+} // namespace gvs::util
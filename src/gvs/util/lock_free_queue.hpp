@@ -0,0 +1,101 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <atomic>
+#include <optional>
+
+namespace gvs::util {
+
+/**
+ * @brief An unbounded queue that any number of threads can push to without locking and a
+ *        single thread pops from.
+ *
+ * Values are moved in and out so nothing is copied. Pushing never waits on the consumer,
+ * which makes it a good fit for handing work from network threads to the render thread.
+ */
+template <typename T>
+class LockFreeQueue {
+public:
+    LockFreeQueue();
+    ~LockFreeQueue();
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    /// \brief Safe to call from any thread
+    void push(T value);
+
+    /// \brief Must only be called from one thread at a time. Returns nothing if the queue is empty.
+    std::optional<T> pop();
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+    };
+
+    // Kept on separate cache lines so producers and the consumer don't contend
+    alignas(64) std::atomic<Node*> tail_; ///< Most recently pushed node
+    alignas(64) Node* head_; ///< Already popped node whose 'next' is the front of the queue
+};
+
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue() : tail_(new Node), head_(tail_.load()) {}
+
+template <typename T>
+LockFreeQueue<T>::~LockFreeQueue() {
+    while (head_) {
+        Node* next = head_->next.load();
+        delete head_;
+        head_ = next;
+    }
+}
+
+template <typename T>
+void LockFreeQueue<T>::push(T value) {
+    auto* node = new Node;
+    node->value.emplace(std::move(value));
+
+    Node* previous = tail_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+template <typename T>
+std::optional<T> LockFreeQueue<T>::pop() {
+    Node* next = head_->next.load(std::memory_order_acquire);
+
+    if (not next) {
+        return std::nullopt;
+    }
+
+    std::optional<T> value = std::move(next->value);
+    next->value.reset();
+
+    delete head_;
+    head_ = next;
+    return value;
+}
+
+} // namespace gvs::util
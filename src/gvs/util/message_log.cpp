@@ -0,0 +1,173 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "message_log.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cctype>
+
+namespace gvs::util {
+
+namespace {
+
+std::string to_lower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return str;
+}
+
+} // namespace
+
+MessageLog::MessageLog(std::size_t capacity) : entries_(capacity) {}
+
+void MessageLog::add(proto::Message message) {
+    std::string search_text = to_lower(message.identifier() + '\n' + message.contents());
+    entries_.push({std::move(message), std::move(search_text)});
+
+    // Forget matches that were replaced
+    while (not matches_.empty() and matches_.front() < entries_.first_sequence()) {
+        matches_.pop_front();
+    }
+
+    if (not filter_.empty() and matches(entries_[entries_.size() - 1u])) {
+        matches_.push_back(entries_.end_sequence() - 1u);
+    }
+}
+
+void MessageLog::clear() {
+    num_cleared_ += entries_.size();
+    entries_.clear();
+    matches_.clear();
+}
+
+void MessageLog::set_filter(const std::string& filter) {
+    std::string lower_filter = to_lower(filter);
+
+    if (lower_filter == filter_) {
+        return;
+    }
+
+    bool narrower = (not filter_.empty() and lower_filter.find(filter_) != std::string::npos);
+    filter_ = std::move(lower_filter);
+
+    if (filter_.empty()) {
+        matches_.clear();
+
+    } else if (narrower) {
+        // Anything matching the new filter also matched the old one
+        matches_.erase(std::remove_if(matches_.begin(),
+                                      matches_.end(),
+                                      [&](std::uint64_t sequence) {
+                                          return not matches(entries_.at_sequence(sequence));
+                                      }),
+                       matches_.end());
+
+    } else {
+        matches_.clear();
+        for (std::uint64_t sequence = entries_.first_sequence(); sequence < entries_.end_sequence(); ++sequence) {
+            if (matches(entries_.at_sequence(sequence))) {
+                matches_.push_back(sequence);
+            }
+        }
+    }
+}
+
+std::size_t MessageLog::size() const {
+    return filter_.empty() ? entries_.size() : matches_.size();
+}
+
+const proto::Message& MessageLog::operator[](std::size_t index) const {
+    return filter_.empty() ? entries_[index].message : entries_.at_sequence(matches_[index]).message;
+}
+
+std::uint64_t MessageLog::num_dropped() const {
+    return entries_.first_sequence() - num_cleared_;
+}
+
+bool MessageLog::matches(const Entry& entry) const {
+    return entry.search_text.find(filter_) != std::string::npos;
+}
+
+TEST_CASE("[util] message log") {
+    auto make_message = [](const std::string& identifier, const std::string& contents) {
+        proto::Message message;
+        message.set_identifier(identifier);
+        message.set_contents(contents);
+        return message;
+    };
+
+    MessageLog log(4u);
+    log.add(make_message("Solver", "iteration 1"));
+    log.add(make_message("Solver", "iteration 2"));
+    log.add(make_message("Mesher", "done"));
+
+    REQUIRE(log.size() == 3u);
+    CHECK(log[2].identifier() == "Mesher");
+
+    SUBCASE("filters ignore case and search identifiers and contents") {
+        log.set_filter("SOLVER");
+        CHECK(log.size() == 2u);
+
+        log.set_filter("Solver iteration");
+        CHECK(log.size() == 0u);
+
+        log.set_filter("iteration 2");
+        REQUIRE(log.size() == 1u);
+        CHECK(log[0].contents() == "iteration 2");
+
+        log.set_filter("");
+        CHECK(log.size() == 3u);
+    }
+
+    SUBCASE("new and replaced messages update the matches") {
+        log.set_filter("iter");
+        log.add(make_message("Solver", "iteration 3"));
+        log.add(make_message("Solver", "iteration 4"));
+
+        // "iteration 1" was replaced
+        CHECK(log.num_dropped() == 1u);
+        REQUIRE(log.size() == 3u);
+        CHECK(log[0].contents() == "iteration 2");
+        CHECK(log[2].contents() == "iteration 4");
+
+        // Narrowing the filter only checks the previous matches
+        log.set_filter("iteration 4");
+        REQUIRE(log.size() == 1u);
+        CHECK(log[0].contents() == "iteration 4");
+
+        log.set_filter("");
+        CHECK(log.size() == 4u);
+    }
+
+    SUBCASE("cleared messages are not dropped") {
+        log.clear();
+        CHECK(log.size() == 0u);
+        CHECK(log.num_dropped() == 0u);
+    }
+}
+
+} // namespace gvs::util
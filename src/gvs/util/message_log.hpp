@@ -0,0 +1,81 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/ring_buffer.hpp"
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <deque>
+#include <string>
+
+namespace gvs::util {
+
+/**
+ * @brief The most recent messages and the ones that contain a filter string (ignoring case).
+ *
+ * The matching messages are kept in an index that is updated as messages are added or replaced.
+ * Messages are only rescanned when the filter changes, and a filter that extends the previous
+ * one only rescans the previous matches.
+ */
+class MessageLog {
+public:
+    explicit MessageLog(std::size_t capacity = 20'000);
+
+    void add(proto::Message message);
+
+    /// \brief Removes every message
+    void clear();
+
+    /// \brief Only messages with an identifier or contents containing 'filter' are listed.
+    ///        An empty filter lists every message.
+    void set_filter(const std::string& filter);
+
+    /// \brief The number of listed messages
+    std::size_t size() const;
+
+    /// \brief Index 0 is the oldest listed message
+    const proto::Message& operator[](std::size_t index) const;
+
+    /// \brief The number of messages that were replaced by newer ones because the log was full
+    std::uint64_t num_dropped() const;
+
+private:
+    struct Entry {
+        proto::Message message;
+        std::string search_text; ///< Lowercase identifier and contents
+    };
+
+    RingBuffer<Entry> entries_;
+    std::uint64_t num_cleared_ = 0; ///< Not counted as dropped
+
+    std::string filter_; ///< lowercase
+    std::deque<std::uint64_t> matches_; ///< Sequence numbers of the entries that match a non-empty filter
+
+    bool matches(const Entry& entry) const;
+};
+
+} // namespace gvs::util
@@ -0,0 +1,65 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "ordered_task_pool.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <atomic>
+#include <chrono>
+
+namespace gvs::util {
+
+TEST_CASE("[util] ordered task pool returns results in submission order") {
+    std::atomic_int num_ready{0};
+    OrderedTaskPool<int> pool(4u, [&] { ++num_ready; });
+
+    constexpr int num_tasks = 50;
+
+    for (int i = 0; i < num_tasks; ++i) {
+        pool.submit([i] {
+            // Earlier tasks take longer so they finish out of order
+            std::this_thread::sleep_for(std::chrono::microseconds((num_tasks - i) * 20));
+            return i;
+        });
+    }
+
+    std::vector<int> results;
+    while (results.size() < num_tasks) {
+        if (std::optional<int> result = pool.take_next()) {
+            results.emplace_back(*result);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (int i = 0; i < num_tasks; ++i) {
+        CHECK(results[static_cast<std::size_t>(i)] == i);
+    }
+    CHECK(num_ready == num_tasks);
+    CHECK(pool.num_pending() == 0u);
+    CHECK_FALSE(pool.take_next());
+}
+
+} // namespace gvs::util
@@ -0,0 +1,183 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief Runs tasks on a set of worker threads and hands back the results in the order the
+ *        tasks were submitted, no matter which task finishes first.
+ *
+ * Example:
+ *
+ *     util::OrderedTaskPool<Mesh> pool(4);
+ *
+ *     pool.submit([data] { return build_mesh(data); }); // Any thread
+ *
+ *     ... Later, on the thread that needs the results
+ *
+ *     while (std::optional<Mesh> mesh = pool.take_next()) {
+ *         upload(*mesh);
+ *     }
+ *
+ * Tasks must not throw. Tasks that haven't started when the pool is destroyed are discarded.
+ */
+template <typename Result>
+class OrderedTaskPool {
+public:
+    /// \brief 'on_result_ready' is called from a worker thread each time a task finishes
+    explicit OrderedTaskPool(unsigned num_threads = default_num_threads(),
+                             std::function<void()> on_result_ready = nullptr);
+    ~OrderedTaskPool();
+
+    OrderedTaskPool(const OrderedTaskPool&) = delete;
+    OrderedTaskPool& operator=(const OrderedTaskPool&) = delete;
+
+    void submit(std::function<Result()> task);
+
+    /// \brief Returns the result of the oldest task if it has finished. Returns nothing if the
+    ///        oldest task is still running, even when newer tasks are done.
+    std::optional<Result> take_next();
+
+    /// \brief The number of submitted tasks whose results haven't been taken yet
+    std::size_t num_pending() const;
+
+    static unsigned default_num_threads();
+
+private:
+    std::function<void()> on_result_ready_;
+
+    mutable std::mutex lock_;
+    std::condition_variable tasks_available_;
+    std::deque<std::pair<std::uint64_t, std::function<Result()>>> tasks_; ///< (task number, task)
+    std::deque<std::optional<Result>> results_; ///< 'results_[i]' belongs to task 'first_result_ + i'
+    std::uint64_t first_result_ = 0;
+    std::uint64_t next_task_ = 0;
+    bool stop_ = false;
+
+    std::vector<std::thread> workers_;
+
+    void run_tasks();
+};
+
+template <typename Result>
+OrderedTaskPool<Result>::OrderedTaskPool(unsigned num_threads, std::function<void()> on_result_ready)
+    : on_result_ready_(std::move(on_result_ready)) {
+    num_threads = std::max(num_threads, 1u);
+
+    for (auto i = 0u; i < num_threads; ++i) {
+        workers_.emplace_back(&OrderedTaskPool::run_tasks, this);
+    }
+}
+
+template <typename Result>
+OrderedTaskPool<Result>::~OrderedTaskPool() {
+    {
+        std::lock_guard<std::mutex> scoped_lock(lock_);
+        stop_ = true;
+    }
+    tasks_available_.notify_all();
+
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+template <typename Result>
+void OrderedTaskPool<Result>::submit(std::function<Result()> task) {
+    {
+        std::lock_guard<std::mutex> scoped_lock(lock_);
+        tasks_.emplace_back(next_task_++, std::move(task));
+        results_.emplace_back();
+    }
+    tasks_available_.notify_one();
+}
+
+template <typename Result>
+std::optional<Result> OrderedTaskPool<Result>::take_next() {
+    std::lock_guard<std::mutex> scoped_lock(lock_);
+
+    if (results_.empty() or not results_.front()) {
+        return std::nullopt;
+    }
+
+    std::optional<Result> result = std::move(results_.front());
+    results_.pop_front();
+    ++first_result_;
+    return result;
+}
+
+template <typename Result>
+std::size_t OrderedTaskPool<Result>::num_pending() const {
+    std::lock_guard<std::mutex> scoped_lock(lock_);
+    return results_.size();
+}
+
+template <typename Result>
+unsigned OrderedTaskPool<Result>::default_num_threads() {
+    // Leave a core for the thread that takes the results
+    return std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+}
+
+template <typename Result>
+void OrderedTaskPool<Result>::run_tasks() {
+    std::unique_lock<std::mutex> lock(lock_);
+
+    while (true) {
+        tasks_available_.wait(lock, [this] { return stop_ or not tasks_.empty(); });
+
+        if (stop_) {
+            return;
+        }
+
+        std::uint64_t task_number = tasks_.front().first;
+        std::function<Result()> task = std::move(tasks_.front().second);
+        tasks_.pop_front();
+
+        lock.unlock();
+        Result result = task();
+        lock.lock();
+
+        // Earlier results may have been taken but this one hasn't so the index is still valid
+        results_[task_number - first_result_] = std::move(result);
+
+        if (on_result_ready_) {
+            lock.unlock();
+            on_result_ready_();
+            lock.lock();
+        }
+    }
+}
+
+} // namespace gvs::util
@@ -0,0 +1,311 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "point_octree.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <random>
+
+namespace gvs::util {
+
+PointOctree::PointOctree(const float* positions,
+                         std::size_t num_points,
+                         std::size_t stride,
+                         std::uint32_t node_capacity,
+                         std::uint32_t max_depth)
+    : node_capacity_(std::max(node_capacity, 1u)),
+      max_depth_(max_depth),
+      grid_size_(static_cast<std::uint32_t>(std::cbrt(static_cast<double>(node_capacity_)))) {
+
+    std::vector<BuildPoint> points;
+    points.reserve(num_points);
+
+    Aabb bounds;
+
+    for (std::size_t i = 0; i < num_points; ++i) {
+        const float* p = positions + i * stride;
+
+        if (std::isfinite(p[0]) and std::isfinite(p[1]) and std::isfinite(p[2])) {
+            points.push_back({{p[0], p[1], p[2]}, static_cast<std::uint32_t>(i)});
+            bounds.expand(points.back().position);
+        }
+    }
+
+    if (points.empty()) {
+        return;
+    }
+
+    // Cubes keep the spacing the same along every axis
+    float extent = 0.f;
+    for (auto i = 0u; i < 3u; ++i) {
+        extent = std::max(extent, bounds.max[i] - bounds.min[i]);
+    }
+    extent = std::max(extent, 1e-6f);
+
+    Node root;
+    for (auto i = 0u; i < 3u; ++i) {
+        float center = (bounds.min[i] + bounds.max[i]) * 0.5f;
+        root.bounds.min[i] = center - extent * 0.5f;
+        root.bounds.max[i] = center + extent * 0.5f;
+    }
+    nodes_.emplace_back(root);
+
+    point_order_.reserve(points.size());
+    build(0u, points.data(), points.data() + points.size(), 0u);
+}
+
+const std::vector<PointOctree::Node>& PointOctree::nodes() const {
+    return nodes_;
+}
+
+const std::vector<std::uint32_t>& PointOctree::point_order() const {
+    return point_order_;
+}
+
+std::uint32_t PointOctree::node_capacity() const {
+    return node_capacity_;
+}
+
+void PointOctree::build(std::uint32_t index, BuildPoint* begin, BuildPoint* end, std::uint32_t depth) {
+    const Aabb bounds = nodes_[index].bounds;
+    const float extent = bounds.max[0] - bounds.min[0];
+    const auto count = static_cast<std::size_t>(end - begin);
+
+    nodes_[index].first = static_cast<std::uint32_t>(point_order_.size());
+    nodes_[index].spacing = extent / static_cast<float>(grid_size_);
+
+    if (count <= node_capacity_ or depth == max_depth_) {
+        std::uint32_t kept = static_cast<std::uint32_t>(std::min<std::size_t>(count, node_capacity_));
+        std::for_each(begin, begin + kept, [this](const BuildPoint& point) { point_order_.push_back(point.index); });
+        nodes_[index].count = kept;
+        return;
+    }
+
+    // Keep the first point that lands in each grid cell so the node covers its whole volume evenly
+    std::vector<bool> cell_taken(std::size_t(grid_size_) * grid_size_ * grid_size_, false);
+
+    auto cell = [&](const BuildPoint& point, unsigned axis) {
+        float t = (point.position[axis] - bounds.min[axis]) / extent * static_cast<float>(grid_size_);
+        return std::min(static_cast<std::size_t>(std::max(t, 0.f)), std::size_t(grid_size_ - 1u));
+    };
+
+    BuildPoint* kept_end = begin;
+
+    for (BuildPoint* point = begin; point != end; ++point) {
+        std::size_t cell_index = (cell(*point, 2u) * grid_size_ + cell(*point, 1u)) * grid_size_ + cell(*point, 0u);
+
+        if (not cell_taken[cell_index]) {
+            cell_taken[cell_index] = true;
+            std::swap(*point, *kept_end++);
+        }
+    }
+
+    std::for_each(begin, kept_end, [this](const BuildPoint& point) { point_order_.push_back(point.index); });
+    nodes_[index].count = static_cast<std::uint32_t>(kept_end - begin);
+
+    // Split the remaining points into octants (bit 0 is x, bit 1 is y, bit 2 is z)
+    std::array<BuildPoint*, 9> octants;
+    octants[0] = kept_end;
+    octants[8] = end;
+
+    auto split = [&](std::size_t first_octant, std::size_t num_octants, unsigned axis) {
+        float center = (bounds.min[axis] + bounds.max[axis]) * 0.5f;
+        std::size_t middle = first_octant + num_octants / 2u;
+
+        octants[middle] = std::partition(octants[first_octant],
+                                         octants[first_octant + num_octants],
+                                         [&](const BuildPoint& point) { return point.position[axis] < center; });
+    };
+
+    split(0u, 8u, 2u);
+    for (std::size_t first : {0u, 4u}) {
+        split(first, 4u, 1u);
+    }
+    for (std::size_t first : {0u, 2u, 4u, 6u}) {
+        split(first, 2u, 0u);
+    }
+
+    for (std::uint32_t octant = 0u; octant < 8u; ++octant) {
+        if (octants[octant] == octants[octant + 1u]) {
+            continue;
+        }
+
+        Node child;
+        for (auto axis = 0u; axis < 3u; ++axis) {
+            bool upper = (octant >> axis) & 1u;
+            float center = (bounds.min[axis] + bounds.max[axis]) * 0.5f;
+            child.bounds.min[axis] = upper ? center : bounds.min[axis];
+            child.bounds.max[axis] = upper ? bounds.max[axis] : center;
+        }
+
+        auto child_index = static_cast<std::uint32_t>(nodes_.size());
+        nodes_[index].children[octant] = child_index;
+        nodes_.emplace_back(child);
+
+        build(child_index, octants[octant], octants[octant + 1u], depth + 1u);
+    }
+}
+
+std::vector<std::uint32_t> select_point_nodes(const PointOctree& octree,
+                                              const Frustum& frustum,
+                                              const Vec3f& eye,
+                                              const PointLodSettings& settings) {
+    std::vector<std::uint32_t> selected;
+
+    if (octree.nodes().empty()) {
+        return selected;
+    }
+
+    // How far apart the node's points are on screen
+    auto pixel_spacing = [&](const PointOctree::Node& node) {
+        float distance_squared = 0.f;
+        for (auto i = 0u; i < 3u; ++i) {
+            float center = (node.bounds.min[i] + node.bounds.max[i]) * 0.5f;
+            float radius = (node.bounds.max[i] - node.bounds.min[i]) * 0.5f;
+            float outside = std::max(std::abs(eye[i] - center) - radius, 0.f);
+            distance_squared += outside * outside;
+        }
+        if (distance_squared == 0.f) {
+            return std::numeric_limits<float>::infinity(); // the eye is inside the node
+        }
+        return node.spacing * settings.projection_scale / std::sqrt(distance_squared);
+    };
+
+    using Candidate = std::pair<float, std::uint32_t>; ///< (pixel spacing, node)
+    std::priority_queue<Candidate> candidates;
+    candidates.emplace(std::numeric_limits<float>::infinity(), 0u); // always try the root
+
+    std::size_t num_points = 0u;
+
+    while (not candidates.empty()) {
+        std::uint32_t index = candidates.top().second;
+        candidates.pop();
+
+        const PointOctree::Node& node = octree.nodes()[index];
+
+        if (not frustum.intersects(node.bounds)) {
+            continue;
+        }
+
+        if (num_points + node.count > settings.point_budget) {
+            break;
+        }
+
+        selected.emplace_back(index);
+        num_points += node.count;
+
+        // Children are only needed if this node's points are still too far apart
+        if (pixel_spacing(node) <= settings.min_pixel_spacing) {
+            continue;
+        }
+
+        for (std::uint32_t child : node.children) {
+            if (child != 0u) {
+                candidates.emplace(pixel_spacing(octree.nodes()[child]), child);
+            }
+        }
+    }
+    return selected;
+}
+
+TEST_CASE("[util] point octree keeps each point once") {
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-0.9f, 0.9f);
+
+    std::vector<float> positions(20'000u * 3u);
+    std::generate(positions.begin(), positions.end(), [&] { return dist(gen); });
+    positions[30] = std::numeric_limits<float>::quiet_NaN(); // point 10 is dropped
+
+    PointOctree octree(positions.data(), positions.size() / 3u, 3u, 512u);
+
+    std::vector<std::uint32_t> sorted = octree.point_order();
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+    CHECK(sorted.size() == 20'000u - 1u);
+    CHECK_FALSE(std::binary_search(sorted.begin(), sorted.end(), 10u));
+
+    REQUIRE(octree.nodes().size() > 1u);
+
+    for (const PointOctree::Node& node : octree.nodes()) {
+        CHECK(node.count <= 512u);
+
+        Aabb padded = node.bounds.padded(1e-5f);
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const float* p = positions.data() + octree.point_order()[i] * 3u;
+            CHECK(padded.contains(Aabb{}.expand({p[0], p[1], p[2]})));
+        }
+    }
+
+    SUBCASE("selection") {
+        // Identity projection: everything in [-1, 1]^3 is visible
+        // clang-format off
+        const float clip_from_local[] = {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f,
+        };
+        // clang-format on
+        Frustum frustum(clip_from_local);
+
+        PointLodSettings settings;
+        settings.projection_scale = 500.f;
+        settings.point_budget = octree.point_order().size();
+
+        // Far away only the root is needed
+        std::vector<std::uint32_t> far = select_point_nodes(octree, frustum, {0.f, 0.f, 1e6f}, settings);
+        CHECK(far == std::vector<std::uint32_t>{0u});
+
+        // Close up everything is needed
+        std::vector<std::uint32_t> close = select_point_nodes(octree, frustum, {0.f, 0.f, 0.f}, settings);
+        CHECK(close.size() == octree.nodes().size());
+
+        // Parents come before their children
+        std::vector<std::size_t> position(octree.nodes().size());
+        for (std::size_t i = 0; i < close.size(); ++i) {
+            position[close[i]] = i;
+        }
+        for (std::uint32_t parent : close) {
+            for (std::uint32_t child : octree.nodes()[parent].children) {
+                CHECK((child == 0u or position[parent] < position[child]));
+            }
+        }
+
+        // The budget is never exceeded
+        settings.point_budget = 2'000u;
+        std::size_t num_points = 0u;
+        for (std::uint32_t node : select_point_nodes(octree, frustum, {0.f, 0.f, 0.f}, settings)) {
+            num_points += octree.nodes()[node].count;
+        }
+        CHECK(num_points <= 2'000u);
+        CHECK(num_points > 0u);
+    }
+}
+
+} // namespace gvs::util
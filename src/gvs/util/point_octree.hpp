@@ -0,0 +1,107 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/aabb_tree.hpp"
+#include "gvs/util/frustum.hpp"
+
+// standard
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief An octree over a point cloud where every node keeps an evenly spread subset of the points
+ *        below it. Drawing a node and all of its ancestors gives a coarse version of that part of
+ *        the cloud and each level down adds detail without repeating any points.
+ */
+class PointOctree {
+public:
+    struct Node {
+        Aabb bounds; ///< always a cube
+        std::uint32_t first = 0; ///< index of the node's first point in 'point_order'
+        std::uint32_t count = 0; ///< at most 'node_capacity'
+        float spacing = 0.f; ///< rough distance between neighbouring points of this node
+        std::array<std::uint32_t, 8> children = {}; ///< zero if the child is empty (the root is never a child)
+    };
+
+    /**
+     * @param positions - xyz for each point
+     * @param num_points - number of points (not floats)
+     * @param stride - number of floats from one point's position to the next
+     * @param node_capacity - the most points stored in a single node
+     * @param max_depth - nodes at this depth keep 'node_capacity' points and drop the rest
+     */
+    explicit PointOctree(const float* positions,
+                         std::size_t num_points,
+                         std::size_t stride = 3u,
+                         std::uint32_t node_capacity = 4096u,
+                         std::uint32_t max_depth = 20u);
+
+    const std::vector<Node>& nodes() const;
+
+    /// \brief Original point indices grouped by node. Points that weren't kept (non-finite
+    ///        positions or too many points at 'max_depth') are left out.
+    const std::vector<std::uint32_t>& point_order() const;
+
+    std::uint32_t node_capacity() const;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> point_order_;
+    std::uint32_t node_capacity_;
+    std::uint32_t max_depth_;
+    std::uint32_t grid_size_; ///< nodes pick at most one point from each cell of a grid_size^3 grid
+
+    /// Positions are copied next to their index while building so partitioning doesn't jump around memory
+    struct BuildPoint {
+        Vec3f position;
+        std::uint32_t index;
+    };
+
+    /// \brief Fills in node 'index' using the points in [begin, end) and recursively adds its
+    ///        children. The range is reordered. Points kept by the node are appended to 'point_order_'.
+    void build(std::uint32_t index, BuildPoint* begin, BuildPoint* end, std::uint32_t depth);
+};
+
+struct PointLodSettings {
+    float projection_scale = 1.f; ///< pixels per unit at a distance of one (viewport height / 2 tan(fov / 2))
+    float min_pixel_spacing = 1.f; ///< nodes aren't refined once their points are this close on screen
+    std::size_t point_budget = 1'000'000u;
+};
+
+/**
+ * @brief The octree nodes to draw, most important (largest spacing on screen) first. Parents always
+ *        come before their children and nodes outside 'frustum' are skipped. Everything is in the
+ *        octree's coordinates (so 'frustum' is clip_from_local).
+ */
+std::vector<std::uint32_t> select_point_nodes(const PointOctree& octree,
+                                              const Frustum& frustum,
+                                              const Vec3f& eye,
+                                              const PointLodSettings& settings);
+
+} // namespace gvs::util
@@ -0,0 +1,157 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "prefix_index.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <tuple>
+
+namespace gvs::util {
+
+namespace {
+
+std::string to_lower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return str;
+}
+
+bool entry_less(const PrefixIndex::Entry& lhs, const PrefixIndex::Entry& rhs) {
+    return std::tie(lhs.key, lhs.value) < std::tie(rhs.key, rhs.value);
+}
+
+} // namespace
+
+void PrefixIndex::insert(const std::string& key, std::uint32_t value) {
+    pending_inserts_.push_back({to_lower(key), value});
+}
+
+void PrefixIndex::erase(const std::string& key, std::uint32_t value) {
+    pending_erases_.push_back({to_lower(key), value});
+}
+
+PrefixIndex::Range PrefixIndex::find(const std::string& prefix) {
+    merge_pending();
+
+    std::string lower_prefix = to_lower(prefix);
+
+    auto first = std::lower_bound(entries_.begin(),
+                                  entries_.end(),
+                                  lower_prefix,
+                                  [](const Entry& entry, const std::string& str) { return entry.key < str; });
+
+    // Every key starting with the prefix comes right after the first one
+    auto last = std::partition_point(first, entries_.end(), [&](const Entry& entry) {
+        return entry.key.compare(0, lower_prefix.size(), lower_prefix) == 0;
+    });
+
+    return {entries_.data() + (first - entries_.begin()), entries_.data() + (last - entries_.begin())};
+}
+
+void PrefixIndex::clear() {
+    entries_.clear();
+    pending_inserts_.clear();
+    pending_erases_.clear();
+}
+
+void PrefixIndex::merge_pending() {
+    if (not pending_inserts_.empty()) {
+        std::sort(pending_inserts_.begin(), pending_inserts_.end(), entry_less);
+
+        auto num_sorted = static_cast<std::ptrdiff_t>(entries_.size());
+        entries_.insert(entries_.end(),
+                        std::make_move_iterator(pending_inserts_.begin()),
+                        std::make_move_iterator(pending_inserts_.end()));
+        std::inplace_merge(entries_.begin(), entries_.begin() + num_sorted, entries_.end(), entry_less);
+
+        pending_inserts_.clear();
+    }
+
+    if (not pending_erases_.empty()) {
+        std::sort(pending_erases_.begin(), pending_erases_.end(), entry_less);
+
+        // Both lists are sorted so each erase removes one matching entry in a single pass
+        auto erase = pending_erases_.begin();
+        auto out = entries_.begin();
+
+        for (auto in = entries_.begin(); in != entries_.end(); ++in) {
+            while (erase != pending_erases_.end() and entry_less(*erase, *in)) {
+                ++erase; // not in the index
+            }
+            if (erase != pending_erases_.end() and not entry_less(*in, *erase)) {
+                ++erase;
+                continue;
+            }
+            if (out != in) {
+                *out = std::move(*in);
+            }
+            ++out;
+        }
+        entries_.erase(out, entries_.end());
+
+        pending_erases_.clear();
+    }
+}
+
+TEST_CASE("[util] prefix index") {
+    PrefixIndex index;
+    CHECK(index.find("").empty());
+
+    index.insert("Wheel", 1u);
+    index.insert("wheel_left", 2u);
+    index.insert("body", 3u);
+    index.insert("Wheel_Right", 4u);
+
+    // Matches ignore case and are sorted
+    PrefixIndex::Range range = index.find("WHEEL_");
+    REQUIRE(range.size() == 2u);
+    CHECK(range[0].key == "wheel_left");
+    CHECK(range[0].value == 2u);
+    CHECK(range[1].key == "wheel_right");
+
+    CHECK(index.find("wheel").size() == 3u);
+    CHECK(index.find("").size() == 4u);
+    CHECK(index.find("body").size() == 1u);
+    CHECK(index.find("c").empty());
+    CHECK(index.find("wheel_right_").empty());
+
+    // Erases only remove the entry with the same value
+    index.erase("wheel", 2u);
+    index.erase("wheel_left", 2u);
+    index.insert("wheel_left", 5u);
+    range = index.find("wheel_l");
+    REQUIRE(range.size() == 1u);
+    CHECK(range[0].value == 5u);
+    CHECK(index.find("wheel").size() == 3u);
+
+    index.clear();
+    CHECK(index.find("").empty());
+}
+
+} // namespace gvs::util
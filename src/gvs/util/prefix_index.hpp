@@ -0,0 +1,74 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief Finds every key that starts with a prefix (ignoring case) using two binary searches.
+ *
+ * Keys are kept in a sorted array so the matches are a contiguous range that can be indexed
+ * directly, which lets a GUI draw only the visible part of a long list of results. Inserts and
+ * erases are buffered and merged into the array on the next search so adding many keys at once
+ * costs a single sort and merge.
+ */
+class PrefixIndex {
+public:
+    struct Entry {
+        std::string key; ///< lowercase
+        std::uint32_t value;
+    };
+
+    struct Range {
+        const Entry* first = nullptr;
+        const Entry* last = nullptr;
+
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+        bool empty() const { return first == last; }
+        const Entry& operator[](std::size_t i) const { return first[i]; }
+    };
+
+    void insert(const std::string& key, std::uint32_t value);
+
+    /// \brief Removes the key if it was inserted with the same value
+    void erase(const std::string& key, std::uint32_t value);
+
+    /// \brief All the keys starting with 'prefix', sorted. The range is valid until the index changes.
+    Range find(const std::string& prefix);
+
+    void clear();
+
+private:
+    std::vector<Entry> entries_; ///< sorted by key, then value
+    std::vector<Entry> pending_inserts_;
+    std::vector<Entry> pending_erases_;
+
+    void merge_pending();
+};
+
+} // namespace gvs::util
@@ -0,0 +1,65 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "ring_buffer.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <string>
+
+namespace gvs::util {
+
+TEST_CASE("[util] ring buffer replaces the oldest values") {
+    RingBuffer<std::string> buffer(3u);
+    CHECK(buffer.empty());
+
+    buffer.push("a");
+    buffer.push("b");
+    REQUIRE(buffer.size() == 2u);
+    CHECK(buffer[0] == "a");
+    CHECK(buffer[1] == "b");
+
+    buffer.push("c");
+    buffer.push("d");
+    buffer.push("e");
+    REQUIRE(buffer.size() == 3u);
+    CHECK(buffer[0] == "c");
+    CHECK(buffer[1] == "d");
+    CHECK(buffer[2] == "e");
+
+    // Sequence numbers don't change when older values are replaced
+    CHECK(buffer.first_sequence() == 2u);
+    CHECK(buffer.end_sequence() == 5u);
+    CHECK(buffer.at_sequence(3u) == "d");
+
+    buffer.clear();
+    CHECK(buffer.empty());
+    CHECK(buffer.first_sequence() == 5u);
+
+    buffer.push("f");
+    CHECK(buffer[0] == "f");
+    CHECK(buffer.at_sequence(5u) == "f");
+}
+
+} // namespace gvs::util
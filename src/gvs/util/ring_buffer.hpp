@@ -0,0 +1,125 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// standard
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief Keeps the most recent 'capacity' values. Once full, each push replaces the oldest value.
+ *
+ * Every pushed value gets the next sequence number so values can be referred to without
+ * their position changing as older values are replaced.
+ */
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity);
+
+    void push(T value);
+
+    /// \brief Index 0 is the oldest value
+    const T& operator[](std::size_t index) const;
+
+    /// \brief Values with sequence numbers in [first_sequence, end_sequence) are stored
+    const T& at_sequence(std::uint64_t sequence) const;
+    std::uint64_t first_sequence() const;
+    std::uint64_t end_sequence() const;
+
+    std::size_t size() const;
+    std::size_t capacity() const;
+    bool empty() const;
+
+    /// \brief Removes every value. Sequence numbers keep counting up.
+    void clear();
+
+private:
+    std::size_t capacity_;
+    std::vector<T> values_;
+    std::size_t oldest_ = 0; ///< Index of the oldest value in 'values_'
+    std::uint64_t end_sequence_ = 0;
+};
+
+template <typename T>
+RingBuffer<T>::RingBuffer(std::size_t capacity) : capacity_(std::max(capacity, std::size_t(1))) {}
+
+template <typename T>
+void RingBuffer<T>::push(T value) {
+    if (values_.size() < capacity_) {
+        values_.push_back(std::move(value));
+    } else {
+        values_[oldest_] = std::move(value);
+        oldest_ = (oldest_ + 1u) % capacity_;
+    }
+    ++end_sequence_;
+}
+
+template <typename T>
+const T& RingBuffer<T>::operator[](std::size_t index) const {
+    assert(index < values_.size());
+    return values_[(oldest_ + index) % values_.size()];
+}
+
+template <typename T>
+const T& RingBuffer<T>::at_sequence(std::uint64_t sequence) const {
+    assert(sequence >= first_sequence() and sequence < end_sequence_);
+    return (*this)[static_cast<std::size_t>(sequence - first_sequence())];
+}
+
+template <typename T>
+std::uint64_t RingBuffer<T>::first_sequence() const {
+    return end_sequence_ - values_.size();
+}
+
+template <typename T>
+std::uint64_t RingBuffer<T>::end_sequence() const {
+    return end_sequence_;
+}
+
+template <typename T>
+std::size_t RingBuffer<T>::size() const {
+    return values_.size();
+}
+
+template <typename T>
+std::size_t RingBuffer<T>::capacity() const {
+    return capacity_;
+}
+
+template <typename T>
+bool RingBuffer<T>::empty() const {
+    return values_.empty();
+}
+
+template <typename T>
+void RingBuffer<T>::clear() {
+    values_.clear();
+    oldest_ = 0;
+}
+
+} // namespace gvs::util
@@ -0,0 +1,230 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "scene_update.hpp"
+
+// gvs
+#include "gvs/util/container_util.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <unordered_map>
+
+namespace gvs::util {
+
+namespace {
+
+void apply_transforms(proto::SceneItems* items, const proto::TransformBatch& batch) {
+    if (not transform_batch_error(batch).empty()) {
+        return;
+    }
+
+    // Items are stored by string id so find all the handles in one pass
+    std::unordered_map<std::uint32_t, proto::SceneItemInfo*> items_by_handle;
+    for (auto& id_and_item : *items->mutable_items()) {
+        items_by_handle.emplace(id_and_item.second.id().handle(), &id_and_item.second);
+    }
+
+    const float* transformation = batch.transformations().data();
+
+    for (std::uint32_t handle : batch.handles()) {
+        auto iter = items_by_handle.find(handle);
+
+        if (iter != items_by_handle.end()) {
+            set_transformation(iter->second, transformation);
+        }
+        transformation += transform_size;
+    }
+}
+
+} // namespace
+
+void update_display_info(proto::SceneItemInfo* old_info, const proto::SceneItemInfo& new_info) {
+    if (new_info.has_display_info()) {
+        proto::DisplayInfo* old_display_info = old_info->mutable_display_info();
+        const proto::DisplayInfo& new_display_info = new_info.display_info();
+
+        if (new_display_info.has_readable_id()) {
+            old_display_info->mutable_readable_id()->CopyFrom(new_display_info.readable_id());
+        }
+
+        if (new_display_info.has_geometry_format()) {
+            old_display_info->mutable_geometry_format()->CopyFrom(new_display_info.geometry_format());
+        }
+
+        if (new_display_info.has_transformation()) {
+            old_display_info->mutable_transformation()->CopyFrom(new_display_info.transformation());
+        }
+
+        if (new_display_info.has_uniform_color()) {
+            old_display_info->mutable_uniform_color()->CopyFrom(new_display_info.uniform_color());
+        }
+
+        if (new_display_info.has_coloring()) {
+            old_display_info->mutable_coloring()->CopyFrom(new_display_info.coloring());
+        }
+
+        if (new_display_info.has_shading()) {
+            old_display_info->mutable_shading()->CopyFrom(new_display_info.shading());
+        }
+    }
+}
+
+void update_item_info(proto::SceneItemInfo* item, const proto::SceneItemInfo& info) {
+    if (info.has_geometry_info()) {
+        item->mutable_geometry_info()->CopyFrom(info.geometry_info());
+    }
+
+    if (info.has_parent()) {
+        item->mutable_parent()->CopyFrom(info.parent());
+    }
+
+    update_display_info(item, info);
+}
+
+void set_transformation(proto::SceneItemInfo* item, const float* transformation) {
+    auto* data = item->mutable_display_info()->mutable_transformation()->mutable_data();
+    data->Resize(transform_size, 0.f); // no-op for items that already have a full transformation
+    std::copy(transformation, transformation + transform_size, data->mutable_data());
+}
+
+std::string transform_batch_error(const proto::TransformBatch& batch) {
+    if (batch.transformations_size() != batch.handles_size() * transform_size) {
+        return "Expected " + std::to_string(transform_size) + " floats for each of the "
+            + std::to_string(batch.handles_size()) + " handles but got " + std::to_string(batch.transformations_size());
+    }
+    return "";
+}
+
+void apply_update(proto::SceneItems* items, const proto::SceneUpdate& update) {
+    switch (update.update_case()) {
+
+    case proto::SceneUpdate::kAddItem:
+        (*items->mutable_items())[update.add_item().id().value()].CopyFrom(update.add_item());
+        break;
+
+    case proto::SceneUpdate::kUpdateItem: {
+        const proto::SceneItemInfo& info = update.update_item();
+
+        if (not has_key(items->items(), info.id().value())) {
+            break;
+        }
+        update_item_info(&items->mutable_items()->at(info.id().value()), info);
+    } break;
+
+    case proto::SceneUpdate::kRemoveItem:
+        items->mutable_items()->erase(update.remove_item().id().value());
+        break;
+
+    case proto::SceneUpdate::kResetAllItems:
+        items->CopyFrom(update.reset_all_items());
+        break;
+
+    case proto::SceneUpdate::kBatch:
+        for (const proto::SceneUpdate& batched_update : update.batch().updates()) {
+            apply_update(items, batched_update);
+        }
+        break;
+
+    case proto::SceneUpdate::kTransforms:
+        apply_transforms(items, update.transforms());
+        break;
+
+    case proto::SceneUpdate::UPDATE_NOT_SET:
+        break;
+    }
+}
+
+TEST_CASE("[util] apply scene updates") {
+    proto::SceneItems items;
+
+    proto::SceneUpdate update;
+    update.mutable_add_item()->mutable_id()->set_value("item");
+    update.mutable_add_item()->mutable_geometry_info()->mutable_positions()->add_value(1.f);
+    update.mutable_add_item()->mutable_display_info()->mutable_readable_id()->set_value("Item");
+    apply_update(&items, update);
+
+    REQUIRE(has_key(items.items(), "item"));
+    CHECK(items.items().at("item").geometry_info().positions().value_size() == 1);
+
+    // Display info is merged, geometry is replaced
+    update.Clear();
+    update.mutable_update_item()->mutable_id()->set_value("item");
+    update.mutable_update_item()->mutable_geometry_info()->mutable_normals()->add_value(2.f);
+    update.mutable_update_item()->mutable_display_info()->mutable_uniform_color()->set_x(0.5f);
+    apply_update(&items, update);
+
+    const proto::SceneItemInfo& item = items.items().at("item");
+    CHECK_FALSE(item.geometry_info().has_positions());
+    CHECK(item.geometry_info().normals().value_size() == 1);
+    CHECK(item.display_info().readable_id().value() == "Item");
+    CHECK(item.display_info().uniform_color().x() == 0.5f);
+
+    // Updates to items that don't exist are ignored
+    update.mutable_update_item()->mutable_id()->set_value("missing");
+    apply_update(&items, update);
+    CHECK(items.items_size() == 1);
+
+    // Batched updates are applied in order
+    update.Clear();
+    update.mutable_batch()->add_updates()->mutable_add_item()->mutable_id()->set_value("batched");
+    update.mutable_batch()->add_updates()->mutable_remove_item()->mutable_id()->set_value("item");
+    apply_update(&items, update);
+    CHECK(items.items_size() == 1);
+    CHECK(has_key(items.items(), "batched"));
+
+    // Transformations are found by handle
+    update.Clear();
+    update.mutable_add_item()->mutable_id()->set_value("animated");
+    update.mutable_add_item()->mutable_id()->set_handle(7u);
+    apply_update(&items, update);
+
+    update.Clear();
+    update.mutable_transforms()->add_handles(7u);
+    update.mutable_transforms()->add_handles(8u); // unknown handles are ignored
+    for (int i = 0; i < 2 * transform_size; ++i) {
+        update.mutable_transforms()->add_transformations(float(i));
+    }
+    apply_update(&items, update);
+
+    const proto::Mat4& transformation = items.items().at("animated").display_info().transformation();
+    REQUIRE(transformation.data_size() == transform_size);
+    CHECK(transformation.data(0) == 0.f);
+    CHECK(transformation.data(15) == 15.f);
+
+    // Batches with the wrong number of floats are ignored entirely
+    update.mutable_transforms()->mutable_transformations()->RemoveLast();
+    CHECK_FALSE(transform_batch_error(update.transforms()).empty());
+    update.mutable_transforms()->set_transformations(0, -1.f);
+    apply_update(&items, update);
+    CHECK(transformation.data(0) == 0.f);
+
+    update.Clear();
+    update.mutable_reset_all_items();
+    apply_update(&items, update);
+    CHECK(items.items().empty());
+}
+
+} // namespace gvs::util
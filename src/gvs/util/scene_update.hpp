@@ -0,0 +1,74 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <cstdint>
+#include <string>
+
+namespace gvs::util {
+
+/// \brief The number of floats stored for each handle in a 'TransformBatch'
+constexpr int transform_size = 16;
+
+/// \brief The low bits of an item handle are a slot that is small enough to index flat per-item arrays.
+///        Slots are reused after the scene is cleared but the high bits (the generation) are not.
+constexpr unsigned handle_slot_bits = 24u;
+constexpr std::uint32_t max_handle_slot = (1u << handle_slot_bits) - 1u;
+
+constexpr std::uint32_t handle_slot(std::uint32_t handle) {
+    return handle & max_handle_slot;
+}
+
+/**
+ * @brief Overwrites the display fields of 'old_info' with any display fields that are set in 'new_info'.
+ */
+void update_display_info(proto::SceneItemInfo* old_info, const proto::SceneItemInfo& new_info);
+
+/**
+ * @brief Replaces the geometry and parent of 'item' if they are set in 'info' and merges the display info.
+ */
+void update_item_info(proto::SceneItemInfo* item, const proto::SceneItemInfo& info);
+
+/**
+ * @brief Overwrites the item's transformation with 'transformation' (16 column major floats).
+ */
+void set_transformation(proto::SceneItemInfo* item, const float* transformation);
+
+/**
+ * @brief Returns a description of the problem if 'batch' doesn't hold one transformation per handle,
+ *        otherwise returns an empty string.
+ */
+std::string transform_batch_error(const proto::TransformBatch& batch);
+
+/**
+ * @brief Applies an update broadcast by the server to a collection of scene items.
+ *
+ * The resulting items match the state the server had after it sent the update.
+ */
+void apply_update(proto::SceneItems* items, const proto::SceneUpdate& update);
+
+} // namespace gvs::util
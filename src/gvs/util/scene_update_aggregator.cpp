@@ -0,0 +1,347 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "scene_update_aggregator.hpp"
+
+// project
+#include "gvs/util/scene_update.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+
+namespace gvs::util {
+
+void SceneUpdateAggregator::add(proto::SceneUpdate update) {
+    // Pending transforms are overwritten first since 'update' is moved into the pending updates
+    switch (update.update_case()) {
+
+    case proto::SceneUpdate::kAddItem:
+        overwrite_pending_transform(update.add_item());
+        add_item_update(std::string(update.add_item().id().value()), std::move(update));
+        break;
+
+    case proto::SceneUpdate::kUpdateItem:
+        overwrite_pending_transform(update.update_item());
+        add_item_update(std::string(update.update_item().id().value()), std::move(update));
+        break;
+
+    case proto::SceneUpdate::kRemoveItem:
+        add_item_update(std::string(update.remove_item().id().value()), std::move(update));
+        break;
+
+    case proto::SceneUpdate::kResetAllItems:
+        // Nothing that happened before the reset matters anymore
+        pending_.clear();
+        pending_index_.clear();
+        transform_slots_.clear();
+        open_transforms_ = no_transforms;
+        pending_.emplace_back(std::move(update));
+        num_pending_ = 1;
+        break;
+
+    case proto::SceneUpdate::kBatch:
+        for (proto::SceneUpdate& batched_update : *update.mutable_batch()->mutable_updates()) {
+            add(std::move(batched_update));
+        }
+        break;
+
+    case proto::SceneUpdate::kTransforms:
+        add_transforms(update.transforms());
+        break;
+
+    case proto::SceneUpdate::UPDATE_NOT_SET:
+        break;
+    }
+}
+
+bool SceneUpdateAggregator::empty() const {
+    return num_pending_ == 0;
+}
+
+proto::SceneUpdate SceneUpdateAggregator::take_combined() {
+    proto::SceneUpdate combined;
+
+    if (num_pending_ == 1) {
+        for (proto::SceneUpdate& update : pending_) {
+            if (update.update_case() != proto::SceneUpdate::UPDATE_NOT_SET) {
+                combined.Swap(&update);
+            }
+        }
+
+    } else if (num_pending_ > 1) {
+        proto::SceneUpdateBatch* batch = combined.mutable_batch();
+        batch->mutable_updates()->Reserve(static_cast<int>(num_pending_));
+
+        for (proto::SceneUpdate& update : pending_) {
+            if (update.update_case() != proto::SceneUpdate::UPDATE_NOT_SET) {
+                batch->add_updates()->Swap(&update);
+            }
+        }
+    }
+
+    pending_.clear();
+    pending_index_.clear();
+    transform_slots_.clear();
+    open_transforms_ = no_transforms;
+    num_pending_ = 0;
+
+    return combined;
+}
+
+void SceneUpdateAggregator::add_item_update(const std::string& id, proto::SceneUpdate&& update) {
+    auto iter = pending_index_.find(id);
+
+    if (iter == pending_index_.end()) {
+        pending_index_.emplace(id, pending_.size());
+        pending_.emplace_back(std::move(update));
+        open_transforms_ = no_transforms;
+        ++num_pending_;
+        return;
+    }
+
+    proto::SceneUpdate& pending = pending_[iter->second];
+
+    switch (update.update_case()) {
+    case proto::SceneUpdate::kAddItem:
+        pending = std::move(update);
+        break;
+
+    case proto::SceneUpdate::kUpdateItem:
+        if (pending.has_add_item()) {
+            util::update_item_info(pending.mutable_add_item(), update.update_item());
+
+        } else if (pending.has_update_item()) {
+            util::update_item_info(pending.mutable_update_item(), update.update_item());
+
+        } else {
+            // Updating a removed item. Keep both so clients see the same sequence of events.
+            iter->second = pending_.size();
+            pending_.emplace_back(std::move(update));
+            open_transforms_ = no_transforms;
+            ++num_pending_;
+        }
+        break;
+
+    case proto::SceneUpdate::kRemoveItem:
+        if (pending.has_add_item()) {
+            // Clients never saw the item
+            pending.Clear();
+            pending_index_.erase(iter);
+            --num_pending_;
+
+        } else {
+            pending = std::move(update);
+        }
+        break;
+
+    case proto::SceneUpdate::kResetAllItems:
+    case proto::SceneUpdate::kBatch:
+    case proto::SceneUpdate::kTransforms:
+    case proto::SceneUpdate::UPDATE_NOT_SET:
+        break;
+    }
+}
+
+void SceneUpdateAggregator::add_transforms(const proto::TransformBatch& batch) {
+    if (not util::transform_batch_error(batch).empty()) {
+        return;
+    }
+
+    if (open_transforms_ == no_transforms) {
+        open_transforms_ = pending_.size();
+        pending_.emplace_back().mutable_transforms();
+        ++num_pending_;
+    }
+
+    proto::TransformBatch* open_batch = pending_[open_transforms_].mutable_transforms();
+    const float* transformation = batch.transformations().data();
+
+    for (std::uint32_t handle : batch.handles()) {
+        auto iter = transform_slots_.find(handle);
+        int offset;
+
+        if (iter != transform_slots_.end() and iter->second.update_index == open_transforms_) {
+            offset = iter->second.offset;
+
+        } else {
+            offset = open_batch->transformations_size();
+            transform_slots_[handle] = {open_transforms_, offset};
+            open_batch->add_handles(handle);
+            open_batch->mutable_transformations()->Resize(offset + util::transform_size, 0.f);
+        }
+
+        std::copy(transformation,
+                  transformation + util::transform_size,
+                  open_batch->mutable_transformations()->mutable_data() + offset);
+        transformation += util::transform_size;
+    }
+}
+
+void SceneUpdateAggregator::overwrite_pending_transform(const proto::SceneItemInfo& item) {
+    const auto& transformation = item.display_info().transformation().data();
+    auto iter = transform_slots_.find(item.id().handle());
+
+    if (iter == transform_slots_.end() or transformation.size() != util::transform_size) {
+        return;
+    }
+
+    proto::TransformBatch* batch = pending_[iter->second.update_index].mutable_transforms();
+    std::copy(transformation.begin(),
+              transformation.end(),
+              batch->mutable_transformations()->mutable_data() + iter->second.offset);
+}
+
+} // namespace gvs::util
+
+// //////////////////////////////////////////////////////////////////////////////////// //
+// ///////////////////////////////////  TESTING  ////////////////////////////////////// //
+// //////////////////////////////////////////////////////////////////////////////////// //
+TEST_CASE("[util] aggregator merges updates to the same item") {
+    gvs::util::SceneUpdateAggregator aggregator;
+    CHECK(aggregator.empty());
+
+    gvs::proto::SceneUpdate update;
+    update.mutable_add_item()->mutable_id()->set_value("a");
+    update.mutable_add_item()->mutable_geometry_info()->mutable_positions()->add_value(1.f);
+    aggregator.add(update);
+
+    update.Clear();
+    update.mutable_add_item()->mutable_id()->set_value("b");
+    aggregator.add(update);
+
+    for (float x : {0.1f, 0.2f, 0.3f}) {
+        update.Clear();
+        update.mutable_update_item()->mutable_id()->set_value("a");
+        update.mutable_update_item()->mutable_display_info()->mutable_uniform_color()->set_x(x);
+        aggregator.add(update);
+    }
+
+    CHECK_FALSE(aggregator.empty());
+    gvs::proto::SceneUpdate combined = aggregator.take_combined();
+    CHECK(aggregator.empty());
+
+    REQUIRE(combined.update_case() == gvs::proto::SceneUpdate::kBatch);
+    REQUIRE(combined.batch().updates_size() == 2);
+
+    const gvs::proto::SceneUpdate& first = combined.batch().updates(0);
+    REQUIRE(first.update_case() == gvs::proto::SceneUpdate::kAddItem);
+    CHECK(first.add_item().id().value() == "a");
+    CHECK(first.add_item().geometry_info().positions().value_size() == 1);
+    CHECK(first.add_item().display_info().uniform_color().x() == 0.3f);
+
+    CHECK(combined.batch().updates(1).add_item().id().value() == "b");
+}
+
+TEST_CASE("[util] aggregator handles removes and resets") {
+    gvs::util::SceneUpdateAggregator aggregator;
+
+    gvs::proto::SceneUpdate update;
+
+    // An item added and removed in the same tick is never sent
+    update.mutable_add_item()->mutable_id()->set_value("temporary");
+    aggregator.add(update);
+    update.Clear();
+    update.mutable_remove_item()->mutable_id()->set_value("temporary");
+    aggregator.add(update);
+    CHECK(aggregator.empty());
+
+    // A single pending update is not wrapped in a batch
+    update.Clear();
+    update.mutable_update_item()->mutable_id()->set_value("existing");
+    aggregator.add(update);
+    update.Clear();
+    update.mutable_remove_item()->mutable_id()->set_value("existing");
+    aggregator.add(update);
+
+    gvs::proto::SceneUpdate combined = aggregator.take_combined();
+    CHECK(combined.update_case() == gvs::proto::SceneUpdate::kRemoveItem);
+
+    // Resets discard everything before them
+    update.Clear();
+    update.mutable_add_item()->mutable_id()->set_value("discarded");
+    aggregator.add(update);
+    update.Clear();
+    update.mutable_reset_all_items();
+    aggregator.add(update);
+    update.Clear();
+    update.mutable_add_item()->mutable_id()->set_value("kept");
+    aggregator.add(update);
+
+    combined = aggregator.take_combined();
+    REQUIRE(combined.batch().updates_size() == 2);
+    CHECK(combined.batch().updates(0).update_case() == gvs::proto::SceneUpdate::kResetAllItems);
+    CHECK(combined.batch().updates(1).add_item().id().value() == "kept");
+}
+
+TEST_CASE("[util] aggregator merges transform batches") {
+    gvs::util::SceneUpdateAggregator aggregator;
+
+    auto make_transforms = [](const std::vector<std::uint32_t>& handles, float value) {
+        gvs::proto::SceneUpdate update;
+        for (std::uint32_t handle : handles) {
+            update.mutable_transforms()->add_handles(handle);
+            for (int i = 0; i < gvs::util::transform_size; ++i) {
+                update.mutable_transforms()->add_transformations(value);
+            }
+        }
+        return update;
+    };
+
+    aggregator.add(make_transforms({1u, 2u}, 1.f));
+    aggregator.add(make_transforms({2u, 3u}, 2.f));
+
+    // Consecutive batches become one with a single matrix per handle
+    gvs::proto::SceneUpdate combined = aggregator.take_combined();
+    REQUIRE(combined.update_case() == gvs::proto::SceneUpdate::kTransforms);
+    CHECK(combined.transforms().handles_size() == 3);
+    CHECK(combined.transforms().transformations_size() == 3 * gvs::util::transform_size);
+    CHECK(combined.transforms().transformations(gvs::util::transform_size) == 2.f);
+
+    // Items added after a batch are not moved in front of it
+    aggregator.add(make_transforms({1u}, 1.f));
+
+    gvs::proto::SceneUpdate update;
+    update.mutable_add_item()->mutable_id()->set_value("new");
+    update.mutable_add_item()->mutable_id()->set_handle(4u);
+    aggregator.add(update);
+
+    aggregator.add(make_transforms({4u}, 4.f));
+
+    // Later item transformations replace pending transforms
+    update.Clear();
+    update.mutable_update_item()->mutable_id()->set_value("one");
+    update.mutable_update_item()->mutable_id()->set_handle(1u);
+    for (int i = 0; i < gvs::util::transform_size; ++i) {
+        update.mutable_update_item()->mutable_display_info()->mutable_transformation()->add_data(5.f);
+    }
+    aggregator.add(update);
+
+    combined = aggregator.take_combined();
+    REQUIRE(combined.batch().updates_size() == 4);
+    CHECK(combined.batch().updates(0).transforms().transformations(0) == 5.f);
+    CHECK(combined.batch().updates(1).has_add_item());
+    CHECK(combined.batch().updates(2).transforms().handles(0) == 4u);
+    CHECK(combined.batch().updates(3).has_update_item());
+}
@@ -0,0 +1,88 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// generated
+#include <scene.pb.h>
+
+// standard
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief Combines scene updates so they can be sent to clients as a single message.
+ *
+ * Updates to the same item are merged, with later changes replacing earlier ones:
+ *
+ * | Pending Update | New Update | Combined Result                                 |
+ * | -------------- | ---------- | ----------------------------------------------- |
+ * | add            | update     | add (with the update applied)                   |
+ * | update         | update     | update (later fields replace earlier ones)      |
+ * | add            | remove     | nothing (the item was never seen by clients)    |
+ * | update         | remove     | remove                                          |
+ * | anything       | add        | add                                             |
+ * | anything       | reset      | reset (all pending updates are discarded)       |
+ * | transforms     | transforms | transforms (later matrices win)                 |
+ *
+ * Merged updates keep the position of the first pending update for that item. Transform batches are
+ * merged until another update is queued after them, and later item transformations overwrite any
+ * pending transform for the same handle so the latest matrix always wins.
+ */
+class SceneUpdateAggregator {
+public:
+    /// \brief Pass an rvalue to move the update into the pending updates instead of copying it
+    void add(proto::SceneUpdate update);
+
+    /// \brief True if there are no pending updates
+    bool empty() const;
+
+    /// \brief Returns a single update containing all the pending changes and clears the pending updates
+    proto::SceneUpdate take_combined();
+
+private:
+    std::vector<proto::SceneUpdate> pending_; ///< Cleared updates are left in place as UPDATE_NOT_SET
+    std::unordered_map<std::string, std::size_t> pending_index_; ///< item id -> index in 'pending_'
+    std::size_t num_pending_ = 0;
+
+    static constexpr std::size_t no_transforms = std::numeric_limits<std::size_t>::max();
+
+    struct TransformSlot {
+        std::size_t update_index; ///< index in 'pending_'
+        int offset; ///< index of the first float in the batch
+    };
+    std::unordered_map<std::uint32_t, TransformSlot> transform_slots_; ///< item handle -> latest pending transform
+    std::size_t open_transforms_ = no_transforms; ///< index of the batch that new transforms are merged into
+
+    void add_item_update(const std::string& id, proto::SceneUpdate&& update);
+    void add_transforms(const proto::TransformBatch& batch);
+
+    /// \brief Replaces the pending transform for the item (if there is one) with the item's transformation
+    void overwrite_pending_transform(const proto::SceneItemInfo& item);
+};
+
+} // namespace gvs::util
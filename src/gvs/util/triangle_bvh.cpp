@@ -0,0 +1,400 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "triangle_bvh.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace gvs::util {
+namespace {
+
+constexpr std::uint32_t num_bins = 16u;
+
+Vec3f operator-(const Vec3f& a, const Vec3f& b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+Vec3f cross(const Vec3f& a, const Vec3f& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+float dot(const Vec3f& a, const Vec3f& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/// Same as Aabb::expand and merge but visible to the compiler so the build loops get inlined
+void grow(Aabb* box, const Vec3f& point) {
+    for (auto i = 0u; i < 3u; ++i) {
+        box->min[i] = std::min(box->min[i], point[i]);
+        box->max[i] = std::max(box->max[i], point[i]);
+    }
+}
+
+void grow(Aabb* box, const Aabb& other) {
+    for (auto i = 0u; i < 3u; ++i) {
+        box->min[i] = std::min(box->min[i], other.min[i]);
+        box->max[i] = std::max(box->max[i], other.max[i]);
+    }
+}
+
+bool is_finite(const Vec3f& p) {
+    return std::isfinite(p[0]) and std::isfinite(p[1]) and std::isfinite(p[2]);
+}
+
+/// Moller-Trumbore intersection. Returns infinity if the triangle is missed.
+float ray_triangle_distance(
+    const Vec3f& origin, const Vec3f& direction, const Vec3f& a, const Vec3f& b, const Vec3f& c) {
+    constexpr float miss = std::numeric_limits<float>::infinity();
+
+    const Vec3f edge1 = b - a;
+    const Vec3f edge2 = c - a;
+    const Vec3f p = cross(direction, edge2);
+    const float determinant = dot(edge1, p);
+
+    if (determinant == 0.f) {
+        return miss; // parallel to the triangle (or the triangle is degenerate)
+    }
+
+    const float inverse_determinant = 1.f / determinant;
+    const Vec3f s = origin - a;
+    const float u = dot(s, p) * inverse_determinant;
+
+    if (u < 0.f or u > 1.f) {
+        return miss;
+    }
+
+    const Vec3f q = cross(s, edge1);
+    const float v = dot(direction, q) * inverse_determinant;
+
+    if (v < 0.f or u + v > 1.f) {
+        return miss;
+    }
+
+    const float distance = dot(edge2, q) * inverse_determinant;
+    return (distance >= 0.f ? distance : miss);
+}
+
+} // namespace
+
+TriangleBvh::TriangleBvh(std::vector<Vec3f> positions,
+                         const std::vector<std::uint32_t>& indices,
+                         std::uint32_t max_leaf_size)
+    : positions_(std::move(positions)), max_leaf_size_(std::max(max_leaf_size, 1u)) {
+
+    const auto num_positions = positions_.size();
+    const auto num_indices = (indices.empty() ? num_positions : indices.size());
+
+    triangles_.reserve(num_indices / 3u);
+    std::vector<Vec3f> centroids;
+    centroids.reserve(num_indices / 3u);
+
+    for (std::size_t i = 0u; i + 2u < num_indices; i += 3u) {
+        Triangle triangle;
+        if (indices.empty()) {
+            auto index = static_cast<std::uint32_t>(i);
+            triangle = {index, index + 1u, index + 2u};
+        } else {
+            triangle = {indices[i], indices[i + 1u], indices[i + 2u]};
+        }
+
+        bool valid = std::all_of(triangle.begin(), triangle.end(), [&](std::uint32_t index) {
+            return index < num_positions and is_finite(positions_[index]);
+        });
+
+        if (not valid) {
+            continue;
+        }
+
+        const Vec3f& a = positions_[triangle[0]];
+        const Vec3f& b = positions_[triangle[1]];
+        const Vec3f& c = positions_[triangle[2]];
+
+        grow(&root_bounds_, a);
+        grow(&root_bounds_, b);
+        grow(&root_bounds_, c);
+
+        triangles_.push_back(triangle);
+        centroids.push_back({(a[0] + b[0] + c[0]) / 3.f, (a[1] + b[1] + c[1]) / 3.f, (a[2] + b[2] + c[2]) / 3.f});
+    }
+
+    if (triangles_.empty()) {
+        return;
+    }
+
+    // A binary tree with leaves of at least one triangle never needs more than 2n - 1 nodes
+    nodes_.reserve(2u * triangles_.size() - 1u);
+    nodes_.push_back({root_bounds_, 0u, static_cast<std::uint32_t>(triangles_.size())});
+    build(0u, &centroids);
+
+    nodes_.shrink_to_fit();
+}
+
+float TriangleBvh::raycast(const Vec3f& origin, const Vec3f& direction, float max_distance) const {
+    float closest = std::numeric_limits<float>::infinity();
+
+    if (nodes_.empty()) {
+        return closest;
+    }
+
+    const Vec3f inverse_direction = {1.f / direction[0], 1.f / direction[1], 1.f / direction[2]};
+
+    if (ray_entry_distance(nodes_.front().bounds, origin, inverse_direction, max_distance) > max_distance) {
+        return closest;
+    }
+
+    std::vector<std::uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0u);
+
+    while (not stack.empty()) {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+
+        if (node.count > 0u) {
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const Triangle& triangle = triangles_[i];
+                float distance = ray_triangle_distance(origin,
+                                                       direction,
+                                                       positions_[triangle[0]],
+                                                       positions_[triangle[1]],
+                                                       positions_[triangle[2]]);
+                if (distance <= max_distance) {
+                    closest = distance;
+                    max_distance = distance;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so the farther one can often be skipped entirely
+        std::uint32_t near_child = static_cast<std::uint32_t>(&node - nodes_.data()) + 1u;
+        std::uint32_t far_child = node.first;
+
+        float near_distance = ray_entry_distance(nodes_[near_child].bounds, origin, inverse_direction, max_distance);
+        float far_distance = ray_entry_distance(nodes_[far_child].bounds, origin, inverse_direction, max_distance);
+
+        if (far_distance < near_distance) {
+            std::swap(near_child, far_child);
+            std::swap(near_distance, far_distance);
+        }
+
+        if (far_distance <= max_distance) {
+            stack.push_back(far_child);
+        }
+        if (near_distance <= max_distance) {
+            stack.push_back(near_child);
+        }
+    }
+
+    return closest;
+}
+
+std::size_t TriangleBvh::num_triangles() const {
+    return triangles_.size();
+}
+
+const Aabb& TriangleBvh::bounds() const {
+    return root_bounds_;
+}
+
+Aabb TriangleBvh::triangle_bounds(const Triangle& triangle) const {
+    Aabb bounds;
+    grow(&bounds, positions_[triangle[0]]);
+    grow(&bounds, positions_[triangle[1]]);
+    grow(&bounds, positions_[triangle[2]]);
+    return bounds;
+}
+
+void TriangleBvh::build(std::uint32_t node_index, std::vector<Vec3f>* centroids) {
+    const std::uint32_t first = nodes_[node_index].first;
+    const std::uint32_t count = nodes_[node_index].count;
+    const std::uint32_t end = first + count;
+
+    const Aabb bounds = nodes_[node_index].bounds;
+
+    Aabb centroid_bounds;
+    for (std::uint32_t i = first; i < end; ++i) {
+        grow(&centroid_bounds, (*centroids)[i]);
+    }
+
+    if (count <= 1u) {
+        return;
+    }
+
+    // Split along the axis where the centroids are most spread out
+    const Vec3f extent = centroid_bounds.max - centroid_bounds.min;
+    const auto axis = static_cast<std::size_t>(std::max_element(extent.begin(), extent.end()) - extent.begin());
+
+    if (extent[axis] <= 0.f) {
+        return; // every centroid is in the same spot so there is nothing to split
+    }
+
+    const float bin_scale = static_cast<float>(num_bins) / extent[axis];
+    auto bin_of = [&](const Vec3f& centroid) {
+        auto bin = static_cast<std::uint32_t>((centroid[axis] - centroid_bounds.min[axis]) * bin_scale);
+        return std::min(bin, num_bins - 1u);
+    };
+
+    std::array<Aabb, num_bins> bin_bounds = {};
+    std::array<std::uint32_t, num_bins> bin_counts = {};
+
+    for (std::uint32_t i = first; i < end; ++i) {
+        std::uint32_t bin = bin_of((*centroids)[i]);
+        grow(&bin_bounds[bin], triangle_bounds(triangles_[i]));
+        ++bin_counts[bin];
+    }
+
+    // Sweep from the right to get the bounds and cost of everything above each split, then from the left
+    std::array<Aabb, num_bins> right_bounds = {};
+    std::array<float, num_bins> right_costs = {};
+    std::uint32_t right_count = 0u;
+
+    for (std::uint32_t bin = num_bins - 1u; bin > 0u; --bin) {
+        right_bounds[bin] = (bin + 1u < num_bins ? right_bounds[bin + 1u] : Aabb{});
+        grow(&right_bounds[bin], bin_bounds[bin]);
+        right_count += bin_counts[bin];
+        right_costs[bin] = static_cast<float>(right_count) * right_bounds[bin].surface_area();
+    }
+
+    float best_cost = std::numeric_limits<float>::infinity();
+    std::uint32_t best_split = 0u; // bins [0, best_split) go left
+    Aabb best_left_bounds;
+    Aabb left_bounds;
+    std::uint32_t left_count = 0u;
+
+    for (std::uint32_t split = 1u; split < num_bins; ++split) {
+        grow(&left_bounds, bin_bounds[split - 1u]);
+        left_count += bin_counts[split - 1u];
+
+        if (left_count == 0u or left_count == count) {
+            continue;
+        }
+
+        float cost = static_cast<float>(left_count) * left_bounds.surface_area() + right_costs[split];
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_split = split;
+            best_left_bounds = left_bounds;
+        }
+    }
+
+    const float leaf_cost = static_cast<float>(count) * bounds.surface_area();
+    if (best_split == 0u or (count <= max_leaf_size_ and leaf_cost <= best_cost)) {
+        return;
+    }
+
+    std::uint32_t middle = first;
+    for (std::uint32_t i = first; i < end; ++i) {
+        if (bin_of((*centroids)[i]) < best_split) {
+            std::swap(triangles_[i], triangles_[middle]);
+            std::swap((*centroids)[i], (*centroids)[middle]);
+            ++middle;
+        }
+    }
+
+    // 'nodes_' has already reserved enough space so these references stay valid
+    auto left_index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back({best_left_bounds, first, middle - first});
+    build(left_index, centroids);
+
+    auto right_index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back({right_bounds[best_split], middle, end - middle});
+    nodes_[node_index].first = right_index;
+    nodes_[node_index].count = 0u;
+    build(right_index, centroids);
+}
+
+TEST_CASE("[util] triangle bvh matches brute force raycasts") {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> position(-10.f, 10.f);
+    std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+
+    // Small random triangles, indexed so every vertex is shared by two triangles
+    std::vector<Vec3f> positions;
+    std::vector<std::uint32_t> indices;
+
+    for (std::uint32_t i = 0u; i < 2'000u; ++i) {
+        Vec3f center = {position(gen), position(gen), position(gen)};
+        for (int v = 0; v < 4; ++v) {
+            positions.push_back({center[0] + offset(gen), center[1] + offset(gen), center[2] + offset(gen)});
+        }
+        indices.insert(indices.end(), {4u * i, 4u * i + 1u, 4u * i + 2u, 4u * i, 4u * i + 2u, 4u * i + 3u});
+    }
+    indices.insert(indices.end(), {0u, 1u, 100'000u}); // out of range so it is skipped
+
+    TriangleBvh bvh(positions, indices);
+    CHECK(bvh.num_triangles() == 4'000u);
+
+    auto brute_force = [&](const Vec3f& origin, const Vec3f& direction, float max_distance) {
+        float closest = std::numeric_limits<float>::infinity();
+        for (std::size_t i = 0u; i + 5u < indices.size(); i += 3u) {
+            float distance = ray_triangle_distance(origin,
+                                                   direction,
+                                                   positions[indices[i]],
+                                                   positions[indices[i + 1u]],
+                                                   positions[indices[i + 2u]]);
+            if (distance <= max_distance) {
+                closest = distance;
+                max_distance = distance;
+            }
+        }
+        return closest;
+    };
+
+    int num_hits = 0;
+    for (int i = 0; i < 500; ++i) {
+        Vec3f origin = {position(gen) * 2.f, position(gen) * 2.f, position(gen) * 2.f};
+        Vec3f target = {position(gen), position(gen), position(gen)};
+        Vec3f direction = target - origin;
+        float length = std::sqrt(dot(direction, direction));
+        direction = {direction[0] / length, direction[1] / length, direction[2] / length};
+
+        float max_distance = (i % 2 == 0 ? std::numeric_limits<float>::infinity() : 25.f);
+        float expected = brute_force(origin, direction, max_distance);
+        float actual = bvh.raycast(origin, direction, max_distance);
+
+        if (std::isinf(expected)) {
+            CHECK(std::isinf(actual));
+        } else {
+            ++num_hits;
+            CHECK(actual == doctest::Approx(expected));
+        }
+    }
+    CHECK(num_hits > 0);
+
+    SUBCASE("unindexed") {
+        TriangleBvh quad({{-1.f, -1.f, 0.f}, {1.f, -1.f, 0.f}, {1.f, 1.f, 0.f}, {-1.f, -1.f, 0.f}, {1.f, 1.f, 0.f}});
+        CHECK(quad.num_triangles() == 1u); // the last two positions don't make a full triangle
+        CHECK(quad.raycast({0.5f, 0.f, 2.f}, {0.f, 0.f, -1.f}, 10.f) == doctest::Approx(2.f));
+        CHECK(std::isinf(quad.raycast({-0.5f, 0.f, 2.f}, {0.f, 0.f, -1.f}, 10.f)));
+        CHECK(std::isinf(quad.raycast({0.5f, 0.f, 2.f}, {0.f, 0.f, -1.f}, 1.f)));
+    }
+}
+
+} // namespace gvs::util
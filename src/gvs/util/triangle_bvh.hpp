@@ -0,0 +1,84 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/aabb_tree.hpp"
+
+// standard
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gvs::util {
+
+/**
+ * @brief A static bounding volume hierarchy over a triangle mesh used to find the closest
+ *        triangle hit by a ray. Built top down by splitting triangle centroids with a binned
+ *        surface area heuristic, so it is meant to be built once (off the render thread for
+ *        large meshes) and queried many times.
+ */
+class TriangleBvh {
+public:
+    /**
+     * @param positions - xyz for each vertex
+     * @param indices - three vertex indices per triangle. If empty, every three positions form a triangle.
+     * @param max_leaf_size - leaves are only split further if it is cheaper to do so or they exceed this size
+     *
+     * Triangles with out of range indices or non-finite positions are left out.
+     */
+    explicit TriangleBvh(std::vector<Vec3f> positions,
+                         const std::vector<std::uint32_t>& indices = {},
+                         std::uint32_t max_leaf_size = 8u);
+
+    /// \brief The distance along the ray to the closest triangle (either side), or infinity if
+    ///        no triangle is hit within 'max_distance'. Distances are in units of 'direction'.
+    float raycast(const Vec3f& origin, const Vec3f& direction, float max_distance) const;
+
+    std::size_t num_triangles() const;
+    const Aabb& bounds() const;
+
+private:
+    struct Node {
+        Aabb bounds;
+        std::uint32_t first = 0; ///< first triangle for leaves, second child for interior nodes
+        std::uint32_t count = 0; ///< zero for interior nodes, whose first child directly follows them
+    };
+
+    using Triangle = std::array<std::uint32_t, 3>;
+
+    std::vector<Node> nodes_; ///< depth first order
+    std::vector<Vec3f> positions_;
+    std::vector<Triangle> triangles_; ///< grouped by leaf
+
+    Aabb root_bounds_;
+    std::uint32_t max_leaf_size_;
+
+    Aabb triangle_bounds(const Triangle& triangle) const;
+
+    /// \brief Splits the node (recursively) if that lowers the expected cost of a raycast
+    void build(std::uint32_t node_index, std::vector<Vec3f>* centroids);
+};
+
+} // namespace gvs::util
@@ -0,0 +1,309 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "vertex_layout.hpp"
+
+// project
+#include "gvs/log/log_params.hpp"
+#include "gvs/util/attribute_view.hpp"
+
+// external
+#include <doctest/doctest.h>
+
+// standard
+#include <array>
+#include <cstring>
+
+namespace gvs::util {
+
+std::uint32_t component_count(proto::VertexAttribute attribute) {
+    switch (attribute) {
+    case proto::ATTRIBUTE_POSITION:
+    case proto::ATTRIBUTE_NORMAL:
+    case proto::ATTRIBUTE_VERTEX_COLOR:
+        return 3u;
+
+    case proto::ATTRIBUTE_TEX_COORD:
+        return 2u;
+
+    /* Safe to ignore */
+    case proto::VertexAttribute_INT_MIN_SENTINEL_DO_NOT_USE_:
+    case proto::VertexAttribute_INT_MAX_SENTINEL_DO_NOT_USE_:
+        break;
+    }
+    return 0u;
+}
+
+std::uint32_t component_size(proto::VertexAttributeType type) {
+    switch (type) {
+    case proto::FLOAT32:
+        return 4u;
+
+    case proto::UNORM8:
+        return 1u;
+
+    /* Safe to ignore */
+    case proto::VertexAttributeType_INT_MIN_SENTINEL_DO_NOT_USE_:
+    case proto::VertexAttributeType_INT_MAX_SENTINEL_DO_NOT_USE_:
+        break;
+    }
+    return 0u;
+}
+
+const proto::VertexAttributeLayout* find_attribute(const proto::InterleavedVertices& vertices,
+                                                   proto::VertexAttribute attribute) {
+    for (const proto::VertexAttributeLayout& layout : vertices.attributes()) {
+        if (layout.attribute() == attribute) {
+            return &layout;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t vertex_count(const proto::InterleavedVertices& vertices) {
+    if (vertices.stride() == 0u) {
+        return 0u;
+    }
+    return vertices.data().size() / vertices.stride();
+}
+
+std::string layout_error(const proto::InterleavedVertices& vertices) {
+    if (vertices.data().empty() and vertices.attributes().empty()) {
+        return "";
+    }
+
+    if (vertices.stride() == 0u) {
+        return "Interleaved vertices have a stride of zero";
+    }
+
+    if (vertices.data().size() % vertices.stride() != 0u) {
+        return "Interleaved vertex data (" + std::to_string(vertices.data().size())
+            + " bytes) is not a multiple of the stride (" + std::to_string(vertices.stride()) + " bytes)";
+    }
+
+    std::uint32_t seen = 0u;
+
+    for (const proto::VertexAttributeLayout& layout : vertices.attributes()) {
+        if (component_count(layout.attribute()) == 0u or component_size(layout.type()) == 0u) {
+            return "Unknown vertex attribute or type";
+        }
+
+        auto attribute_bit = 1u << static_cast<std::uint32_t>(layout.attribute());
+        if (seen & attribute_bit) {
+            return "Vertex attribute '" + proto::VertexAttribute_Name(layout.attribute()) + "' is listed twice";
+        }
+        seen |= attribute_bit;
+
+        if (layout.attribute() == proto::ATTRIBUTE_POSITION and layout.type() != proto::FLOAT32) {
+            return "Interleaved positions must be FLOAT32";
+        }
+
+        std::uint64_t end = std::uint64_t(layout.offset())
+            + std::uint64_t(component_count(layout.attribute())) * component_size(layout.type());
+
+        if (end > vertices.stride()) {
+            return "Vertex attribute '" + proto::VertexAttribute_Name(layout.attribute())
+                + "' extends past the end of the vertex stride";
+        }
+    }
+    return "";
+}
+
+Aabb position_bounds(const proto::GeometryInfo3D& geometry) {
+    Aabb bounds;
+
+    const proto::InterleavedVertices& interleaved = geometry.interleaved_vertices();
+    const proto::VertexAttributeLayout* layout = find_attribute(interleaved, proto::ATTRIBUTE_POSITION);
+
+    if (layout and layout_error(interleaved).empty()) {
+        const char* vertex = interleaved.data().data() + layout->offset();
+
+        for (std::size_t i = 0; i < vertex_count(interleaved); ++i, vertex += interleaved.stride()) {
+            Vec3f position;
+            std::memcpy(position.data(), vertex, sizeof(position));
+            bounds.expand(position);
+        }
+        return bounds;
+    }
+    AttributeView<float> positions = attribute_view(geometry.positions());
+
+    for (auto i = 0u; i + 2u < positions.size(); i += 3u) {
+        bounds.expand({positions[i], positions[i + 1u], positions[i + 2u]});
+    }
+    return bounds;
+}
+
+std::string instance_error(const proto::GeometryInfo3D& geometry) {
+    std::size_t transform_floats = attribute_view(geometry.instance_transformations()).size();
+    std::size_t color_floats = attribute_view(geometry.instance_colors()).size();
+
+    if (transform_floats % 16u != 0u) {
+        return "Instance transformations (" + std::to_string(transform_floats)
+            + " floats) are not a multiple of 16";
+    }
+
+    if (color_floats != 0u and color_floats != (transform_floats / 16u) * 3u) {
+        return "Expected 3 instance color values per instance (" + std::to_string(transform_floats / 16u)
+            + " instances) but got " + std::to_string(color_floats);
+    }
+    return "";
+}
+
+std::size_t instance_count(const proto::GeometryInfo3D& geometry) {
+    return attribute_view(geometry.instance_transformations()).size() / 16u;
+}
+
+Aabb geometry_bounds(const proto::GeometryInfo3D& geometry) {
+    Aabb local_bounds = position_bounds(geometry);
+
+    if (instance_count(geometry) == 0u or local_bounds.empty()) {
+        return local_bounds;
+    }
+
+    const float* instance = attribute_view(geometry.instance_transformations()).data();
+    Aabb bounds;
+
+    for (std::size_t i = 0; i < instance_count(geometry); ++i, instance += 16) {
+        bounds = merge(bounds, local_bounds.transformed(instance));
+    }
+    return bounds;
+}
+
+TEST_CASE("[util] interleaved vertex layouts") {
+    struct Vertex {
+        float position[3];
+        float tex_coords[2];
+        unsigned char color[4];
+    };
+    Vertex vertices[] = {{{1.f, 2.f, 3.f}, {0.f, 1.f}, {255, 0, 0, 255}}, {{4.f, 5.f, 6.f}, {1.f, 0.f}, {0, 255, 0, 255}}};
+
+    proto::InterleavedVertices interleaved;
+    interleaved.set_data(reinterpret_cast<const char*>(vertices), sizeof(vertices));
+    interleaved.set_stride(sizeof(Vertex));
+
+    auto add_attribute = [&](proto::VertexAttribute attribute, std::size_t offset, proto::VertexAttributeType type) {
+        proto::VertexAttributeLayout* layout = interleaved.add_attributes();
+        layout->set_attribute(attribute);
+        layout->set_offset(static_cast<std::uint32_t>(offset));
+        layout->set_type(type);
+    };
+    add_attribute(proto::ATTRIBUTE_POSITION, offsetof(Vertex, position), proto::FLOAT32);
+    add_attribute(proto::ATTRIBUTE_TEX_COORD, offsetof(Vertex, tex_coords), proto::FLOAT32);
+    add_attribute(proto::ATTRIBUTE_VERTEX_COLOR, offsetof(Vertex, color), proto::UNORM8);
+
+    CHECK(layout_error(interleaved).empty());
+    CHECK(vertex_count(interleaved) == 2u);
+    CHECK(find_attribute(interleaved, proto::ATTRIBUTE_TEX_COORD)->offset() == offsetof(Vertex, tex_coords));
+    CHECK(find_attribute(interleaved, proto::ATTRIBUTE_NORMAL) == nullptr);
+
+    CHECK(layout_error(proto::InterleavedVertices{}).empty());
+
+    proto::GeometryInfo3D geometry;
+    *geometry.mutable_interleaved_vertices() = interleaved;
+    CHECK(position_bounds(geometry).min == Vec3f{1.f, 2.f, 3.f});
+    CHECK(position_bounds(geometry).max == Vec3f{4.f, 5.f, 6.f});
+
+    SUBCASE("partial_vertex") {
+        interleaved.mutable_data()->pop_back();
+        CHECK_FALSE(layout_error(interleaved).empty());
+    }
+
+    SUBCASE("attribute_past_stride") {
+        interleaved.mutable_attributes(2)->set_type(proto::FLOAT32);
+        CHECK_FALSE(layout_error(interleaved).empty());
+    }
+
+    SUBCASE("duplicate_attribute") {
+        add_attribute(proto::ATTRIBUTE_POSITION, 0u, proto::FLOAT32);
+        CHECK_FALSE(layout_error(interleaved).empty());
+    }
+
+    SUBCASE("normalized_positions") {
+        interleaved.mutable_attributes(0)->set_type(proto::UNORM8);
+        CHECK_FALSE(layout_error(interleaved).empty());
+    }
+}
+
+TEST_CASE("[util] instanced geometry bounds") {
+    proto::GeometryInfo3D geometry;
+    for (float value : {-1.f, -1.f, -1.f, 1.f, 1.f, 1.f}) {
+        geometry.mutable_positions()->add_value(value);
+    }
+    CHECK(instance_error(geometry).empty());
+    CHECK(instance_count(geometry) == 0u);
+    CHECK(geometry_bounds(geometry).max == Vec3f{1.f, 1.f, 1.f});
+
+    // Two instances translated along x
+    for (float x : {10.f, -10.f}) {
+        std::array<float, 16> translation
+            = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, x, 0.f, 0.f, 1.f};
+        for (float value : translation) {
+            geometry.mutable_instance_transformations()->add_value(value);
+        }
+    }
+    CHECK(instance_error(geometry).empty());
+    CHECK(instance_count(geometry) == 2u);
+    CHECK(geometry_bounds(geometry).min == Vec3f{-11.f, -1.f, -1.f});
+    CHECK(geometry_bounds(geometry).max == Vec3f{11.f, 1.f, 1.f});
+
+    SUBCASE("partial_transform") {
+        geometry.mutable_instance_transformations()->add_value(0.f);
+        CHECK_FALSE(instance_error(geometry).empty());
+    }
+
+    SUBCASE("colors_per_instance") {
+        geometry.mutable_instance_colors()->add_value(1.f);
+        CHECK_FALSE(instance_error(geometry).empty());
+
+        for (int i = 0; i < 5; ++i) {
+            geometry.mutable_instance_colors()->add_value(0.5f);
+        }
+        CHECK(instance_error(geometry).empty());
+    }
+}
+
+TEST_CASE("[util] instances sent with the logger params") {
+    // The params store raw bytes in 'data' (not the repeated 'value' field) on little-endian hosts
+    proto::SceneItemInfo info;
+    CHECK(gvs::positions_3d(std::vector<float>{-1.f, -1.f, -1.f, 1.f, 1.f, 1.f})(&info).empty());
+
+    std::vector<float> transforms;
+    for (float x : {10.f, -10.f}) {
+        std::array<float, 16> translation
+            = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, x, 0.f, 0.f, 1.f};
+        transforms.insert(transforms.end(), translation.begin(), translation.end());
+    }
+    CHECK(gvs::instance_transformations(std::move(transforms))(&info).empty());
+
+    const proto::GeometryInfo3D& geometry = info.geometry_info();
+    CHECK(instance_count(geometry) == 2u);
+    CHECK(instance_error(geometry).empty());
+    CHECK(geometry_bounds(geometry).min == Vec3f{-11.f, -1.f, -1.f});
+    CHECK(geometry_bounds(geometry).max == Vec3f{11.f, 1.f, 1.f});
+
+    SUBCASE("one_color_for_two_instances") {
+        CHECK(gvs::instance_colors(std::vector<float>{1.f, 0.f, 0.f})(&info).empty());
+        CHECK_FALSE(instance_error(geometry).empty());
+    }
+}
+
+} // namespace gvs::util
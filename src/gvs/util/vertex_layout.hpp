@@ -0,0 +1,85 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/aabb_tree.hpp"
+
+// generated
+#include <types.pb.h>
+
+// standard
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gvs::util {
+
+/**
+ * @brief The number of components the viewer reads for each attribute (3 for positions, 2 for tex coords, etc.)
+ */
+std::uint32_t component_count(proto::VertexAttribute attribute);
+
+/**
+ * @brief The size of a single component in bytes
+ */
+std::uint32_t component_size(proto::VertexAttributeType type);
+
+/**
+ * @brief The layout of 'attribute' in the interleaved vertices or null if the attribute isn't stored there
+ */
+const proto::VertexAttributeLayout* find_attribute(const proto::InterleavedVertices& vertices,
+                                                   proto::VertexAttribute attribute);
+
+/**
+ * @brief The number of complete vertices in the interleaved data
+ */
+std::size_t vertex_count(const proto::InterleavedVertices& vertices);
+
+/**
+ * @brief Returns a message describing why the layout can't be used with the vertex data (empty if it is valid)
+ */
+std::string layout_error(const proto::InterleavedVertices& vertices);
+
+/**
+ * @brief The bounds of the geometry's positions (interleaved if present, otherwise the separate list)
+ */
+Aabb position_bounds(const proto::GeometryInfo3D& geometry);
+
+/**
+ * @brief Returns a message describing why the instance lists can't be used (empty if they are valid)
+ */
+std::string instance_error(const proto::GeometryInfo3D& geometry);
+
+/**
+ * @brief The number of instances to draw (zero if the geometry isn't instanced)
+ */
+std::size_t instance_count(const proto::GeometryInfo3D& geometry);
+
+/**
+ * @brief The bounds of the geometry after applying every instance transform (same as 'position_bounds' if the
+ *        geometry isn't instanced)
+ */
+Aabb geometry_bounds(const proto::GeometryInfo3D& geometry);
+
+} // namespace gvs::util
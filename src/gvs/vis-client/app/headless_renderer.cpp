@@ -0,0 +1,156 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "headless_renderer.hpp"
+
+#include "gvs/vis-client/app/imgui_theme.hpp"
+#include "gvs/vis-client/scene/opengl_scene.hpp"
+
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <imgui.h>
+
+#include <stdexcept>
+
+static void initialize_resources() {
+    CORRADE_RESOURCE_INITIALIZE(gvs_client_RESOURCES)
+}
+
+namespace gvs::vis {
+
+using namespace Magnum;
+
+HeadlessRenderer::HeadlessRenderer(const Vector2i& viewport)
+    : viewport_(viewport), egl_context_(Platform::WindowlessGLContext::Configuration{}) {
+
+    if (not egl_context_.isCreated() or not egl_context_.makeCurrent() or not gl_context_.tryCreate()) {
+        throw std::runtime_error("Failed to create a headless OpenGL context");
+    }
+
+    if (not GL::Context::current().isVersionSupported(GL::Version::GL450)) {
+        throw std::runtime_error("The headless OpenGL context does not support OpenGL 4.5");
+    }
+
+    initialize_resources();
+
+    color_ = GL::Renderbuffer{};
+    color_.setStorage(GL::RenderbufferFormat::RGBA8, viewport_);
+
+    depth_stencil_ = GL::Renderbuffer{};
+    depth_stencil_.setStorage(GL::RenderbufferFormat::Depth24Stencil8, viewport_);
+
+    framebuffer_ = GL::Framebuffer{{{}, viewport_}};
+    framebuffer_.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, color_)
+        .attachRenderbuffer(GL::Framebuffer::BufferAttachment::DepthStencil, depth_stencil_);
+
+    if (framebuffer_.checkStatus(GL::FramebufferTarget::Draw) != GL::Framebuffer::Status::Complete) {
+        throw std::runtime_error("The headless framebuffer is incomplete");
+    }
+
+    // Everything (including the scene's own passes) draws into the offscreen framebuffer
+    framebuffer_.bind();
+
+    // Same setup as 'ImGuiMagnumApplication' so frames cost the same as they do in the viewer
+    imgui_ = ImGuiIntegration::Context{Vector2{viewport_}, viewport_, viewport_};
+
+    theme_ = std::make_unique<detail::Theme>();
+    theme_->set_style();
+    GL::Renderer::setClearColor({theme_->background.Value.x,
+                                 theme_->background.Value.y,
+                                 theme_->background.Value.z,
+                                 theme_->background.Value.w});
+
+    GL::Renderer::setBlendEquation(GL::Renderer::BlendEquation::Add, GL::Renderer::BlendEquation::Add);
+    GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha,
+                                   GL::Renderer::BlendFunction::OneMinusSourceAlpha);
+
+    camera_package_.object.setParent(&camera_scene_);
+
+    // Memory ownership is handled elsewhere
+    camera_package_.set_camera(new SceneGraph::Camera3D(camera_package_.object), viewport_);
+    look_at({0.f, 0.f, 15.f}, {});
+
+    scene_ = std::make_unique<OpenGLScene>(make_scene_init_info(theme_->background, viewport_));
+}
+
+HeadlessRenderer::~HeadlessRenderer() = default;
+
+SceneInterface& HeadlessRenderer::scene() {
+    return *scene_;
+}
+
+void HeadlessRenderer::look_at(const Vector3& eye, const Vector3& target) {
+    camera_package_.transformation = Matrix4::lookAt(eye, target, Vector3::yAxis());
+    camera_package_.object.setTransformation(camera_package_.transformation);
+}
+
+void HeadlessRenderer::update() {
+    scene_->update(viewport_);
+    GL::Renderer::finish();
+}
+
+void HeadlessRenderer::render() {
+    framebuffer_.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth);
+    scene_->render(camera_package_);
+    GL::Renderer::finish();
+}
+
+void HeadlessRenderer::draw_gui() {
+    imgui_.newFrame();
+
+    ImGui::SetNextWindowPos({0.f, 0.f});
+    ImGui::Begin("Settings", nullptr, ImVec2(350.f, static_cast<float>(viewport_.y())));
+    scene_->configure_gui(viewport_);
+    ImGui::End();
+
+    GL::Renderer::enable(GL::Renderer::Feature::Blending);
+    GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
+    GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
+    GL::Renderer::enable(GL::Renderer::Feature::ScissorTest);
+
+    imgui_.drawFrame();
+
+    GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
+    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
+    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+    GL::Renderer::disable(GL::Renderer::Feature::Blending);
+
+    GL::Renderer::finish();
+}
+
+void HeadlessRenderer::draw_frame() {
+    update();
+    render();
+    draw_gui();
+}
+
+Image2D HeadlessRenderer::read_pixels() {
+    return framebuffer_.read(framebuffer_.viewport(), {PixelFormat::RGBA8Unorm});
+}
+
+} // namespace gvs::vis
@@ -0,0 +1,94 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "gvs/forward_declarations.hpp"
+#include "gvs/vis-client/scene/camera_package.hpp"
+#include "gvs/vis-client/scene/scene_interface.hpp"
+
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/Image.h>
+#include <Magnum/ImGuiIntegration/Context.hpp>
+#include <Magnum/Platform/GLContext.h>
+#include <Magnum/Platform/WindowlessEglApplication.h>
+#include <Magnum/SceneGraph/Scene.h>
+
+#include <memory>
+
+namespace gvs::vis {
+
+/**
+ * @brief Draws an 'OpenGLScene' and the scene GUI into an offscreen framebuffer.
+ *
+ * The OpenGL context is created through EGL so no window or display server is
+ * needed. With Mesa's software drivers (llvmpipe) no GPU is needed either.
+ *
+ * Each step of a frame waits for the GPU to finish so the time spent in a step
+ * includes the OpenGL work it caused.
+ */
+class HeadlessRenderer {
+public:
+    explicit HeadlessRenderer(const Magnum::Vector2i& viewport = {1280, 720});
+    ~HeadlessRenderer();
+
+    SceneInterface& scene();
+
+    /// \brief Places the camera at 'eye' looking at 'target'
+    void look_at(const Magnum::Vector3& eye, const Magnum::Vector3& target);
+
+    // The three steps of a frame, in the order the viewer runs them
+    void update();
+    void render();
+    void draw_gui();
+
+    /// \brief Runs 'update', 'render', and 'draw_gui'
+    void draw_frame();
+
+    /// \brief The colors drawn by the last frame
+    Magnum::Image2D read_pixels();
+
+private:
+    using Scene3D = Magnum::SceneGraph::Scene<Magnum::SceneGraph::MatrixTransformation3D>;
+
+    Magnum::Vector2i viewport_;
+
+    // These are declared in the order they need to be created (and the reverse of the
+    // order they need to be destroyed). Nothing can be created before the context.
+    Magnum::Platform::WindowlessGLContext egl_context_;
+    Magnum::Platform::GLContext gl_context_{Magnum::NoCreate};
+
+    Magnum::GL::Renderbuffer color_{Magnum::NoCreate};
+    Magnum::GL::Renderbuffer depth_stencil_{Magnum::NoCreate};
+    Magnum::GL::Framebuffer framebuffer_{Magnum::NoCreate};
+
+    Magnum::ImGuiIntegration::Context imgui_{Magnum::NoCreate};
+    std::unique_ptr<detail::Theme> theme_;
+
+    Scene3D camera_scene_;
+    CameraPackage camera_package_;
+
+    std::unique_ptr<SceneInterface> scene_;
+};
+
+} // namespace gvs::vis
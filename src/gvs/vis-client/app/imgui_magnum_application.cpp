@@ -27,6 +27,7 @@
 
 #include <Corrade/Utility/Resource.h>
 #include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/GL/Version.h>
 #include <Magnum/Math/Angle.h>
@@ -60,6 +61,8 @@ float intersect_plane(const Ray& ray, Vector3 p, const Vector3& plane_normal) {
     return std::numeric_limits<float>::infinity();
 }
 
+constexpr float max_click_distance = 3.f; // pixels
+
 } // namespace
 
 ImGuiMagnumApplication::ImGuiMagnumApplication(const Arguments& arguments, const Configuration& configuration)
@@ -94,6 +97,15 @@ ImGuiMagnumApplication::ImGuiMagnumApplication(const Arguments& arguments, const
     camera_package_.set_camera(new SceneGraph::Camera3D(camera_package_.object),
                                GL::defaultFramebuffer.viewport().size());
 
+    gpu_timing_ = GL::Context::current().isExtensionSupported<GL::Extensions::ARB::timer_query>();
+
+    if (gpu_timing_) {
+        for (GpuTimeQueries& queries : gpu_queries_) {
+            queries.render = GL::TimeQuery{GL::TimeQuery::Target::TimeElapsed};
+            queries.imgui = GL::TimeQuery{GL::TimeQuery::Target::TimeElapsed};
+        }
+    }
+
     update_camera();
     reset_draw_counter();
 }
@@ -112,11 +124,38 @@ void ImGuiMagnumApplication::reset_draw_counter() {
 }
 
 void ImGuiMagnumApplication::drawEvent() {
-    update();
+    profiler_.begin_frame();
+    read_gpu_times();
+
+    GpuTimeQueries* gpu_queries = nullptr;
+
+    if (gpu_timing_) {
+        gpu_queries = &gpu_queries_[profiler_.frame_index() % gpu_queries_.size()];
+        gpu_queries->frame_index = profiler_.frame_index(); // Drops the old results if they never arrived
+    }
+
+    {
+        auto scope = profiler_.scope("update");
+        update();
+    }
+
+    {
+        auto scope = profiler_.scope("render");
 
-    GL::defaultFramebuffer.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth);
+        if (gpu_queries) {
+            gpu_queries->render.begin();
+        }
 
-    render(camera_package_);
+        GL::defaultFramebuffer.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth);
+
+        render(camera_package_);
+
+        if (gpu_queries) {
+            gpu_queries->render.end();
+        }
+    }
+
+    auto imgui_start = util::FrameProfiler::Clock::now();
 
     imgui_.newFrame();
 
@@ -129,8 +168,16 @@ void ImGuiMagnumApplication::drawEvent() {
     GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
     GL::Renderer::enable(GL::Renderer::Feature::ScissorTest);
 
+    if (gpu_queries) {
+        gpu_queries->imgui.begin();
+    }
+
     imgui_.drawFrame();
 
+    if (gpu_queries) {
+        gpu_queries->imgui.end();
+    }
+
     /* Reset state. Only needed if you want to draw something else with
        different state next frame. */
     GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
@@ -138,7 +185,14 @@ void ImGuiMagnumApplication::drawEvent() {
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
     GL::Renderer::disable(GL::Renderer::Feature::Blending);
 
-    swapBuffers();
+    profiler_.add_event("imgui", imgui_start, util::FrameProfiler::Clock::now());
+
+    {
+        auto scope = profiler_.scope("swap");
+        swapBuffers();
+    }
+
+    profiler_.end_frame();
 
     if (draw_counter_-- > 0) {
         redraw();
@@ -210,14 +264,31 @@ void ImGuiMagnumApplication::mousePressEvent(MouseEvent& event) {
     event.setAccepted(true);
 
     previous_position_ = Vector2(event.position());
+
+    if (event.button() == MouseEvent::Button::Left) {
+        press_position_ = previous_position_;
+        left_pressed_ = true;
+    }
 }
 
 void ImGuiMagnumApplication::mouseReleaseEvent(MouseEvent& event) {
     reset_draw_counter();
     if (imgui_.handleMouseReleaseEvent(event)) {
+        left_pressed_ = false;
         return;
     }
     event.setAccepted(true);
+
+    if (event.button() != MouseEvent::Button::Left or not left_pressed_) {
+        return;
+    }
+    left_pressed_ = false;
+
+    // Dragging rotates the camera so only a release close to the press counts as a click
+    auto position = Vector2(event.position());
+    if ((position - press_position_).length() <= max_click_distance) {
+        pick(camera_package_.get_camera_ray_from_window_pos(position));
+    }
 }
 
 void ImGuiMagnumApplication::mouseMoveEvent(MouseMoveEvent& event) {
@@ -275,6 +346,21 @@ void ImGuiMagnumApplication::mouseScrollEvent(MouseScrollEvent& event) {
     update_camera();
 }
 
+void ImGuiMagnumApplication::read_gpu_times() {
+    for (GpuTimeQueries& queries : gpu_queries_) {
+        if (queries.frame_index == 0u or not queries.imgui.resultAvailable()) {
+            continue;
+        }
+
+        // Results are in nanoseconds
+        profiler_.add_gpu_time(
+            queries.frame_index, "gpu render", static_cast<double>(queries.render.result<UnsignedLong>()) * 1e-3);
+        profiler_.add_gpu_time(
+            queries.frame_index, "gpu imgui", static_cast<double>(queries.imgui.result<UnsignedLong>()) * 1e-3);
+        queries.frame_index = 0u;
+    }
+}
+
 void ImGuiMagnumApplication::update_camera() {
     camera_package_.transformation = Matrix4::translation(camera_orbit_point_)
         * Matrix4::rotation(Math::Rad<float>(camera_yaw_and_pitch_.x()), {0.f, 1.f, 0.f})
@@ -23,14 +23,17 @@
 #pragma once
 
 #include "gvs/forward_declarations.hpp"
+#include "gvs/util/frame_profiler.hpp"
 #include "gvs/vis-client/scene/camera_package.hpp"
 
 #include <Magnum/GL/DefaultFramebuffer.h>
+#include <Magnum/GL/TimeQuery.h>
 #include <Magnum/ImGuiIntegration/Context.hpp>
 #include <Magnum/Platform/GlfwApplication.h>
 #include <Magnum/SceneGraph/Scene.h>
 #include <Magnum/SceneGraph/SceneGraph.h>
 
+#include <array>
 #include <memory>
 
 namespace gvs::vis {
@@ -49,6 +52,10 @@ protected:
     // finished to give ImGui a chance to update and render correctly.
     void reset_draw_counter();
 
+    // Times the update, render, ImGui, and swap phases of every frame (and the GPU time
+    // of rendering and ImGui if timer queries are available)
+    util::FrameProfiler profiler_;
+
 private:
     virtual void update() = 0;
     virtual void render(const CameraPackage& camera_package) const = 0;
@@ -56,6 +63,9 @@ private:
 
     virtual void resize(const Magnum::Vector2i& viewport) = 0;
 
+    /// \brief Called when the scene is clicked (pressed and released without dragging)
+    virtual void pick(const Ray& world_ray) = 0;
+
     void drawEvent() override;
     void viewportEvent(ViewportEvent& event) override;
 
@@ -72,14 +82,28 @@ private:
 
     void update_camera();
 
+    /// \brief Adds the GPU times of earlier frames to the profiler once the GPU has finished them
+    void read_gpu_times();
+
     Magnum::ImGuiIntegration::Context imgui_{Magnum::NoCreate};
     int draw_counter_ = 1; // continue drawing until this counter is zero
 
+    // Results are read a few frames later so waiting for them never stalls the CPU
+    struct GpuTimeQueries {
+        Magnum::GL::TimeQuery render{Magnum::NoCreate};
+        Magnum::GL::TimeQuery imgui{Magnum::NoCreate};
+        std::uint64_t frame_index = 0; ///< The frame that is being timed (zero if nothing is pending)
+    };
+    std::array<GpuTimeQueries, 4> gpu_queries_;
+    bool gpu_timing_ = false; ///< Timer queries are supported
+
     // Camera
     Magnum::SceneGraph::Scene<Magnum::SceneGraph::MatrixTransformation3D> camera_scene_;
     CameraPackage camera_package_;
 
     Magnum::Vector2 previous_position_ = {};
+    Magnum::Vector2 press_position_ = {};
+    bool left_pressed_ = false; ///< The left button was pressed outside of ImGui
     Magnum::Vector2 camera_yaw_and_pitch_ = {};
     float camera_orbit_distance_ = 15.f;
     Magnum::Vector3 camera_orbit_point_ = {};
@@ -0,0 +1,79 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "bounded_drawable.hpp"
+
+#include "gvs/util/frustum.hpp"
+
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Object.h>
+
+using namespace Magnum;
+
+namespace gvs::vis {
+
+BoundedDrawable::BoundedDrawable(SceneGraph::Object<SceneGraph::MatrixTransformation3D>& object,
+                                 SceneGraph::DrawableGroup3D* group)
+    : SceneGraph::Drawable3D{object, group} {
+    // 'clean' is called with the new world transformation whenever the object moves
+    setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+}
+
+void BoundedDrawable::set_local_bounds(const util::Aabb& local_bounds) {
+    local_bounds_ = local_bounds;
+    world_bounds_ = local_bounds_.transformed(world_from_local_.data());
+}
+
+const util::Aabb& BoundedDrawable::world_bounds() const {
+    return world_bounds_;
+}
+
+const Matrix4& BoundedDrawable::world_from_local() const {
+    return world_from_local_;
+}
+
+void BoundedDrawable::clean(const Matrix4& absolute_transformation_matrix) {
+    world_from_local_ = absolute_transformation_matrix;
+    world_bounds_ = local_bounds_.transformed(world_from_local_.data());
+}
+
+void collect_visible(SceneGraph::DrawableGroup3D& group,
+                     SceneGraph::Camera3D& camera,
+                     DrawableTransformations* visible) {
+    Matrix4 camera_from_world = camera.cameraMatrix();
+    util::Frustum frustum((camera.projectionMatrix() * camera_from_world).data());
+
+    visible->clear();
+
+    for (std::size_t i = 0; i < group.size(); ++i) {
+        auto& drawable = static_cast<BoundedDrawable&>(group[i]);
+
+        // Only recomputes the bounds if the object moved
+        drawable.object().setClean();
+
+        if (frustum.intersects(drawable.world_bounds())) {
+            visible->emplace_back(drawable, camera_from_world * drawable.world_from_local());
+        }
+    }
+}
+
+} // namespace gvs::vis
@@ -0,0 +1,77 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "gvs/util/aabb_tree.hpp"
+
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/Drawable.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace gvs::vis {
+
+/**
+ * @brief A drawable that keeps the world space bounds of its geometry up to date so it can be
+ *        skipped when it is outside the view.
+ *
+ * The bounds are only recomputed when the object (or one of its parents) moves.
+ */
+class BoundedDrawable : public Magnum::SceneGraph::Drawable3D {
+public:
+    explicit BoundedDrawable(Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>& object,
+                             Magnum::SceneGraph::DrawableGroup3D* group);
+
+    ~BoundedDrawable() override = default;
+
+    void set_local_bounds(const util::Aabb& local_bounds);
+
+    const util::Aabb& world_bounds() const;
+    const Magnum::Matrix4& world_from_local() const;
+
+protected:
+    void clean(const Magnum::Matrix4& absolute_transformation_matrix) override;
+
+private:
+    util::Aabb local_bounds_;
+    util::Aabb world_bounds_;
+    Magnum::Matrix4 world_from_local_;
+};
+
+using DrawableTransformations
+    = std::vector<std::pair<std::reference_wrapper<Magnum::SceneGraph::Drawable3D>, Magnum::Matrix4>>;
+
+/**
+ * @brief Fills 'visible' with the drawables in 'group' whose world bounds intersect the camera's
+ *        view, paired with their camera relative transformations (ready for 'Camera3D::draw').
+ *
+ * Every drawable in 'group' must be a 'BoundedDrawable'.
+ */
+void collect_visible(Magnum::SceneGraph::DrawableGroup3D& group,
+                     Magnum::SceneGraph::Camera3D& camera,
+                     DrawableTransformations* visible);
+
+} // namespace gvs::vis
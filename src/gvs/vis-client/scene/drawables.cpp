@@ -22,6 +22,7 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #include "drawables.hpp"
 
+#include <Corrade/Containers/ArrayView.h>
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Shader.h>
 #include <Magnum/Math/Matrix4.h>
@@ -37,8 +38,13 @@ namespace gvs::vis {
 OpaqueDrawable::OpaqueDrawable(SceneGraph::Object<SceneGraph::MatrixTransformation3D>& object,
                                SceneGraph::DrawableGroup3D* group,
                                GL::Mesh& mesh,
-                               GeneralShader3D& shader)
-    : SceneGraph::Drawable3D{object, group}, object_(object), mesh_(mesh), shader_(shader) {}
+                               GeneralShader3D& shader,
+                               GeneralShader3D& instanced_shader)
+    : BoundedDrawable{object, group},
+      object_(object),
+      mesh_(mesh),
+      shader_(shader),
+      instanced_shader_(instanced_shader) {}
 
 void OpaqueDrawable::update_display_info(const gvs::proto::DisplayInfo& display_info) {
 
@@ -52,34 +58,95 @@ void OpaqueDrawable::update_display_info(const gvs::proto::DisplayInfo& display_
     }
 
     if (display_info.has_coloring()) {
-        coloring_ = display_info.coloring().value();
+        uniforms_.coloring = display_info.coloring().value();
     }
 
     if (display_info.has_uniform_color()) {
-        uniform_color_ = Magnum::Color3{display_info.uniform_color().x(),
-                                        display_info.uniform_color().y(),
-                                        display_info.uniform_color().z()};
+        uniforms_.uniform_color = Magnum::Color3{display_info.uniform_color().x(),
+                                                 display_info.uniform_color().y(),
+                                                 display_info.uniform_color().z()};
     }
 
     if (display_info.has_shading()) {
-        shading_.CopyFrom(display_info.shading());
+        uniforms_.set_shading(display_info.shading());
     }
+
+    uniforms_changed_ = true;
+}
+
+void OpaqueDrawable::set_batch(MeshBatch* batch, std::size_t slot) {
+    batch_ = batch;
+    batch_slot_ = slot;
+    uniforms_changed_ = true;
+}
+
+void OpaqueDrawable::set_instanced(bool instanced, bool has_instance_colors) {
+    instanced_ = instanced;
+    uniforms_.has_instance_colors = (instanced and has_instance_colors) ? 1 : 0;
+    uniforms_changed_ = true;
+}
+
+void OpaqueDrawable::set_point_cloud(PointCloud* point_cloud) {
+    point_cloud_ = point_cloud;
+}
+
+MeshBatch* OpaqueDrawable::batch() const {
+    return batch_;
+}
+
+std::size_t OpaqueDrawable::batch_slot() const {
+    return batch_slot_;
+}
+
+const ItemUniforms& OpaqueDrawable::uniforms() const {
+    return uniforms_;
+}
+
+std::uint64_t OpaqueDrawable::sort_key() const {
+    if (batch_) {
+        return 0u;
+    }
+    auto primitive = static_cast<std::uint64_t>(mesh_.primitive());
+    auto coloring = static_cast<std::uint64_t>(uniforms_.coloring);
+    auto shading = static_cast<std::uint64_t>(uniforms_.shading);
+    auto instanced = static_cast<std::uint64_t>(instanced_);
+    return (std::uint64_t{1} << 48u) | (instanced << 40u) | (primitive << 32u) | (coloring << 16u) | shading;
+}
+
+void OpaqueDrawable::clean(const Matrix4& absolute_transformation_matrix) {
+    BoundedDrawable::clean(absolute_transformation_matrix);
+    uniforms_changed_ = true;
 }
 
 void OpaqueDrawable::draw(const Matrix4& transformation_matrix, SceneGraph::Camera3D& camera) {
-    // unnecessarily expensive doing the inverse every time.
-    auto world_transform = camera.cameraMatrix().inverted() * transformation_matrix;
-    // TODO: figure out how to cache the variable since the camera won't changer during a render
-    //  (OR) firgure out how to get the transformation_matrix without the camera transform part
-
-    shader_.set_world_from_local_matrix(world_transform)
-        .set_world_from_local_normal_matrix(world_transform.rotationScaling())
-        .set_projection_from_local_matrix(camera.projectionMatrix() * transformation_matrix)
-        .set_coloring(coloring_)
-        .set_uniform_color(uniform_color_)
-        .set_shading(shading_);
-
-    mesh_.draw(shader_);
+    // The camera matrices are set once per frame so only this item's data is needed here
+    if (uniforms_changed_) {
+        uniforms_.set_world_from_local(world_from_local());
+
+        if (batch_) {
+            batch_->set_uniforms(batch_slot_, uniforms_);
+        } else {
+            uniform_buffer_.setData(Containers::ArrayView<const void>(&uniforms_, sizeof(ItemUniforms)),
+                                    GL::BufferUsage::DynamicDraw);
+        }
+        uniforms_changed_ = false;
+    }
+
+    if (batch_) {
+        // Drawn with the rest of the batch once every item has been visited
+        batch_->queue_draw(batch_slot_);
+        return;
+    }
+
+    if (point_cloud_) {
+        shader_.bind_item_uniforms(uniform_buffer_);
+        point_cloud_->draw(shader_, transformation_matrix, camera);
+        return;
+    }
+
+    GeneralShader3D& shader = instanced_ ? instanced_shader_ : shader_;
+    shader.bind_item_uniforms(uniform_buffer_);
+    mesh_.draw(shader);
 }
 
 } // namespace gvs::vis
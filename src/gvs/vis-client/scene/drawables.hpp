@@ -22,36 +22,69 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include "gvs/vis-client/scene/bounded_drawable.hpp"
 #include "gvs/vis-client/scene/general_shader_3d.hpp"
+#include "gvs/vis-client/scene/mesh_batch.hpp"
+#include "gvs/vis-client/scene/point_cloud.hpp"
 
 #include <types.grpc.pb.h>
 
+#include <Magnum/GL/Buffer.h>
 #include <Magnum/SceneGraph/Drawable.h>
 
+#include <cstdint>
+
 namespace gvs::vis {
 
-class OpaqueDrawable : public Magnum::SceneGraph::Drawable3D {
+class OpaqueDrawable : public BoundedDrawable {
 public:
     explicit OpaqueDrawable(Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>& object,
                             Magnum::SceneGraph::DrawableGroup3D* group,
                             Magnum::GL::Mesh& mesh,
-                            GeneralShader3D& shader);
+                            GeneralShader3D& shader,
+                            GeneralShader3D& instanced_shader);
 
     void update_display_info(const proto::DisplayInfo& display_info);
 
+    /// \brief Draws the item as part of 'batch' instead of with its own mesh. Pass null to draw it alone again.
+    void set_batch(MeshBatch* batch, std::size_t slot);
+
+    /// \brief Draws the mesh once per instance with the instanced shader. The mesh must have
+    ///        per-instance transformations (and colors if 'has_instance_colors' is set).
+    void set_instanced(bool instanced, bool has_instance_colors);
+
+    /// \brief Draws 'point_cloud' instead of the mesh. Pass null to draw the mesh again.
+    void set_point_cloud(PointCloud* point_cloud);
+
+    MeshBatch* batch() const;
+    std::size_t batch_slot() const;
+
+    const ItemUniforms& uniforms() const;
+
+    /// \brief Draws with equal keys need the same state. Batched draws are sorted first.
+    std::uint64_t sort_key() const;
+
     ~OpaqueDrawable() override = default;
 
 private:
+    void clean(const Magnum::Matrix4& absolute_transformation_matrix) override;
     void draw(const Magnum::Matrix4& transformation_matrix, Magnum::SceneGraph::Camera3D& camera) override;
 
     Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>& object_;
     Magnum::GL::Mesh& mesh_;
 
-    proto::Coloring coloring_ = proto::Coloring::UNIFORM_COLOR;
-    Magnum::Color3 uniform_color_ = {1.f, 0.9f, 0.7f};
-    proto::Shading shading_;
+    ItemUniforms uniforms_;
+    Magnum::GL::Buffer uniform_buffer_;
+    bool uniforms_changed_ = true; ///< 'uniforms_' are uploaded before the next draw if true
+
+    MeshBatch* batch_ = nullptr;
+    std::size_t batch_slot_ = 0;
+
+    bool instanced_ = false;
+    PointCloud* point_cloud_ = nullptr;
 
     GeneralShader3D& shader_;
+    GeneralShader3D& instanced_shader_;
 };
 
 } // namespace gvs::vis
@@ -24,6 +24,7 @@
 
 #include <Corrade/Containers/Reference.h>
 #include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Buffer.h>
 #include <Magnum/GL/Context.h>
 #include <Magnum/GL/Shader.h>
 #include <Magnum/GL/Version.h>
@@ -32,7 +33,7 @@
 
 namespace gvs::vis {
 
-GeneralShader3D::GeneralShader3D() {
+GeneralShader3D::GeneralShader3D(Variant variant) {
     MAGNUM_ASSERT_GL_VERSION_SUPPORTED(Magnum::GL::Version::GL450);
 
     const Corrade::Utility::Resource rs{"gvs-resource-data"};
@@ -40,6 +41,21 @@ GeneralShader3D::GeneralShader3D() {
     Magnum::GL::Shader vert{Magnum::GL::Version::GL450, Magnum::GL::Shader::Type::Vertex};
     Magnum::GL::Shader frag{Magnum::GL::Version::GL450, Magnum::GL::Shader::Type::Fragment};
 
+    switch (variant) {
+    case Variant::Single:
+        break;
+
+    case Variant::Batched:
+        vert.addSource("#define BATCHED_DRAWS\n");
+        frag.addSource("#define BATCHED_DRAWS\n");
+        break;
+
+    case Variant::Instanced:
+        vert.addSource("#define INSTANCED_DRAWS\n");
+        frag.addSource("#define INSTANCED_DRAWS\n");
+        break;
+    }
+
     vert.addSource(rs.get("general_shader.vert"));
     frag.addSource(rs.get("general_shader.frag"));
 
@@ -51,60 +67,42 @@ GeneralShader3D::GeneralShader3D() {
     attachShaders({vert, frag});
 
     CORRADE_INTERNAL_ASSERT_OUTPUT(link());
-
-    world_from_local_uniform_ = uniformLocation("world_from_local");
-    world_from_local_normals_uniform_ = uniformLocation("world_from_local_normals");
-    projection_from_local_uniform_ = uniformLocation("projection_from_local");
-
-    coloring_uniform_ = uniformLocation("coloring");
-    uniform_color_uniform_ = uniformLocation("uniform_color");
-
-    shading_uniform_ = uniformLocation("shading");
-    light_direction_uniform_ = uniformLocation("light_direction");
-    light_color_uniform_ = uniformLocation("light_color");
-    ambient_color_uniform_ = uniformLocation("ambient_color");
 }
 
-GeneralShader3D& GeneralShader3D::set_world_from_local_matrix(const Magnum::Matrix4& world_from_local) {
-    setUniform(world_from_local_uniform_, world_from_local);
+GeneralShader3D& GeneralShader3D::bind_frame_uniforms(Magnum::GL::Buffer& buffer) {
+    buffer.bind(Magnum::GL::Buffer::Target::Uniform, frame_uniforms_binding);
     return *this;
 }
 
-GeneralShader3D& GeneralShader3D::set_world_from_local_normal_matrix(const Magnum::Matrix3& world_from_local_normals) {
-    setUniform(world_from_local_normals_uniform_, world_from_local_normals);
+GeneralShader3D& GeneralShader3D::bind_item_uniforms(Magnum::GL::Buffer& buffer) {
+    buffer.bind(Magnum::GL::Buffer::Target::Uniform, item_uniforms_binding);
     return *this;
 }
 
-GeneralShader3D& GeneralShader3D::set_projection_from_local_matrix(const Magnum::Matrix4& projection_from_local) {
-    setUniform(projection_from_local_uniform_, projection_from_local);
-    return *this;
-}
-
-GeneralShader3D& GeneralShader3D::set_coloring(const proto::Coloring& coloring) {
-    setUniform(coloring_uniform_, coloring);
-    return *this;
-}
+void ItemUniforms::set_world_from_local(const Magnum::Matrix4& world_from_local_matrix) {
+    world_from_local = world_from_local_matrix;
 
-GeneralShader3D& GeneralShader3D::set_uniform_color(const Magnum::Color3& color) {
-    setUniform(uniform_color_uniform_, color);
-    return *this;
+    Magnum::Matrix3x3 normals = world_from_local.rotationScaling();
+    for (auto i = 0u; i < 3u; ++i) {
+        world_from_local_normals[i] = Magnum::Vector4{Magnum::Vector3{normals[i]}, 0.f};
+    }
 }
 
-GeneralShader3D& GeneralShader3D::set_shading(const proto::Shading& shading) {
-    switch (shading.value_case()) {
+void ItemUniforms::set_shading(const proto::Shading& shading_info) {
+    switch (shading_info.value_case()) {
     case proto::Shading::VALUE_NOT_SET:
     case proto::Shading::kUniformColor:
-        setUniform(shading_uniform_, 0);
+        shading = 0;
         break;
 
     case proto::Shading::kLambertian:
-        setUniform(shading_uniform_, 1);
+        shading = 1;
 
-        const proto::LambertianShading& lambertian = shading.lambertian();
+        const proto::LambertianShading& lambertian = shading_info.lambertian();
 
-        Magnum::Vector3 light_direction{-1.f, -1.f, -1.f};
-        Magnum::Vector3 light_color{1.f, 1.f, 1.f};
-        Magnum::Vector3 ambient_color{0.15f, 0.15f, 0.15f};
+        light_direction = {-1.f, -1.f, -1.f};
+        light_color = {1.f, 1.f, 1.f};
+        ambient_color = {0.15f, 0.15f, 0.15f};
 
         if (lambertian.has_light_direction()) {
             light_direction = {lambertian.light_direction().x(),
@@ -120,13 +118,8 @@ GeneralShader3D& GeneralShader3D::set_shading(const proto::Shading& shading) {
             ambient_color
                 = {lambertian.ambient_color().x(), lambertian.ambient_color().y(), lambertian.ambient_color().z()};
         }
-
-        setUniform(light_direction_uniform_, light_direction);
-        setUniform(light_color_uniform_, light_color);
-        setUniform(ambient_color_uniform_, ambient_color);
         break;
     }
-    return *this;
 }
 
 } // namespace gvs::vis
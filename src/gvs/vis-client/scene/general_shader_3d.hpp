@@ -25,40 +25,72 @@
 #include <types.pb.h>
 
 #include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/GL.h>
 #include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
 
 namespace gvs::vis {
 
+/// Matches the std140 'FrameUniforms' block in the shaders. Set once per frame.
+struct FrameUniforms {
+    Magnum::Matrix4 projection_from_world;
+};
+
+/// Matches 'ItemData' in the shaders (the std140 'ItemUniforms' block or one element of the std430
+/// 'BatchedItems' buffer, both have the same layout). Only uploaded when the item changes.
+struct ItemUniforms {
+    Magnum::Matrix4 world_from_local;
+    Magnum::Vector4 world_from_local_normals[3] = {{1.f, 0.f, 0.f, 0.f}, // std140 pads mat3 columns to vec4s
+                                                   {0.f, 1.f, 0.f, 0.f},
+                                                   {0.f, 0.f, 1.f, 0.f}};
+
+    Magnum::Color3 uniform_color = {1.f, 0.9f, 0.7f};
+    Magnum::Int coloring = proto::Coloring::UNIFORM_COLOR;
+
+    Magnum::Vector3 light_direction = {-1.f, -1.f, -1.f};
+    Magnum::Int shading = 0;
+
+    Magnum::Color3 light_color = {1.f, 1.f, 1.f};
+    Magnum::Float opacity = 1.f;
+
+    Magnum::Color3 ambient_color = {0.15f, 0.15f, 0.15f};
+    Magnum::Int has_instance_colors = 0; ///< Instance colors replace 'uniform_color' (instanced shader only)
+
+    void set_world_from_local(const Magnum::Matrix4& world_from_local_matrix);
+    void set_shading(const proto::Shading& shading_info);
+};
+static_assert(sizeof(ItemUniforms) == 176, "ItemUniforms must match the std140 layout");
+
 class GeneralShader3D : public Magnum::GL::AbstractShaderProgram {
 public:
     typedef Magnum::GL::Attribute<0, Magnum::Vector3> Position;
     typedef Magnum::GL::Attribute<1, Magnum::Vector3> Normal;
     typedef Magnum::GL::Attribute<2, Magnum::Vector2> TextureCoordinate;
     typedef Magnum::GL::Attribute<3, Magnum::Vector3> VertexColor;
+    typedef Magnum::GL::Attribute<4, Magnum::UnsignedInt> ItemIndex; ///< Only used by the batched shader
 
-    explicit GeneralShader3D();
-
-    GeneralShader3D& set_world_from_local_matrix(const Magnum::Matrix4& view_from_local);
-    GeneralShader3D& set_world_from_local_normal_matrix(const Magnum::Matrix3& view_from_local_normal);
-    GeneralShader3D& set_projection_from_local_matrix(const Magnum::Matrix4& projection_from_local);
+    /// Per-instance attributes, only used by the instanced shader (the matrix takes locations 5 to 8)
+    typedef Magnum::GL::Attribute<5, Magnum::Matrix4> InstanceTransformation;
+    typedef Magnum::GL::Attribute<9, Magnum::Vector3> InstanceColor;
 
-    GeneralShader3D& set_coloring(const proto::Coloring& coloring);
-    GeneralShader3D& set_uniform_color(const Magnum::Color3& color);
+    /// Buffer binding points set in the shaders
+    static constexpr Magnum::UnsignedInt frame_uniforms_binding = 0;
+    static constexpr Magnum::UnsignedInt item_uniforms_binding = 1;
+    static constexpr Magnum::UnsignedInt batched_items_binding = 2;
 
-    GeneralShader3D& set_shading(const proto::Shading& shading);
+    enum class Variant {
+        Single, ///< One item per draw using the 'ItemUniforms' block
+        Batched, ///< Reads item data from the 'BatchedItems' storage buffer (see 'MeshBatch')
+        Instanced, ///< One item per draw with per-instance transformations and colors
+    };
 
-private:
-    int projection_from_local_uniform_;
-    int world_from_local_uniform_;
-    int world_from_local_normals_uniform_;
+    explicit GeneralShader3D(Variant variant = Variant::Single);
 
-    int coloring_uniform_;
-    int uniform_color_uniform_;
+    /// \brief 'buffer' holds 'FrameUniforms' for all the draws that follow
+    GeneralShader3D& bind_frame_uniforms(Magnum::GL::Buffer& buffer);
 
-    int shading_uniform_;
-    int light_direction_uniform_;
-    int light_color_uniform_;
-    int ambient_color_uniform_;
+    /// \brief 'buffer' holds 'ItemUniforms' for the next draw
+    GeneralShader3D& bind_item_uniforms(Magnum::GL::Buffer& buffer);
 };
 
 } // namespace gvs::vis
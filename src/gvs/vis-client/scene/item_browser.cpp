@@ -0,0 +1,312 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "item_browser.hpp"
+
+#include "gvs/vis-client/imgui_utils.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace gvs::vis {
+
+namespace {
+
+// Both keys of a node are in the search index so the lowest bit of each value says which key it is
+std::uint32_t id_key(std::uint32_t node) {
+    return node << 1u;
+}
+
+std::uint32_t readable_id_key(std::uint32_t node) {
+    return (node << 1u) | 1u;
+}
+
+} // namespace
+
+ItemBrowser::ItemBrowser() {
+    clear();
+}
+
+void ItemBrowser::add_item(const std::string& id) {
+    if (find(id) != root or id.empty()) {
+        return;
+    }
+
+    auto node = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back({id, "", root, {}, false, false});
+    nodes_[root].children.push_back(node);
+    nodes_by_id_.emplace(id, node);
+    search_index_.insert(id, id_key(node));
+
+    ++num_items_;
+    rows_changed_ = true;
+}
+
+void ItemBrowser::remove_item(const std::string& id) {
+    std::uint32_t node = find(id);
+    if (node == root) {
+        return;
+    }
+
+    for (std::uint32_t child : std::vector<std::uint32_t>(nodes_[node].children)) {
+        detach(child);
+        nodes_[child].parent = root;
+        nodes_[root].children.push_back(child);
+    }
+    detach(node);
+
+    search_index_.erase(nodes_[node].id, id_key(node));
+    if (not nodes_[node].readable_id.empty()) {
+        search_index_.erase(nodes_[node].readable_id, readable_id_key(node));
+    }
+    nodes_by_id_.erase(id);
+
+    nodes_[node] = {};
+    nodes_[node].removed = true;
+
+    if (selected_ == node) {
+        selected_ = root;
+    }
+
+    --num_items_;
+    rows_changed_ = true;
+}
+
+void ItemBrowser::set_parent(const std::string& id, const std::string& parent_id) {
+    std::uint32_t node = find(id);
+    std::uint32_t parent = find(parent_id);
+
+    if (node == root or nodes_[node].parent == parent) {
+        return;
+    }
+
+    // Items can't be moved under themselves
+    for (std::uint32_t ancestor = parent; ancestor != root; ancestor = nodes_[ancestor].parent) {
+        if (ancestor == node) {
+            return;
+        }
+    }
+
+    detach(node);
+    nodes_[node].parent = parent;
+    nodes_[parent].children.push_back(node);
+    rows_changed_ = true;
+}
+
+void ItemBrowser::set_readable_id(const std::string& id, const std::string& readable_id) {
+    std::uint32_t node = find(id);
+
+    if (node == root or nodes_[node].readable_id == readable_id) {
+        return;
+    }
+
+    if (not nodes_[node].readable_id.empty()) {
+        search_index_.erase(nodes_[node].readable_id, readable_id_key(node));
+    }
+    if (not readable_id.empty()) {
+        search_index_.insert(readable_id, readable_id_key(node));
+    }
+    nodes_[node].readable_id = readable_id;
+}
+
+void ItemBrowser::clear() {
+    nodes_.clear();
+    nodes_by_id_.clear();
+    search_index_.clear();
+    rows_.clear();
+
+    nodes_.push_back({"", "", root, {}, true, false});
+    num_items_ = 0;
+    rows_changed_ = true;
+    selected_ = root;
+}
+
+void ItemBrowser::select(const std::string& id) {
+    selected_ = find(id);
+
+    if (selected_ == root) {
+        return;
+    }
+
+    for (std::uint32_t ancestor = nodes_[selected_].parent; ancestor != root; ancestor = nodes_[ancestor].parent) {
+        if (not nodes_[ancestor].expanded) {
+            nodes_[ancestor].expanded = true;
+            rows_changed_ = true;
+        }
+    }
+
+    // The search results are hidden so the item can be seen in the tree
+    search_.clear();
+    scroll_to_selected_ = true;
+}
+
+const std::string& ItemBrowser::selected() const {
+    return nodes_[selected_].id;
+}
+
+void ItemBrowser::configure_gui(float height) {
+    ImGui::Text("%zu items", num_items_);
+    imgui::configure_gui("Search", &search_);
+
+    ImGui::BeginChild("Item Rows", {0.f, height}, true);
+
+    float row_height = ImGui::GetTextLineHeightWithSpacing();
+
+    if (search_.empty()) {
+        update_rows();
+
+        if (scroll_to_selected_) {
+            auto row = std::find_if(rows_.begin(), rows_.end(), [&](const Row& r) { return r.node == selected_; });
+            if (row != rows_.end()) {
+                ImGui::SetScrollY(static_cast<float>(row - rows_.begin()) * row_height);
+            }
+            scroll_to_selected_ = false;
+        }
+
+        ImGuiListClipper clipper(static_cast<int>(rows_.size()), row_height);
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                configure_tree_row(rows_[static_cast<std::size_t>(i)]);
+            }
+        }
+
+    } else {
+        util::PrefixIndex::Range matches = search_index_.find(search_);
+
+        ImGuiListClipper clipper(static_cast<int>(matches.size()), row_height);
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                configure_search_row(matches[static_cast<std::size_t>(i)]);
+            }
+        }
+    }
+
+    ImGui::EndChild();
+
+    configure_selected_gui();
+}
+
+std::uint32_t ItemBrowser::find(const std::string& id) const {
+    auto iter = nodes_by_id_.find(id);
+    return iter == nodes_by_id_.end() ? root : iter->second;
+}
+
+void ItemBrowser::detach(std::uint32_t node) {
+    std::vector<std::uint32_t>& siblings = nodes_[nodes_[node].parent].children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+}
+
+void ItemBrowser::update_rows() {
+    if (not rows_changed_) {
+        return;
+    }
+    rows_.clear();
+
+    // Depth first so children are listed under their parent
+    std::vector<Row> stack;
+    for (auto child = nodes_[root].children.rbegin(); child != nodes_[root].children.rend(); ++child) {
+        stack.push_back({*child, 0});
+    }
+
+    while (not stack.empty()) {
+        Row row = stack.back();
+        stack.pop_back();
+        rows_.push_back(row);
+
+        const Node& node = nodes_[row.node];
+        if (node.expanded) {
+            for (auto child = node.children.rbegin(); child != node.children.rend(); ++child) {
+                stack.push_back({*child, row.depth + 1});
+            }
+        }
+    }
+
+    rows_changed_ = false;
+}
+
+void ItemBrowser::configure_tree_row(const Row& row) {
+    Node& node = nodes_[row.node];
+
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_OpenOnArrow;
+    if (node.children.empty()) {
+        flags |= ImGuiTreeNodeFlags_Leaf;
+    }
+    if (row.node == selected_) {
+        flags |= ImGuiTreeNodeFlags_Selected;
+    }
+
+    ImGui::PushID(static_cast<int>(row.node));
+    ImGui::SetCursorPosX(ImGui::GetCursorPosX() + static_cast<float>(row.depth) * ImGui::GetTreeNodeToLabelSpacing());
+
+    ImGui::SetNextItemOpen(node.expanded);
+    const std::string& label = (node.readable_id.empty() ? node.id : node.readable_id);
+    bool open = ImGui::TreeNodeEx("##item", flags, "%s", label.c_str());
+
+    if (open != node.expanded) {
+        node.expanded = open;
+        rows_changed_ = true;
+
+    } else if (ImGui::IsItemClicked()) {
+        selected_ = row.node;
+    }
+
+    if (not node.readable_id.empty()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", node.id.c_str());
+    }
+    ImGui::PopID();
+}
+
+void ItemBrowser::configure_search_row(const util::PrefixIndex::Entry& entry) {
+    std::uint32_t node_index = entry.value >> 1u;
+    bool matched_readable_id = (entry.value & 1u) != 0u;
+    const Node& node = nodes_[node_index];
+
+    ImGui::PushID(static_cast<int>(entry.value));
+
+    // The matching key is shown (ids and readable ids are both searched)
+    const std::string& label = (matched_readable_id ? node.readable_id : node.id);
+    if (ImGui::Selectable(label.c_str(), node_index == selected_)) {
+        select(node.id);
+    }
+
+    if (matched_readable_id) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", node.id.c_str());
+    }
+    ImGui::PopID();
+}
+
+void ItemBrowser::configure_selected_gui() {
+    if (selected_ == root) {
+        return;
+    }
+    const Node& node = nodes_[selected_];
+
+    ImGui::Text("Selected:    %s", node.id.c_str());
+    ImGui::Text("Readable id: %s", node.readable_id.c_str());
+    ImGui::Text("Parent:      %s", node.parent == root ? "(root)" : nodes_[node.parent].id.c_str());
+    ImGui::Text("Children:    %zu", node.children.size());
+}
+
+} // namespace gvs::vis
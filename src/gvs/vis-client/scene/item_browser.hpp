@@ -0,0 +1,105 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "gvs/util/prefix_index.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gvs::vis {
+
+/**
+ * @brief A tree of the scene items that can be searched by id or readable id.
+ *
+ * Only the rows that are scrolled into view are drawn so the cost of a frame doesn't depend
+ * on the number of items. The rows of the expanded tree are only recomputed when the tree
+ * changes and searches use a 'util::PrefixIndex' instead of scanning every item.
+ */
+class ItemBrowser {
+public:
+    ItemBrowser();
+
+    /// \brief Adds an item without a readable id to the root of the tree
+    void add_item(const std::string& id);
+
+    /// \brief Removes the item. Its children are moved to the root of the tree.
+    void remove_item(const std::string& id);
+
+    /// \brief Moves the item under the parent (an empty id is the root)
+    void set_parent(const std::string& id, const std::string& parent_id);
+    void set_readable_id(const std::string& id, const std::string& readable_id);
+
+    /// \brief Removes every item
+    void clear();
+
+    /// \brief Selects the item, expands its ancestors, and scrolls to it. An empty id clears the selection.
+    void select(const std::string& id);
+
+    /// \brief Empty if nothing is selected
+    const std::string& selected() const;
+
+    /// \brief Draws the search box, the visible rows, and details of the selected item
+    void configure_gui(float height);
+
+private:
+    struct Node {
+        std::string id;
+        std::string readable_id;
+        std::uint32_t parent = 0;
+        std::vector<std::uint32_t> children;
+        bool expanded = false;
+        bool removed = false; ///< Removed nodes keep their slot so the indices of other nodes stay valid
+    };
+
+    struct Row {
+        std::uint32_t node;
+        int depth;
+    };
+
+    static constexpr std::uint32_t root = 0;
+
+    std::vector<Node> nodes_; ///< 'root' is always the first node
+    std::unordered_map<std::string, std::uint32_t> nodes_by_id_;
+    std::size_t num_items_ = 0;
+
+    util::PrefixIndex search_index_; ///< Both the id and readable id of each node (see 'id_key')
+    std::string search_;
+
+    std::vector<Row> rows_; ///< Expanded part of the tree in display order
+    bool rows_changed_ = true;
+
+    std::uint32_t selected_ = root;
+    bool scroll_to_selected_ = false;
+
+    std::uint32_t find(const std::string& id) const; ///< 'root' if the item doesn't exist
+    void detach(std::uint32_t node);
+    void update_rows();
+    void configure_tree_row(const Row& row);
+    void configure_search_row(const util::PrefixIndex::Entry& entry);
+    void configure_selected_gui();
+};
+
+} // namespace gvs::vis
@@ -0,0 +1,185 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "mesh_batch.hpp"
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+
+using namespace Magnum;
+
+namespace gvs::vis {
+
+MeshBatch::MeshBatch(GL::MeshPrimitive primitive, GeneralShader3D& batched_shader)
+    : primitive_(primitive), shader_(batched_shader) {
+    mesh_.setPrimitive(primitive_)
+        .addVertexBuffer(vertices_.buffer,
+                         0,
+                         GeneralShader3D::Position{},
+                         GeneralShader3D::Normal{},
+                         GeneralShader3D::TextureCoordinate{},
+                         GeneralShader3D::VertexColor{})
+        .addVertexBufferInstanced(item_indices_.buffer, 1, 0, GeneralShader3D::ItemIndex{})
+        .setIndexBuffer(indices_.buffer, 0, MeshIndexType::UnsignedInt);
+}
+
+std::size_t MeshBatch::add(const BatchGeometry& geometry, const ItemUniforms& uniforms) {
+    std::size_t slot_index;
+
+    if (free_slots_.empty()) {
+        slot_index = slots_.size();
+        slots_.emplace_back();
+        items_.data.emplace_back();
+
+        item_indices_.data.emplace_back(static_cast<UnsignedInt>(slot_index));
+        item_indices_.changed = true;
+    } else {
+        slot_index = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    Slot& slot = slots_[slot_index];
+    slot.first_vertex = static_cast<UnsignedInt>(vertices_.data.size());
+    slot.vertex_count = static_cast<UnsignedInt>(geometry.vertices.size());
+    slot.first_index = static_cast<UnsignedInt>(indices_.data.size());
+    slot.index_count = static_cast<UnsignedInt>(geometry.indices.size());
+    slot.used = true;
+
+    vertices_.data.insert(vertices_.data.end(), geometry.vertices.begin(), geometry.vertices.end());
+    indices_.data.insert(indices_.data.end(), geometry.indices.begin(), geometry.indices.end());
+    vertices_.changed = indices_.changed = true;
+
+    set_uniforms(slot_index, uniforms);
+    return slot_index;
+}
+
+void MeshBatch::remove(std::size_t slot_index) {
+    Slot& slot = slots_[slot_index];
+    num_unused_vertices_ += slot.vertex_count;
+    slot = {};
+    free_slots_.emplace_back(slot_index);
+
+    if (num_unused_vertices_ > vertices_.data.size() / 2u) {
+        compact();
+    }
+}
+
+void MeshBatch::set_uniforms(std::size_t slot_index, const ItemUniforms& uniforms) {
+    items_.data[slot_index] = uniforms;
+    items_.changed = true;
+}
+
+void MeshBatch::queue_draw(std::size_t slot_index) {
+    const Slot& slot = slots_[slot_index];
+    commands_.push_back({slot.index_count,
+                         1u,
+                         slot.first_index,
+                         static_cast<Int>(slot.first_vertex),
+                         static_cast<UnsignedInt>(slot_index)});
+}
+
+void MeshBatch::draw() {
+    if (commands_.empty()) {
+        return;
+    }
+
+    vertices_.upload();
+    indices_.upload();
+    items_.upload();
+    item_indices_.upload();
+
+    command_buffer_.setData(Containers::ArrayView<const void>(commands_.data(), commands_.size() * sizeof(DrawCommand)),
+                            GL::BufferUsage::StreamDraw);
+
+    items_.buffer.bind(GL::Buffer::Target::ShaderStorage, GeneralShader3D::batched_items_binding);
+
+    // Magnum doesn't wrap indirect draws so OpenGL is called directly and Magnum's state tracking is reset
+    GL::Context::current().resetState(GL::Context::State::EnterExternal);
+
+    glUseProgram(shader_.id());
+    glBindVertexArray(mesh_.id());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_.id());
+    glMultiDrawElementsIndirect(
+        static_cast<GLenum>(primitive_), GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands_.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+
+    GL::Context::current().resetState(GL::Context::State::ExitExternal);
+
+    commands_.clear();
+}
+
+std::size_t MeshBatch::size() const {
+    return slots_.size() - free_slots_.size();
+}
+
+template <typename T>
+void MeshBatch::SharedBuffer<T>::upload() {
+    if (not changed) {
+        return;
+    }
+
+    std::size_t num_bytes = data.size() * sizeof(T);
+
+    if (num_bytes > capacity) {
+        capacity = util::grown_capacity(capacity, num_bytes);
+        buffer.setData({nullptr, capacity}, GL::BufferUsage::DynamicDraw);
+        changes.clear(); // The old contents are gone
+    }
+
+    const char* bytes = reinterpret_cast<const char*>(data.data());
+
+    for (const util::ByteRange& range : changes.update(bytes, num_bytes)) {
+        buffer.setSubData(static_cast<GLintptr>(range.offset),
+                          Containers::ArrayView<const void>(bytes + range.offset, range.size));
+    }
+    changed = false;
+}
+
+void MeshBatch::compact() {
+    std::vector<BatchVertex> vertices;
+    std::vector<UnsignedInt> indices;
+    vertices.reserve(vertices_.data.size() - num_unused_vertices_);
+
+    for (Slot& slot : slots_) {
+        if (not slot.used) {
+            continue;
+        }
+
+        auto first_vertex = vertices_.data.begin() + static_cast<std::ptrdiff_t>(slot.first_vertex);
+        auto first_index = indices_.data.begin() + static_cast<std::ptrdiff_t>(slot.first_index);
+
+        slot.first_vertex = static_cast<UnsignedInt>(vertices.size());
+        slot.first_index = static_cast<UnsignedInt>(indices.size());
+
+        vertices.insert(vertices.end(), first_vertex, first_vertex + static_cast<std::ptrdiff_t>(slot.vertex_count));
+        indices.insert(indices.end(), first_index, first_index + static_cast<std::ptrdiff_t>(slot.index_count));
+    }
+
+    vertices_.data = std::move(vertices);
+    indices_.data = std::move(indices);
+    vertices_.changed = indices_.changed = true;
+    num_unused_vertices_ = 0;
+}
+
+} // namespace gvs::vis
@@ -0,0 +1,115 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "gvs/util/buffer_change_tracker.hpp"
+#include "gvs/vis-client/scene/general_shader_3d.hpp"
+#include "gvs/vis-client/scene/prepared_geometry.hpp"
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+
+#include <vector>
+
+namespace gvs::vis {
+
+/**
+ * @brief Small items that share a primitive and shading mode, merged into shared buffers and drawn
+ *        with a single 'glMultiDrawElementsIndirect' call.
+ *
+ * Each item gets a slot. Its vertices and indices are appended to the shared buffers and its
+ * uniforms are stored at the slot's index in a shader storage buffer, which the batched shader
+ * finds with the draw's base instance. Removing an item leaves a hole that is reclaimed when the
+ * shared buffers get too sparse. Only the parts of the buffers that changed are uploaded.
+ */
+class MeshBatch {
+public:
+    explicit MeshBatch(Magnum::GL::MeshPrimitive primitive, GeneralShader3D& batched_shader);
+
+    /// \brief Adds the item and returns its slot
+    std::size_t add(const BatchGeometry& geometry, const ItemUniforms& uniforms);
+    void remove(std::size_t slot);
+
+    void set_uniforms(std::size_t slot, const ItemUniforms& uniforms);
+
+    /// \brief Includes the item in the next call to 'draw'
+    void queue_draw(std::size_t slot);
+
+    /// \brief Uploads any changes and draws every queued item with one call
+    void draw();
+
+    /// \brief The number of items in the batch
+    std::size_t size() const;
+
+private:
+    struct Slot {
+        Magnum::UnsignedInt first_vertex = 0;
+        Magnum::UnsignedInt vertex_count = 0;
+        Magnum::UnsignedInt first_index = 0;
+        Magnum::UnsignedInt index_count = 0;
+        bool used = false;
+    };
+
+    /// Matches 'DrawElementsIndirectCommand' in the OpenGL spec
+    struct DrawCommand {
+        Magnum::UnsignedInt count;
+        Magnum::UnsignedInt instance_count;
+        Magnum::UnsignedInt first_index;
+        Magnum::Int base_vertex;
+        Magnum::UnsignedInt base_instance;
+    };
+
+    /// A CPU copy of a GPU buffer and the parts of it that have already been uploaded
+    template <typename T>
+    struct SharedBuffer {
+        std::vector<T> data;
+        Magnum::GL::Buffer buffer;
+        std::size_t capacity = 0; ///< bytes allocated for 'buffer'
+        util::BufferChangeTracker changes;
+        bool changed = false;
+
+        void upload();
+    };
+
+    Magnum::GL::MeshPrimitive primitive_;
+    GeneralShader3D& shader_;
+
+    std::vector<Slot> slots_;
+    std::vector<std::size_t> free_slots_;
+    std::size_t num_unused_vertices_ = 0; ///< vertices of removed items that haven't been compacted yet
+
+    SharedBuffer<BatchVertex> vertices_;
+    SharedBuffer<Magnum::UnsignedInt> indices_;
+    SharedBuffer<ItemUniforms> items_;
+    SharedBuffer<Magnum::UnsignedInt> item_indices_; ///< 0, 1, 2... read once per draw with the base instance
+
+    std::vector<DrawCommand> commands_;
+    Magnum::GL::Buffer command_buffer_;
+
+    Magnum::GL::Mesh mesh_;
+
+    /// \brief Removes the geometry of removed items from the shared buffers
+    void compact();
+};
+
+} // namespace gvs::vis
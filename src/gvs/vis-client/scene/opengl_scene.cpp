@@ -22,21 +22,27 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #include "opengl_scene.hpp"
 
-#include "gvs/util/container_util.hpp"
+#include "gvs/util/attribute_view.hpp"
+#include "gvs/util/scene_update.hpp"
+#include "gvs/util/vertex_layout.hpp"
 #include "gvs/vis-client/scene/drawables.hpp"
 
 #include <gvs/gvs_paths.hpp>
 
 #include <Corrade/Containers/ArrayViewStl.h>
+#include <Magnum/GL/Attribute.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/Renderer.h>
-#include <Magnum/MeshTools/CompressIndices.h>
 #include <Magnum/MeshTools/Interleave.h>
 #include <Magnum/Primitives/Cube.h>
 #include <Magnum/SceneGraph/Camera.h>
 #include <Magnum/Trade/MeshData3D.h>
 #include <imgui.h>
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 namespace gvs::vis {
 
 namespace {
@@ -65,6 +71,39 @@ Magnum::MeshPrimitive from_proto(gvs::proto::GeometryFormat format) {
     throw std::invalid_argument("Invalid GeometryFormat enum provided");
 }
 
+/// \brief Describes an interleaved attribute to OpenGL. The layout has already been validated by the server.
+Magnum::GL::DynamicAttribute dynamic_attribute(const proto::VertexAttributeLayout& layout) {
+    Magnum::UnsignedInt location = 0;
+
+    switch (layout.attribute()) {
+    case proto::ATTRIBUTE_POSITION:
+        location = GeneralShader3D::Position::Location;
+        break;
+    case proto::ATTRIBUTE_NORMAL:
+        location = GeneralShader3D::Normal::Location;
+        break;
+    case proto::ATTRIBUTE_TEX_COORD:
+        location = GeneralShader3D::TextureCoordinate::Location;
+        break;
+    case proto::ATTRIBUTE_VERTEX_COLOR:
+        location = GeneralShader3D::VertexColor::Location;
+        break;
+
+    /* Safe to ignore */
+    case proto::VertexAttribute_INT_MIN_SENTINEL_DO_NOT_USE_:
+    case proto::VertexAttribute_INT_MAX_SENTINEL_DO_NOT_USE_:
+        break;
+    }
+
+    using Attribute = Magnum::GL::DynamicAttribute;
+    auto components = Attribute::Components(util::component_count(layout.attribute()));
+
+    if (layout.type() == proto::UNORM8) {
+        return Attribute{Attribute::Kind::GenericNormalized, location, components, Attribute::DataType::UnsignedByte};
+    }
+    return Attribute{Attribute::Kind::Generic, location, components, Attribute::DataType::Float};
+}
+
 } // namespace
 
 using namespace Magnum;
@@ -72,10 +111,11 @@ using namespace Math::Literals;
 
 OpenGLScene::ObjectMeshPackage::ObjectMeshPackage(Object3D* obj,
                                                   Magnum::SceneGraph::DrawableGroup3D* drawables,
-                                                  GeneralShader3D& shader)
+                                                  GeneralShader3D& shader,
+                                                  GeneralShader3D& instanced_shader)
     : object(obj) {
     mesh.setCount(0).setPrimitive(Magnum::MeshPrimitive::Points);
-    drawable = new OpaqueDrawable(*object, drawables, mesh, shader);
+    drawable = new OpaqueDrawable(*object, drawables, mesh, shader, instanced_shader);
 }
 
 OpenGLScene::OpenGLScene(const SceneInitializationInfo& /*initialization_info*/) {
@@ -86,130 +126,583 @@ OpenGLScene::OpenGLScene(const SceneInitializationInfo& /*initialization_info*/)
     GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
 
-    shader_.set_uniform_color({1.f, 0.5f, 0.1f});
-
-    reset({});
+    reset({}, {});
 }
 
-void OpenGLScene::update(const Vector2i& /*viewport*/) {}
+void OpenGLScene::update(const Vector2i& /*viewport*/) {
+    ++frame_;
+
+    while (not batch_candidates_.empty() and frame_ - batch_candidates_.front().second >= frames_until_static) {
+        const auto& candidate = batch_candidates_.front();
+        auto iter = objects_.find(candidate.first);
+
+        // Skip items that were removed or changed again (they are further back in the queue)
+        if (iter != objects_.end() and iter->second->geometry_frame == candidate.second) {
+            add_to_batch(iter->second.get());
+        }
+        batch_candidates_.pop_front();
+    }
+}
 
 void OpenGLScene::render(const CameraPackage& camera_package) {
     camera_object_.setTransformation(camera_package.transformation);
     camera_->setProjectionMatrix(camera_package.camera->projectionMatrix());
-    camera_->draw(drawables_);
+    camera_->setViewport(camera_package.camera->viewport()); // point clouds pick their detail in pixels
+
+    // Items outside the view are skipped before any uniforms are set
+    collect_visible(drawables_, *camera_, &visible_drawables_);
+
+    // Computed once here instead of in every draw
+    FrameUniforms frame{camera_->projectionMatrix() * camera_->cameraMatrix()};
+    frame_uniforms_.setData(Containers::ArrayView<const void>(&frame, sizeof(FrameUniforms)),
+                            GL::BufferUsage::DynamicDraw);
+    shader_.bind_frame_uniforms(frame_uniforms_);
+
+    // Draws that need the same state end up next to each other
+    std::sort(visible_drawables_.begin(), visible_drawables_.end(), [](const auto& lhs, const auto& rhs) {
+        return static_cast<const OpaqueDrawable&>(lhs.first.get()).sort_key()
+            < static_cast<const OpaqueDrawable&>(rhs.first.get()).sort_key();
+    });
+
+    // Batched items are only queued here
+    point_cloud_stats_ = {};
+    camera_->draw(visible_drawables_);
+
+    for (auto& batch : batches_) {
+        batch.second->draw();
+    }
 }
 
 void OpenGLScene::configure_gui(const Vector2i& /*viewport*/) {
-    ImGui::TextColored({1.f, 1.f, 0.f, 1.f}, "TODO: Display Scene Items");
+    if (ImGui::TreeNode("Point Clouds")) {
+        int budget_thousands = static_cast<int>(point_cloud_settings_.point_budget / 1000u);
+        if (ImGui::SliderInt("Point budget (thousands)", &budget_thousands, 100, 20000)) {
+            point_cloud_settings_.point_budget = static_cast<std::size_t>(budget_thousands) * 1000u;
+        }
+
+        ImGui::SliderFloat("Min pixel spacing", &point_cloud_settings_.min_pixel_spacing, 0.5f, 10.f);
+
+        ImGui::Text("Points drawn: %zu", point_cloud_stats_.points_drawn);
+        ImGui::Text("Nodes drawn:  %zu", point_cloud_stats_.nodes_drawn);
+        ImGui::Text("Nodes loading: %zu", point_cloud_stats_.nodes_missing);
+
+        ImGui::TreePop();
+    }
+
+    if (reveal_selection_) {
+        ImGui::SetNextItemOpen(true);
+        reveal_selection_ = false;
+    }
+
+    if (ImGui::TreeNode("Scene Items")) {
+        item_browser_.configure_gui(300.f);
+        configure_selected_gui();
+        ImGui::TreePop();
+    }
 }
 
-void OpenGLScene::reset(const proto::SceneItems& items) {
+void OpenGLScene::reset(const proto::SceneItems& items, const PreparedGeometries& prepared) {
     // Remove all items from the scene
     if (root_object_) {
         scene_.children().erase(root_object_);
     }
     objects_.clear();
+    objects_by_handle_.clear();
+    batches_.clear();
+    batch_candidates_.clear();
+    item_browser_.clear();
+    pick_tree_.clear();
+    picked_id_.clear();
+    bvh_builder_.cancel_all();
 
     // Add root
     root_object_ = &scene_.addChild<Object3D>();
-    objects_.emplace("", std::make_unique<ObjectMeshPackage>(root_object_, &drawables_, shader_));
+    objects_.emplace("", std::make_unique<ObjectMeshPackage>(root_object_, &drawables_, shader_, instanced_shader_));
 
     for (const auto& item : items.items()) {
-        objects_.emplace(item.first,
-                         std::make_unique<ObjectMeshPackage>(&scene_.addChild<Object3D>(), &drawables_, shader_));
+        add_object(item.second.id());
     }
 
     // Add new items to scene
     for (const auto& item : items.items()) {
-        update_item(item.second);
+        update_item(item.second, prepared);
     }
 }
 
-void OpenGLScene::add_item(const proto::SceneItemInfo& info) {
+void OpenGLScene::add_item(const proto::SceneItemInfo& info, const PreparedGeometries& prepared) {
     assert(info.has_geometry_info());
 
-    objects_.emplace(info.id().value(),
-                     std::make_unique<ObjectMeshPackage>(&scene_.addChild<Object3D>(), &drawables_, shader_));
-    update_item(info);
+    add_object(info.id());
+    update_item(info, prepared);
 }
 
-void OpenGLScene::update_item(const proto::SceneItemInfo& info) {
-
-    ObjectMeshPackage& mesh_package = *objects_.at(info.id().value());
+void OpenGLScene::update_item(const proto::SceneItemInfo& info, const PreparedGeometries& prepared) {
 
-    // TODO: Make it so individual parts of the geometry can be updated
-    if (info.has_geometry_info()) {
-        const proto::GeometryInfo3D& geometry = info.geometry_info();
+    ObjectMeshPackage* object = find_object(info.id());
 
-        std::vector<float> buffer_data;
-        GLintptr offset = 0;
-        mesh_package.mesh.setCount(0);
+    if (not object) {
+        throw std::invalid_argument("Item '" + info.id().value() + "' not found in scene");
+    }
+    ObjectMeshPackage& mesh_package = *object;
 
-        if (geometry.has_positions()) {
-            const proto::FloatList& positions = geometry.positions();
-            buffer_data.insert(buffer_data.end(), positions.value().begin(), positions.value().end());
-            mesh_package.mesh.setCount(positions.value_size() / 3);
-            mesh_package.mesh.addVertexBuffer(mesh_package.vertex_buffer, offset, GeneralShader3D::Position{});
-            offset += positions.value_size() * static_cast<int>(sizeof(float));
-        }
+    PreparedGeometry prepared_here;
+    const PreparedGeometry* new_geometry = nullptr;
 
-        if (geometry.has_normals()) {
-            const proto::FloatList& normals = geometry.normals();
-            buffer_data.insert(buffer_data.end(), normals.value().begin(), normals.value().end());
-            mesh_package.mesh.addVertexBuffer(mesh_package.vertex_buffer, offset, GeneralShader3D::Normal{});
-            offset += normals.value_size() * static_cast<int>(sizeof(float));
-        }
+    if (info.has_geometry_info()) {
+        const proto::GeometryInfo3D& geometry = info.geometry_info();
+        auto iter = prepared.find(&geometry);
 
-        if (geometry.has_tex_coords()) {
-            const proto::FloatList& tex_coords = geometry.tex_coords();
-            buffer_data.insert(buffer_data.end(), tex_coords.value().begin(), tex_coords.value().end());
-            mesh_package.mesh.addVertexBuffer(mesh_package.vertex_buffer, offset, GeneralShader3D::TextureCoordinate{});
-            offset += tex_coords.value_size() * static_cast<int>(sizeof(float));
+        if (iter == prepared.end()) {
+            prepared_here = prepare_geometry(geometry);
         }
-
-        if (geometry.has_vertex_colors()) {
-            const proto::FloatList& vertex_colors = geometry.vertex_colors();
-            buffer_data.insert(buffer_data.end(), vertex_colors.value().begin(), vertex_colors.value().end());
-            mesh_package.mesh.addVertexBuffer(mesh_package.vertex_buffer, offset, GeneralShader3D::VertexColor{});
+        new_geometry = (iter != prepared.end() ? &iter->second : &prepared_here);
+        const PreparedGeometry& prepared_geometry = *new_geometry;
+
+        remove_from_batch(&mesh_package);
+
+        // Point clouds are drawn from their octree so the mesh is left alone
+        if (prepared_geometry.point_cloud) {
+            mesh_package.point_cloud = std::make_unique<PointCloud>(
+                prepared_geometry.point_cloud, point_cloud_settings_, &point_cloud_stats_);
+            mesh_package.drawable->set_local_bounds(prepared_geometry.local_bounds);
+        } else {
+            mesh_package.point_cloud = nullptr;
+            update_geometry(&mesh_package, geometry, prepared_geometry);
         }
+        mesh_package.drawable->set_point_cloud(mesh_package.point_cloud.get());
 
-        mesh_package.vertex_buffer.setData(buffer_data, GL::BufferUsage::StaticDraw);
+        mesh_package.batch_geometry = prepared_geometry.batch_geometry;
+        mesh_package.geometry_frame = frame_;
 
-        if (info.geometry_info().has_indices() and info.geometry_info().indices().value_size() > 0) {
-            std::vector<unsigned> indices{info.geometry_info().indices().value().begin(),
-                                          info.geometry_info().indices().value().end()};
-
-            Containers::Array<char> index_data;
-            MeshIndexType index_type;
-            UnsignedInt index_start, index_end;
-            std::tie(index_data, index_type, index_start, index_end) = MeshTools::compressIndices(indices);
-            mesh_package.index_buffer.setData(index_data, GL::BufferUsage::StaticDraw);
-
-            mesh_package.mesh.setCount(static_cast<int>(indices.size()))
-                .setIndexBuffer(mesh_package.index_buffer, 0, index_type, index_start, index_end);
+        if (not mesh_package.batch_geometry.vertices.empty()) {
+            batch_candidates_.emplace_back(info.id().value(), frame_);
         }
     }
 
+    bool batch_changed = false;
+
     if (info.has_display_info()) {
         const proto::DisplayInfo& display = info.display_info();
 
         if (display.has_geometry_format()) {
             mesh_package.mesh.setPrimitive(from_proto(display.geometry_format().value()));
         }
+        batch_changed = (display.has_geometry_format() or display.has_shading());
     }
 
-    if (not util::has_key(objects_, info.parent().value())) {
+    if (new_geometry) {
+        update_triangle_bvh(&mesh_package, *new_geometry);
+    }
+
+    ObjectMeshPackage* parent = find_object(info.parent());
+
+    if (not parent) {
+        if (find_by_handle(mesh_package.handle)) {
+            objects_by_handle_[util::handle_slot(mesh_package.handle)] = nullptr;
+        }
+        remove_from_batch(&mesh_package);
+        item_browser_.remove_item(info.id().value());
+        if (mesh_package.pick_proxy != PickTree::null_proxy) {
+            pick_tree_.remove(mesh_package.pick_proxy);
+        }
+        bvh_builder_.cancel(info.id().value());
         objects_.erase(info.id().value());
         throw std::invalid_argument("Parent id '" + info.parent().value() + "' not found in scene");
     }
 
-    mesh_package.object->setParent(objects_.at(info.parent().value())->object);
+    mesh_package.object->setParent(parent->object);
+    item_browser_.set_parent(info.id().value(), info.parent().value());
 
     if (info.has_display_info()) {
         mesh_package.drawable->update_display_info(info.display_info());
+
+        if (info.display_info().has_readable_id()) {
+            item_browser_.set_readable_id(info.id().value(), info.display_info().readable_id().value());
+        }
+    }
+
+    // Move the item to the batch that matches its new primitive or shading
+    if (batch_changed and mesh_package.drawable->batch()) {
+        remove_from_batch(&mesh_package);
+        add_to_batch(&mesh_package);
+    }
+}
+
+void OpenGLScene::update_transforms(const proto::TransformBatch& batch) {
+    if (not util::transform_batch_error(batch).empty()) {
+        return;
+    }
+
+    const float* transformation = batch.transformations().data();
+
+    for (std::uint32_t handle : batch.handles()) {
+        if (ObjectMeshPackage* package = find_by_handle(handle)) {
+            Matrix4 transform{};
+            std::copy(transformation, transformation + util::transform_size, transform.data());
+            package->object->setTransformation(transform);
+        }
+        transformation += util::transform_size;
     }
 }
 
 void OpenGLScene::resize(const Vector2i& /*viewport*/) {}
 
+void OpenGLScene::pick(const Ray& world_ray) {
+    update_pick_tree();
+
+    util::Vec3f origin = {world_ray.origin.x(), world_ray.origin.y(), world_ray.origin.z()};
+    util::Vec3f direction = {world_ray.direction.x(), world_ray.direction.y(), world_ray.direction.z()};
+
+    const ObjectMeshPackage* closest = nullptr;
+    float closest_distance = std::numeric_limits<float>::infinity();
+    bool closest_triangles = false;
+
+    // The tree skips every item whose bounds start beyond the closest hit found so far
+    pick_tree_.raycast(origin, direction, closest_distance, [&](PickTree::ProxyId proxy, float /*entry_distance*/) {
+        const ObjectMeshPackage* package = pick_tree_.data(proxy);
+
+        bool hit_triangles = false;
+        float distance = pick_distance(*package, world_ray, closest_distance, &hit_triangles);
+
+        if (distance < closest_distance) {
+            closest = package;
+            closest_distance = distance;
+            closest_triangles = hit_triangles;
+        }
+        return closest_distance;
+    });
+
+    picked_id_ = (closest ? closest->id : "");
+    picked_distance_ = closest_distance;
+    picked_triangles_ = closest_triangles;
+
+    item_browser_.select(picked_id_);
+    reveal_selection_ = (closest != nullptr);
+}
+
+bool OpenGLScene::refining() const {
+    return point_cloud_stats_.nodes_missing > 0u;
+}
+
+void OpenGLScene::update_geometry(ObjectMeshPackage* package,
+                                  const proto::GeometryInfo3D& geometry,
+                                  const PreparedGeometry& prepared) {
+    const proto::InterleavedVertices& interleaved = geometry.interleaved_vertices();
+
+    // Data is uploaded straight from the proto (raw bytes are used in place)
+    VertexBlocks blocks = vertex_blocks(geometry);
+
+    util::AttributeView<unsigned> indices = util::attribute_view(geometry.indices());
+
+    proto::InterleavedVertices layout;
+    layout.set_stride(interleaved.stride());
+    *layout.mutable_attributes() = interleaved.attributes();
+    std::string interleaved_layout = layout.SerializeAsString();
+
+    bool layout_changed = (interleaved_layout != package->interleaved_layout or indices.empty() == package->indexed);
+
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        layout_changed |= (blocks[i].size() != package->vertex_ranges[i].size);
+    }
+
+    if (layout_changed) {
+        // Start with a fresh mesh so attributes or indices that were removed don't stay bound
+        auto primitive = package->mesh.primitive();
+        package->mesh = GL::Mesh{};
+        package->mesh.setPrimitive(primitive);
+
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            ObjectMeshPackage::AttributeRange& range = package->vertex_ranges[i];
+            range.offset = offset;
+            range.size = blocks[i].size();
+            range.changes.clear();
+            offset += range.size;
+        }
+
+        package->interleaved_layout = std::move(interleaved_layout);
+        package->indexed = not indices.empty();
+        package->index_changes.clear();
+    }
+
+    /*
+     * Vertices
+     */
+    const ObjectMeshPackage::AttributeRange& last_range = package->vertex_ranges.back();
+    std::size_t vertex_bytes = last_range.offset + last_range.size;
+
+    if (vertex_bytes > package->vertex_capacity) {
+        package->vertex_capacity = util::grown_capacity(package->vertex_capacity, vertex_bytes);
+        package->vertex_buffer.setData({nullptr, package->vertex_capacity}, GL::BufferUsage::DynamicDraw);
+
+        // The old contents are gone
+        for (ObjectMeshPackage::AttributeRange& range : package->vertex_ranges) {
+            range.changes.clear();
+        }
+    }
+
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        ObjectMeshPackage::AttributeRange& range = package->vertex_ranges[i];
+
+        for (const util::ByteRange& changed : range.changes.update(prepared.block_hashes[i], blocks[i].size())) {
+            package->vertex_buffer.setSubData(static_cast<GLintptr>(range.offset + changed.offset),
+                                              blocks[i].slice(changed.offset, changed.offset + changed.size));
+        }
+    }
+
+    if (layout_changed) {
+        auto vertex_offset = [&](std::size_t block) {
+            return static_cast<GLintptr>(package->vertex_ranges[block].offset);
+        };
+
+        for (const proto::VertexAttributeLayout& attribute : interleaved.attributes()) {
+            package->mesh.addVertexBuffer(package->vertex_buffer,
+                                          vertex_offset(0) + static_cast<GLintptr>(attribute.offset()),
+                                          static_cast<GLsizei>(interleaved.stride()),
+                                          dynamic_attribute(attribute));
+        }
+
+        auto add_separate = [&](std::size_t block, auto shader_attribute) {
+            if (not blocks[block].empty()) {
+                package->mesh.addVertexBuffer(package->vertex_buffer, vertex_offset(block), shader_attribute);
+            }
+        };
+
+        add_separate(1, GeneralShader3D::Position{});
+        add_separate(2, GeneralShader3D::Normal{});
+        add_separate(3, GeneralShader3D::TextureCoordinate{});
+        add_separate(4, GeneralShader3D::VertexColor{});
+
+        // Instance data advances once per instance instead of once per vertex
+        auto add_instanced = [&](std::size_t block, auto shader_attribute) {
+            if (not blocks[block].empty()) {
+                package->mesh.addVertexBufferInstanced(
+                    package->vertex_buffer, 1, vertex_offset(block), shader_attribute);
+            }
+        };
+
+        add_instanced(5, GeneralShader3D::InstanceTransformation{});
+        add_instanced(6, GeneralShader3D::InstanceColor{});
+    }
+
+    if (util::find_attribute(interleaved, proto::ATTRIBUTE_POSITION)) {
+        package->vertex_count = static_cast<int>(util::vertex_count(interleaved));
+    } else {
+        package->vertex_count = static_cast<int>(blocks[1].size() / (3u * sizeof(float)));
+    }
+
+    /*
+     * Indices (compressed ahead of time and only uploaded when they change)
+     */
+    if (package->indexed) {
+        auto index_bytes = indices.size() * sizeof(unsigned);
+
+        if (not package->index_changes.update(prepared.index_hashes, index_bytes).empty()) {
+            Containers::ArrayView<const void> index_data(prepared.index_data.data(), prepared.index_data.size());
+
+            if (index_data.size() > package->index_capacity) {
+                package->index_capacity = util::grown_capacity(package->index_capacity, index_data.size());
+                package->index_buffer.setData({nullptr, package->index_capacity}, GL::BufferUsage::DynamicDraw);
+            }
+            package->index_buffer.setSubData(0, index_data);
+
+            package->mesh.setIndexBuffer(
+                package->index_buffer, 0, prepared.index_type, prepared.index_start, prepared.index_end);
+        }
+        package->index_count = static_cast<int>(indices.size());
+    }
+
+    package->mesh.setCount(package->indexed ? package->index_count : package->vertex_count);
+
+    // Every instance is drawn with a single call
+    std::size_t instance_count = util::instance_count(geometry);
+    package->mesh.setInstanceCount(instance_count > 0u ? static_cast<Int>(instance_count) : 1);
+    package->drawable->set_instanced(instance_count > 0u, not blocks[6].empty());
+
+    package->drawable->set_local_bounds(prepared.local_bounds);
+}
+
+void OpenGLScene::add_object(const proto::ID& id) {
+    auto package = std::make_unique<ObjectMeshPackage>(
+        &scene_.addChild<Object3D>(), &drawables_, shader_, instanced_shader_);
+
+    if (id.handle() != 0u) {
+        std::uint32_t slot = util::handle_slot(id.handle());
+        if (slot >= objects_by_handle_.size()) {
+            objects_by_handle_.resize(slot + 1u, nullptr);
+        }
+        objects_by_handle_[slot] = package.get();
+    }
+
+    package->id = id.value();
+    package->handle = id.handle();
+    objects_.emplace(id.value(), std::move(package));
+    item_browser_.add_item(id.value());
+}
+
+void OpenGLScene::add_to_batch(ObjectMeshPackage* package) {
+    if (package->drawable->batch() or package->batch_geometry.vertices.empty()) {
+        return;
+    }
+
+    BatchKey key = {package->mesh.primitive(), package->drawable->uniforms().shading};
+    std::unique_ptr<MeshBatch>& batch = batches_[key];
+
+    if (not batch) {
+        batch = std::make_unique<MeshBatch>(key.first, batched_shader_);
+    }
+
+    std::size_t slot = batch->add(package->batch_geometry, package->drawable->uniforms());
+    package->drawable->set_batch(batch.get(), slot);
+}
+
+void OpenGLScene::remove_from_batch(ObjectMeshPackage* package) {
+    if (MeshBatch* batch = package->drawable->batch()) {
+        batch->remove(package->drawable->batch_slot());
+        package->drawable->set_batch(nullptr, 0);
+    }
+}
+
+void OpenGLScene::update_pick_tree() {
+    for (auto& id_and_package : objects_) {
+        ObjectMeshPackage& package = *id_and_package.second;
+
+        // Only recomputes the bounds if the object moved since they were last used
+        package.object->setClean();
+        const util::Aabb& bounds = package.drawable->world_bounds();
+
+        if (bounds.empty()) {
+            if (package.pick_proxy != PickTree::null_proxy) {
+                pick_tree_.remove(package.pick_proxy);
+                package.pick_proxy = PickTree::null_proxy;
+            }
+        } else if (package.pick_proxy == PickTree::null_proxy) {
+            package.pick_proxy = pick_tree_.insert(bounds, &package);
+        } else {
+            pick_tree_.update(package.pick_proxy, bounds); // cheap unless the item left its fat bounds
+        }
+    }
+}
+
+void OpenGLScene::update_triangle_bvh(ObjectMeshPackage* package, const PreparedGeometry& prepared) {
+    package->triangle_bvh = {};
+
+    if (package->point_cloud or package->mesh.primitive() != GL::MeshPrimitive::Triangles) {
+        bvh_builder_.cancel(package->id);
+
+    } else if (prepared.triangle_bvh) {
+        bvh_builder_.cancel(package->id);
+        package->triangle_bvh = TriangleBvhBuilder::ready(prepared.triangle_bvh);
+
+    } else if (prepared.triangle_mesh) {
+        package->triangle_bvh = bvh_builder_.build(package->id, prepared.triangle_mesh); // replaces a waiting build
+
+    } else {
+        bvh_builder_.cancel(package->id);
+    }
+}
+
+float OpenGLScene::pick_distance(const ObjectMeshPackage& package,
+                                 const Ray& world_ray,
+                                 float max_distance,
+                                 bool* hit_triangles) {
+    util::Vec3f origin = {world_ray.origin.x(), world_ray.origin.y(), world_ray.origin.z()};
+    util::Vec3f inverse_direction
+        = {1.f / world_ray.direction.x(), 1.f / world_ray.direction.y(), 1.f / world_ray.direction.z()};
+
+    float bounds_distance
+        = util::ray_entry_distance(package.drawable->world_bounds(), origin, inverse_direction, max_distance);
+
+    if (bounds_distance > max_distance) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    // The BVH is only used once it's done so picking never waits on a large mesh
+    bool use_triangles = not package.point_cloud and package.mesh.primitive() == GL::MeshPrimitive::Triangles
+        and package.triangle_bvh.valid()
+        and package.triangle_bvh.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+
+    if (use_triangles and package.triangle_bvh.get()) {
+        // The ray keeps the same parameterization in local space so distances are still world distances
+        Matrix4 local_from_world = package.drawable->world_from_local().inverted();
+        Vector3 local_origin = local_from_world.transformPoint(world_ray.origin);
+        Vector3 local_direction = local_from_world.transformVector(world_ray.direction);
+
+        *hit_triangles = true;
+        return package.triangle_bvh.get()->raycast({local_origin.x(), local_origin.y(), local_origin.z()},
+                                                   {local_direction.x(), local_direction.y(), local_direction.z()},
+                                                   max_distance);
+    }
+
+    *hit_triangles = false;
+    return bounds_distance;
+}
+
+void OpenGLScene::configure_selected_gui() {
+    auto iter = objects_.find(item_browser_.selected());
+
+    if (item_browser_.selected().empty() or iter == objects_.end()) {
+        return;
+    }
+    const ObjectMeshPackage& package = *iter->second;
+
+    if (package.point_cloud) {
+        ImGui::Text("Geometry:    point cloud");
+    } else {
+        ImGui::Text("Vertices:    %d", package.vertex_count);
+        if (package.indexed) {
+            ImGui::Text("Indices:     %d", package.index_count);
+        }
+    }
+
+    const util::Aabb& bounds = package.drawable->world_bounds();
+    if (not bounds.empty()) {
+        auto vector_text = [](const char* label, const util::Vec3f& v) {
+            ImGui::Text("%s%.3f, %.3f, %.3f",
+                        label,
+                        static_cast<double>(v[0]),
+                        static_cast<double>(v[1]),
+                        static_cast<double>(v[2]));
+        };
+        vector_text("Bounds min:  ", bounds.min);
+        vector_text("Bounds max:  ", bounds.max);
+    }
+
+    if (not package.triangle_bvh.valid()) {
+        ImGui::Text("Picking:     bounds");
+    } else if (package.triangle_bvh.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        ImGui::Text("Picking:     building triangle BVH...");
+    } else if (const auto& bvh = package.triangle_bvh.get()) {
+        ImGui::Text("Picking:     %zu triangles", bvh->num_triangles());
+    } else {
+        ImGui::Text("Picking:     bounds (no triangle BVH)");
+    }
+
+    if (picked_id_ == item_browser_.selected()) {
+        ImGui::Text("Hit at:      %.3f (%s)",
+                    static_cast<double>(picked_distance_),
+                    picked_triangles_ ? "triangles" : "bounds");
+    }
+}
+
+OpenGLScene::ObjectMeshPackage* OpenGLScene::find_by_handle(std::uint32_t handle) {
+    std::uint32_t slot = util::handle_slot(handle);
+
+    // Slots are reused after the scene is cleared so the full handle has to match
+    if (slot != 0u and slot < objects_by_handle_.size() and objects_by_handle_[slot]
+        and objects_by_handle_[slot]->handle == handle) {
+        return objects_by_handle_[slot];
+    }
+    return nullptr;
+}
+
+OpenGLScene::ObjectMeshPackage* OpenGLScene::find_object(const proto::ID& id) {
+    if (ObjectMeshPackage* package = find_by_handle(id.handle())) {
+        return package;
+    }
+
+    auto iter = objects_.find(id.value());
+    return iter == objects_.end() ? nullptr : iter->second.get();
+}
+
 } // namespace gvs::vis
@@ -23,8 +23,14 @@
 #pragma once
 
 #include "gvs/forward_declarations.hpp"
+#include "gvs/util/buffer_change_tracker.hpp"
+#include "gvs/vis-client/scene/bounded_drawable.hpp"
 #include "gvs/vis-client/scene/general_shader_3d.hpp"
+#include "gvs/vis-client/scene/item_browser.hpp"
+#include "gvs/vis-client/scene/mesh_batch.hpp"
+#include "gvs/vis-client/scene/point_cloud.hpp"
 #include "gvs/vis-client/scene/scene_interface.hpp"
+#include "gvs/vis-client/scene/triangle_bvh_builder.hpp"
 
 #include <types.pb.h>
 
@@ -40,6 +46,10 @@
 #include <Magnum/SceneGraph/Scene.h>
 #include <Magnum/SceneGraph/SceneGraph.h>
 
+#include <array>
+#include <deque>
+#include <map>
+
 namespace gvs::vis {
 
 class OpenGLScene : public SceneInterface {
@@ -51,17 +61,25 @@ public:
     void render(const CameraPackage& camera_package) override;
     void configure_gui(const Magnum::Vector2i& viewport) override;
 
-    void add_item(const proto::SceneItemInfo& info) override;
-    void update_item(const proto::SceneItemInfo& info) override;
-    void reset(const proto::SceneItems& items) override;
+    void add_item(const proto::SceneItemInfo& info, const PreparedGeometries& prepared) override;
+    void update_item(const proto::SceneItemInfo& info, const PreparedGeometries& prepared) override;
+    void update_transforms(const proto::TransformBatch& batch) override;
+    void reset(const proto::SceneItems& items, const PreparedGeometries& prepared) override;
 
     void resize(const Magnum::Vector2i& viewport) override;
 
+    void pick(const Ray& world_ray) override;
+
+    bool refining() const override;
+
 private:
     using Scene3D = Magnum::SceneGraph::Scene<Magnum::SceneGraph::MatrixTransformation3D>;
     using Object3D = Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>;
 
     GeneralShader3D shader_;
+    GeneralShader3D batched_shader_{GeneralShader3D::Variant::Batched};
+    GeneralShader3D instanced_shader_{GeneralShader3D::Variant::Instanced};
+    Magnum::GL::Buffer frame_uniforms_; ///< 'FrameUniforms' shared by every draw
 
     struct ObjectMeshPackage {
         Magnum::GL::Buffer index_buffer;
@@ -70,17 +88,111 @@ private:
         Object3D* object = nullptr;
         OpaqueDrawable* drawable = nullptr;
 
+        /// Where each block of vertex data lives in 'vertex_buffer'
+        struct AttributeRange {
+            std::size_t offset = 0;
+            std::size_t size = 0;
+            util::BufferChangeTracker changes;
+        };
+
+        std::array<AttributeRange, num_vertex_blocks> vertex_ranges; ///< See 'vertex_blocks'
+        std::string interleaved_layout; ///< Serialized stride and attributes of the interleaved vertices
+        std::size_t vertex_capacity = 0; ///< Bytes allocated for 'vertex_buffer'
+        int vertex_count = 0;
+
+        util::BufferChangeTracker index_changes;
+        std::size_t index_capacity = 0; ///< Bytes allocated for 'index_buffer'
+        bool indexed = false;
+        int index_count = 0;
+
+        std::unique_ptr<PointCloud> point_cloud; ///< Drawn instead of 'mesh' if the item is a point cloud
+
+        BatchGeometry batch_geometry; ///< Empty unless the item is small enough to be batched
+        std::size_t geometry_frame = 0; ///< When the geometry last changed
+
+        std::string id;
+        std::uint32_t handle = 0; ///< Assigned by the server (zero if the item has no handle)
+        TriangleBvhFuture triangle_bvh; ///< Invalid if the item can only be picked by its bounds
+        util::AabbTree<ObjectMeshPackage*>::ProxyId pick_proxy = util::AabbTree<ObjectMeshPackage*>::null_proxy;
+
         explicit ObjectMeshPackage(Object3D* obj,
                                    Magnum::SceneGraph::DrawableGroup3D* drawables,
-                                   GeneralShader3D& shader);
+                                   GeneralShader3D& shader,
+                                   GeneralShader3D& instanced_shader);
     };
     std::unordered_map<std::string, std::unique_ptr<ObjectMeshPackage>> objects_; // TODO: make items deletable
+    std::vector<ObjectMeshPackage*> objects_by_handle_; ///< Indexed by the slot of server-assigned item handles
+
+    void add_object(const proto::ID& id);
+
+    /// \brief Uploads only the parts of the geometry that changed. Attributes are only re-bound
+    ///        (and the mesh recreated) when the layout of the vertex data changes.
+    static void update_geometry(ObjectMeshPackage* package,
+                                const proto::GeometryInfo3D& geometry,
+                                const PreparedGeometry& prepared);
+
+    /*
+     * Small items are merged into a 'MeshBatch' once their geometry hasn't changed for
+     * 'frames_until_static' frames. Items leave their batch when their geometry, primitive, or
+     * shading mode changes and rejoin later.
+     */
+    static constexpr std::size_t frames_until_static = 30;
+    std::size_t frame_ = 0;
+
+    using BatchKey = std::pair<Magnum::GL::MeshPrimitive, Magnum::Int>; ///< (primitive, shading)
+    std::map<BatchKey, std::unique_ptr<MeshBatch>> batches_;
+    std::deque<std::pair<std::string, std::size_t>> batch_candidates_; ///< (item id, geometry frame)
+
+    PointCloudSettings point_cloud_settings_;
+    PointCloudStats point_cloud_stats_; ///< Reset every frame
+
+    ItemBrowser item_browser_;
+    bool reveal_selection_ = false; ///< Opens the item browser on the next frame
+
+    /*
+     * Picking first finds the items whose world bounds are hit using 'pick_tree_', then tests
+     * the triangles of each candidate (nearest first) with its BVH. Small BVHs are built when the
+     * geometry is prepared and large ones by 'bvh_builder_'. Items that aren't triangles, or whose
+     * BVH is still building, are hit at their bounds. BVHs are only built when new geometry
+     * arrives, so an item that switches to triangles later is also picked by its bounds.
+     */
+    using PickTree = util::AabbTree<ObjectMeshPackage*>;
+    PickTree pick_tree_; ///< Only brought up to date with the items' transforms when picking
+    TriangleBvhBuilder bvh_builder_;
+
+    std::string picked_id_;
+    float picked_distance_ = 0.f;
+    bool picked_triangles_ = false; ///< False if the item was picked by its bounds
+
+    void update_pick_tree();
+
+    /// \brief Uses or starts building the BVH for the item's new geometry. Call after its primitive is set.
+    void update_triangle_bvh(ObjectMeshPackage* package, const PreparedGeometry& prepared);
+
+    /// \brief Distance along the ray to the item (see 'pick_tree_'), or infinity if it is missed
+    static float pick_distance(const ObjectMeshPackage& package,
+                               const Ray& world_ray,
+                               float max_distance,
+                               bool* hit_triangles);
+
+    /// \brief Geometry details of the item selected in 'item_browser_'
+    void configure_selected_gui();
+
+    void add_to_batch(ObjectMeshPackage* package);
+    static void remove_from_batch(ObjectMeshPackage* package);
+
+    /// \brief Returns null if no current object has the handle
+    ObjectMeshPackage* find_by_handle(std::uint32_t handle);
+
+    /// \brief Looks the object up by handle if possible, otherwise by string id. Returns null if it doesn't exist.
+    ObjectMeshPackage* find_object(const proto::ID& id);
 
     Scene3D scene_;
     Object3D* root_object_ = nullptr;
     Object3D camera_object_;
     Magnum::SceneGraph::Camera3D* camera_;
     Magnum::SceneGraph::DrawableGroup3D drawables_;
+    DrawableTransformations visible_drawables_; ///< Reused every frame to avoid allocations
 };
 
 } // namespace gvs::vis
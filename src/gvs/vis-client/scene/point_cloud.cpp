@@ -0,0 +1,145 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "point_cloud.hpp"
+
+#include "gvs/util/frustum.hpp"
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/Camera.h>
+
+#include <algorithm>
+
+using namespace Magnum;
+
+namespace gvs::vis {
+
+PointCloud::PointCloud(std::shared_ptr<const PointCloudData> data,
+                       const PointCloudSettings& settings,
+                       PointCloudStats* stats)
+    : data_(std::move(data)), settings_(settings), stats_(stats), slot_size_(data_->octree.node_capacity()) {
+
+    std::size_t slot_bytes = slot_size_ * sizeof(PointVertex);
+    std::size_t num_slots = std::clamp(settings_.gpu_bytes / slot_bytes, std::size_t(1), data_->octree.nodes().size());
+
+    buffer_.setData({nullptr, num_slots * slot_bytes}, GL::BufferUsage::DynamicDraw);
+
+    mesh_.setPrimitive(GL::MeshPrimitive::Points)
+        .addVertexBuffer(buffer_, 0, GeneralShader3D::Position{}, GeneralShader3D::VertexColor{});
+
+    slot_nodes_.resize(num_slots, no_node);
+    slot_frames_.resize(num_slots, 0);
+
+    for (std::size_t slot = 0; slot < num_slots; ++slot) {
+        slot_positions_.emplace_back(lru_slots_.insert(lru_slots_.end(), slot));
+    }
+
+    node_slots_.resize(data_->octree.nodes().size(), num_slots);
+}
+
+void PointCloud::draw(GeneralShader3D& shader, const Matrix4& camera_from_local, SceneGraph::Camera3D& camera) {
+    ++frame_;
+
+    // Nodes are selected in the cloud's local space
+    Matrix4 clip_from_local = camera.projectionMatrix() * camera_from_local;
+    Vector3 eye = camera_from_local.inverted().translation();
+
+    util::PointLodSettings lod;
+    lod.projection_scale = camera.projectionMatrix()[1][1] * static_cast<Float>(camera.viewport().y()) * 0.5f;
+    lod.min_pixel_spacing = settings_.min_pixel_spacing;
+    lod.point_budget = settings_.point_budget - std::min(settings_.point_budget, stats_->points_drawn);
+
+    std::vector<std::uint32_t> nodes = util::select_point_nodes(
+        data_->octree, util::Frustum(clip_from_local.data()), {eye.x(), eye.y(), eye.z()}, lod);
+
+    firsts_.clear();
+    counts_.clear();
+
+    std::size_t uploads = 0;
+
+    // Most important nodes first so they are uploaded before the finer ones
+    for (std::uint32_t node : nodes) {
+        std::size_t slot = node_slots_[node];
+
+        if (slot == slot_nodes_.size()) {
+            if (uploads == settings_.uploads_per_frame or (slot = upload(node)) == slot_nodes_.size()) {
+                ++stats_->nodes_missing;
+                continue;
+            }
+            ++uploads;
+        }
+        touch(slot);
+
+        const util::PointOctree::Node& octree_node = data_->octree.nodes()[node];
+        firsts_.emplace_back(static_cast<Int>(slot * slot_size_));
+        counts_.emplace_back(static_cast<Int>(octree_node.count));
+
+        stats_->points_drawn += octree_node.count;
+        ++stats_->nodes_drawn;
+    }
+
+    if (firsts_.empty()) {
+        return;
+    }
+
+    // Magnum doesn't wrap multi-draws so OpenGL is called directly and Magnum's state tracking is reset
+    GL::Context::current().resetState(GL::Context::State::EnterExternal);
+
+    glUseProgram(shader.id());
+    glBindVertexArray(mesh_.id());
+    glMultiDrawArrays(GL_POINTS, firsts_.data(), counts_.data(), static_cast<GLsizei>(firsts_.size()));
+    glBindVertexArray(0);
+
+    GL::Context::current().resetState(GL::Context::State::ExitExternal);
+}
+
+std::size_t PointCloud::upload(std::uint32_t node) {
+    std::size_t slot = lru_slots_.back();
+
+    // Everything is being drawn this frame
+    if (slot_frames_[slot] == frame_) {
+        return slot_nodes_.size();
+    }
+
+    if (slot_nodes_[slot] != no_node) {
+        node_slots_[slot_nodes_[slot]] = slot_nodes_.size();
+    }
+    slot_nodes_[slot] = node;
+    node_slots_[node] = slot;
+
+    const util::PointOctree::Node& octree_node = data_->octree.nodes()[node];
+    const PointVertex* vertices = data_->vertices.data() + octree_node.first;
+
+    buffer_.setSubData(static_cast<GLintptr>(slot * slot_size_ * sizeof(PointVertex)),
+                       Containers::ArrayView<const void>(vertices, octree_node.count * sizeof(PointVertex)));
+    return slot;
+}
+
+void PointCloud::touch(std::size_t slot) {
+    slot_frames_[slot] = frame_;
+    lru_slots_.splice(lru_slots_.begin(), lru_slots_, slot_positions_[slot]);
+}
+
+} // namespace gvs::vis
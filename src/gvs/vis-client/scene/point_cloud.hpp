@@ -0,0 +1,102 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "gvs/vis-client/scene/general_shader_3d.hpp"
+#include "gvs/vis-client/scene/prepared_geometry.hpp"
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/SceneGraph/SceneGraph.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace gvs::vis {
+
+/// Shared by every point cloud in the scene. Defaults are low enough for software OpenGL (llvmpipe).
+struct PointCloudSettings {
+    std::size_t point_budget = 2'000'000; ///< the most points drawn per frame (across all point clouds)
+    float min_pixel_spacing = 1.5f; ///< nodes aren't refined once their points are this close on screen
+    std::size_t uploads_per_frame = 32; ///< the most octree nodes uploaded per point cloud each frame
+    std::size_t gpu_bytes = std::size_t(256) << 20u; ///< GPU memory for each point cloud's nodes
+};
+
+/// Filled in while drawing. Reset by the scene every frame.
+struct PointCloudStats {
+    std::size_t points_drawn = 0;
+    std::size_t nodes_drawn = 0;
+    std::size_t nodes_missing = 0; ///< selected nodes that weren't uploaded yet (detail is still being added)
+};
+
+/**
+ * @brief Draws a large point cloud from its octree. Every frame the nodes with the largest spacing
+ *        on screen are picked (see 'util::select_point_nodes') until the point budget is used up.
+ *
+ * Nodes are uploaded on demand into fixed size slots of a single buffer. Once the buffer is full
+ * the least recently drawn node is replaced. Only a few nodes are uploaded each frame so detail is
+ * added over several frames while the camera is still and moving never stalls on large uploads.
+ * Drawn nodes are submitted with a single 'glMultiDrawArrays' call which works on software OpenGL.
+ */
+class PointCloud {
+public:
+    explicit PointCloud(std::shared_ptr<const PointCloudData> data,
+                        const PointCloudSettings& settings,
+                        PointCloudStats* stats);
+
+    /// \brief Uploads missing nodes and draws the ones on the GPU. The item uniforms must already be bound.
+    void draw(GeneralShader3D& shader,
+              const Magnum::Matrix4& camera_from_local,
+              Magnum::SceneGraph::Camera3D& camera);
+
+private:
+    static constexpr std::uint32_t no_node = ~std::uint32_t(0);
+
+    std::shared_ptr<const PointCloudData> data_;
+    const PointCloudSettings& settings_;
+    PointCloudStats* stats_;
+
+    Magnum::GL::Buffer buffer_;
+    Magnum::GL::Mesh mesh_;
+    std::size_t slot_size_; ///< points per slot (the octree's node capacity)
+
+    std::vector<std::uint32_t> slot_nodes_; ///< the node in each slot (or 'no_node')
+    std::vector<std::size_t> slot_frames_; ///< the last frame each slot was drawn
+    std::vector<std::list<std::size_t>::iterator> slot_positions_; ///< each slot's place in 'lru_slots_'
+    std::list<std::size_t> lru_slots_; ///< most recently drawn first
+    std::vector<std::size_t> node_slots_; ///< the slot holding each node (or 'slot_nodes_.size()' if none)
+
+    std::size_t frame_ = 0;
+
+    std::vector<Magnum::Int> firsts_;
+    std::vector<Magnum::Int> counts_;
+
+    /// \brief Returns the slot the node was uploaded to, or 'slot_nodes_.size()' if every slot is in use this frame
+    std::size_t upload(std::uint32_t node);
+
+    /// \brief Marks the slot as drawn this frame
+    void touch(std::size_t slot);
+};
+
+} // namespace gvs::vis
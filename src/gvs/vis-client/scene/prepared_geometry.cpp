@@ -0,0 +1,327 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "prepared_geometry.hpp"
+
+#include "gvs/util/attribute_view.hpp"
+#include "gvs/util/buffer_change_tracker.hpp"
+#include "gvs/util/vertex_layout.hpp"
+
+#include <Magnum/MeshTools/CompressIndices.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace gvs::vis {
+
+namespace {
+
+void prepare_item(const proto::SceneItemInfo& item, PreparedUpdate* prepared) {
+    if (item.has_geometry_info()) {
+        // An update that doesn't set the format keeps the item's current one, which isn't known here
+        const proto::DisplayInfo& display = item.display_info();
+        bool drawn_as_triangles
+            = not display.has_geometry_format() or display.geometry_format().value() == proto::TRIANGLES;
+
+        PreparedGeometry& geometry = prepared->geometry[&item.geometry_info()];
+        geometry = prepare_geometry(item.geometry_info(), drawn_as_triangles);
+        prepared->num_bytes += geometry.num_bytes;
+    }
+}
+
+void prepare_all(const proto::SceneUpdate& update, PreparedUpdate* prepared) {
+    switch (update.update_case()) {
+    case proto::SceneUpdate::kAddItem:
+        prepare_item(update.add_item(), prepared);
+        break;
+
+    case proto::SceneUpdate::kUpdateItem:
+        prepare_item(update.update_item(), prepared);
+        break;
+
+    case proto::SceneUpdate::kResetAllItems:
+        for (const auto& item : update.reset_all_items().items()) {
+            prepare_item(item.second, prepared);
+        }
+        break;
+
+    case proto::SceneUpdate::kBatch:
+        for (const proto::SceneUpdate& batched_update : update.batch().updates()) {
+            prepare_all(batched_update, prepared);
+        }
+        break;
+
+    case proto::SceneUpdate::kRemoveItem:
+    case proto::SceneUpdate::kTransforms:
+    case proto::SceneUpdate::UPDATE_NOT_SET:
+        break;
+    }
+}
+
+/// \brief The number of vertices (interleaved if the positions are interleaved, otherwise the separate list)
+std::size_t position_count(const proto::GeometryInfo3D& geometry) {
+    const proto::InterleavedVertices& interleaved = geometry.interleaved_vertices();
+
+    if (util::find_attribute(interleaved, proto::ATTRIBUTE_POSITION)) {
+        return util::vertex_count(interleaved);
+    }
+    return util::attribute_view(geometry.positions()).size() / 3u;
+}
+
+/// \brief Copies an attribute from the interleaved vertices if it's there, otherwise from the separate list.
+///        'values_of(v)' is where the components for vertex 'v' are written. The interleaved layout must be valid.
+template <typename ValuesOf>
+void read_attribute_values(const proto::GeometryInfo3D& geometry,
+                           proto::VertexAttribute attribute,
+                           const proto::FloatList& list,
+                           std::size_t num_vertices,
+                           ValuesOf&& values_of) {
+    const proto::InterleavedVertices& interleaved = geometry.interleaved_vertices();
+    std::uint32_t num_components = util::component_count(attribute);
+
+    if (const proto::VertexAttributeLayout* layout = util::find_attribute(interleaved, attribute)) {
+        const char* vertex = interleaved.data().data() + layout->offset();
+
+        for (std::size_t v = 0u; v < num_vertices; ++v) {
+            float* values = values_of(v);
+
+            for (auto c = 0u; c < num_components; ++c) {
+                if (layout->type() == proto::UNORM8) {
+                    values[c] = static_cast<unsigned char>(vertex[c]) / 255.f;
+                } else {
+                    std::memcpy(values + c, vertex + c * sizeof(float), sizeof(float));
+                }
+            }
+            vertex += interleaved.stride();
+        }
+        return;
+    }
+
+    util::AttributeView<float> values = util::attribute_view(list);
+    std::size_t count = std::min(num_vertices, values.size() / num_components);
+
+    for (std::size_t v = 0u; v < count; ++v) {
+        std::copy_n(values.data() + v * num_components, num_components, values_of(v));
+    }
+}
+
+/// \brief Copies an attribute into each vertex (see 'read_attribute_values')
+template <typename Vertex, typename Member>
+void read_attribute(const proto::GeometryInfo3D& geometry,
+                    proto::VertexAttribute attribute,
+                    const proto::FloatList& list,
+                    Member Vertex::*member,
+                    std::vector<Vertex>* vertices) {
+    read_attribute_values(geometry, attribute, list, vertices->size(), [vertices, member](std::size_t v) {
+        return ((*vertices)[v].*member).data();
+    });
+}
+
+} // namespace
+
+VertexBlocks vertex_blocks(const proto::GeometryInfo3D& geometry) {
+    const proto::InterleavedVertices& interleaved = geometry.interleaved_vertices();
+
+    VertexBlocks blocks = {};
+
+    if (not interleaved.data().empty()) {
+        blocks[0] = {interleaved.data().data(), interleaved.data().size()};
+    }
+
+    auto separate_block = [&](proto::VertexAttribute attribute, const proto::FloatList& list) {
+        util::AttributeView<float> values = util::attribute_view(list);
+
+        // Interleaved attributes take the place of separate lists
+        if (util::find_attribute(interleaved, attribute) or values.empty()) {
+            return Corrade::Containers::ArrayView<const char>{};
+        }
+        return Corrade::Containers::ArrayView<const char>{reinterpret_cast<const char*>(values.data()),
+                                                          values.size() * sizeof(float)};
+    };
+
+    blocks[1] = separate_block(proto::ATTRIBUTE_POSITION, geometry.positions());
+    blocks[2] = separate_block(proto::ATTRIBUTE_NORMAL, geometry.normals());
+    blocks[3] = separate_block(proto::ATTRIBUTE_TEX_COORD, geometry.tex_coords());
+    blocks[4] = separate_block(proto::ATTRIBUTE_VERTEX_COLOR, geometry.vertex_colors());
+
+    auto instance_block = [](const proto::FloatList& list) {
+        util::AttributeView<float> values = util::attribute_view(list);
+        return Corrade::Containers::ArrayView<const char>{reinterpret_cast<const char*>(values.data()),
+                                                          values.size() * sizeof(float)};
+    };
+
+    if (util::instance_count(geometry) > 0u) {
+        blocks[5] = instance_block(geometry.instance_transformations());
+        blocks[6] = instance_block(geometry.instance_colors());
+    }
+
+    return blocks;
+}
+
+BatchGeometry batch_geometry(const proto::GeometryInfo3D& geometry) {
+    if (not util::layout_error(geometry.interleaved_vertices()).empty() or util::instance_count(geometry) > 0u) {
+        return {};
+    }
+
+    std::size_t num_vertices = position_count(geometry);
+
+    if (num_vertices == 0u or num_vertices > max_batched_vertices) {
+        return {};
+    }
+
+    BatchVertex default_vertex;
+    default_vertex.color = {1.f, 1.f, 1.f};
+
+    BatchGeometry batch;
+    batch.vertices.resize(num_vertices, default_vertex);
+
+    auto read = [&](proto::VertexAttribute attribute, const proto::FloatList& list, auto member) {
+        read_attribute(geometry, attribute, list, member, &batch.vertices);
+    };
+
+    read(proto::ATTRIBUTE_POSITION, geometry.positions(), &BatchVertex::position);
+    read(proto::ATTRIBUTE_NORMAL, geometry.normals(), &BatchVertex::normal);
+    read(proto::ATTRIBUTE_TEX_COORD, geometry.tex_coords(), &BatchVertex::tex_coord);
+    read(proto::ATTRIBUTE_VERTEX_COLOR, geometry.vertex_colors(), &BatchVertex::color);
+
+    util::AttributeView<unsigned> indices = util::attribute_view(geometry.indices());
+
+    if (indices.empty()) {
+        batch.indices.resize(num_vertices);
+        std::iota(batch.indices.begin(), batch.indices.end(), 0u);
+    } else if (std::all_of(indices.begin(), indices.end(), [&](unsigned index) { return index < num_vertices; })) {
+        batch.indices.assign(indices.begin(), indices.end());
+    } else {
+        return {}; // Out of range indices would read another item's vertices
+    }
+
+    return batch;
+}
+
+std::shared_ptr<const PointCloudData> point_cloud_data(const proto::GeometryInfo3D& geometry) {
+    if (not geometry.point_cloud() or not util::layout_error(geometry.interleaved_vertices()).empty()) {
+        return nullptr;
+    }
+
+    PointVertex default_vertex;
+    default_vertex.color = {1.f, 1.f, 1.f};
+
+    std::vector<PointVertex> vertices(position_count(geometry), default_vertex);
+
+    if (vertices.empty()) {
+        return nullptr;
+    }
+
+    read_attribute(geometry, proto::ATTRIBUTE_POSITION, geometry.positions(), &PointVertex::position, &vertices);
+    read_attribute(geometry, proto::ATTRIBUTE_VERTEX_COLOR, geometry.vertex_colors(), &PointVertex::color, &vertices);
+
+    util::PointOctree octree(vertices.data()->position.data(), vertices.size(), sizeof(PointVertex) / sizeof(float));
+    auto data = std::make_shared<PointCloudData>(PointCloudData{std::move(octree), {}});
+
+    if (data->octree.nodes().empty()) {
+        return nullptr; // no finite positions
+    }
+
+    data->vertices.reserve(data->octree.point_order().size());
+    for (std::uint32_t index : data->octree.point_order()) {
+        data->vertices.emplace_back(vertices[index]);
+    }
+    return data;
+}
+
+std::shared_ptr<TriangleMesh> triangle_mesh(const proto::GeometryInfo3D& geometry) {
+    if (geometry.point_cloud() or util::instance_count(geometry) > 0u
+        or not util::layout_error(geometry.interleaved_vertices()).empty()) {
+        return nullptr;
+    }
+
+    auto mesh = std::make_shared<TriangleMesh>();
+    mesh->positions.resize(position_count(geometry));
+
+    read_attribute_values(geometry,
+                          proto::ATTRIBUTE_POSITION,
+                          geometry.positions(),
+                          mesh->positions.size(),
+                          [&positions = mesh->positions](std::size_t v) { return positions[v].data(); });
+
+    util::AttributeView<unsigned> indices = util::attribute_view(geometry.indices());
+    mesh->indices.assign(indices.begin(), indices.end());
+
+    return mesh;
+}
+
+PreparedGeometry prepare_geometry(const proto::GeometryInfo3D& geometry, bool drawn_as_triangles) {
+    PreparedGeometry prepared;
+
+    // Point clouds are uploaded a few octree nodes at a time by 'PointCloud'
+    if ((prepared.point_cloud = point_cloud_data(geometry))) {
+        prepared.local_bounds = util::position_bounds(geometry);
+        return prepared;
+    }
+
+    VertexBlocks blocks = vertex_blocks(geometry);
+
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        prepared.block_hashes[i] = util::BufferChangeTracker::hash_chunks(blocks[i].data(), blocks[i].size());
+        prepared.num_bytes += blocks[i].size();
+    }
+
+    util::AttributeView<unsigned> indices = util::attribute_view(geometry.indices());
+
+    if (not indices.empty()) {
+        std::size_t index_bytes = indices.size() * sizeof(unsigned);
+        prepared.index_hashes = util::BufferChangeTracker::hash_chunks(indices.data(), index_bytes);
+
+        std::vector<Magnum::UnsignedInt> index_copy{indices.begin(), indices.end()};
+        std::tie(prepared.index_data, prepared.index_type, prepared.index_start, prepared.index_end)
+            = Magnum::MeshTools::compressIndices(index_copy);
+
+        prepared.num_bytes += prepared.index_data.size();
+    }
+
+    prepared.local_bounds = util::geometry_bounds(geometry);
+    prepared.batch_geometry = batch_geometry(geometry);
+
+    if (drawn_as_triangles and (prepared.triangle_mesh = triangle_mesh(geometry))) {
+        const TriangleMesh& mesh = *prepared.triangle_mesh;
+        std::size_t num_triangles = (mesh.indices.empty() ? mesh.positions.size() : mesh.indices.size()) / 3u;
+
+        if (num_triangles <= max_immediate_bvh_triangles) {
+            prepared.triangle_bvh = TriangleBvhBuilder::build_now(std::move(*prepared.triangle_mesh));
+            prepared.triangle_mesh = nullptr;
+        }
+    }
+
+    return prepared;
+}
+
+PreparedUpdate prepare_update(proto::SceneUpdate update) {
+    PreparedUpdate prepared;
+    prepared.prepare_start = std::chrono::steady_clock::now();
+    prepared.update = std::make_unique<proto::SceneUpdate>(std::move(update));
+    prepare_all(*prepared.update, &prepared);
+    prepared.prepare_end = std::chrono::steady_clock::now();
+    return prepared;
+}
+
+} // namespace gvs::vis
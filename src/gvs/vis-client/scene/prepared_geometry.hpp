@@ -0,0 +1,158 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/aabb_tree.hpp"
+#include "gvs/util/point_octree.hpp"
+#include "gvs/vis-client/scene/triangle_bvh_builder.hpp"
+
+// generated
+#include <scene.pb.h>
+
+// external
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Mesh.h>
+
+// standard
+#include <array>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace gvs::vis {
+
+/// The interleaved vertices, the separate position, normal, tex coord, and color lists,
+/// then the per-instance transformations and colors
+constexpr std::size_t num_vertex_blocks = 7;
+
+using VertexBlocks = std::array<Corrade::Containers::ArrayView<const char>, num_vertex_blocks>;
+
+/**
+ * @brief The vertex data stored on the GPU for 'geometry'. Points into the proto. Separate lists
+ *        for attributes that are already in the interleaved vertices are left empty.
+ */
+VertexBlocks vertex_blocks(const proto::GeometryInfo3D& geometry);
+
+/// Geometry with at most this many vertices can be merged into a 'MeshBatch'
+constexpr std::size_t max_batched_vertices = 1024;
+
+/// The vertex format shared by all items in a 'MeshBatch'. Missing attributes are zero (white for colors).
+struct BatchVertex {
+    Magnum::Vector3 position;
+    Magnum::Vector3 normal;
+    Magnum::Vector2 tex_coord;
+    Magnum::Vector3 color;
+};
+
+struct BatchGeometry {
+    std::vector<BatchVertex> vertices;
+    std::vector<Magnum::UnsignedInt> indices; ///< every vertex in order if the geometry isn't indexed
+};
+
+/**
+ * @brief Converts 'geometry' to the shared batch format. Returns empty geometry if there are more
+ *        than 'max_batched_vertices' vertices or the geometry is instanced.
+ */
+BatchGeometry batch_geometry(const proto::GeometryInfo3D& geometry);
+
+/// One point of a 'PointCloud'. Colors are white if the geometry has none.
+struct PointVertex {
+    Magnum::Vector3 position;
+    Magnum::Vector3 color;
+};
+
+/// A point cloud split into octree nodes that can be uploaded one at a time
+struct PointCloudData {
+    util::PointOctree octree;
+    std::vector<PointVertex> vertices; ///< in 'octree.point_order()' order so each node is contiguous
+};
+
+/**
+ * @brief Builds the octree for geometry sent in point cloud mode. Returns null for other geometry.
+ *        Only positions and vertex colors are used.
+ */
+std::shared_ptr<const PointCloudData> point_cloud_data(const proto::GeometryInfo3D& geometry);
+
+/// Meshes with at most this many triangles have their picking BVH built while they're prepared
+constexpr std::size_t max_immediate_bvh_triangles = 65536;
+
+/**
+ * @brief Copies the positions and indices needed to build a picking BVH. Returns null for point
+ *        clouds and instanced geometry. The geometry is always treated as a list of triangles.
+ */
+std::shared_ptr<TriangleMesh> triangle_mesh(const proto::GeometryInfo3D& geometry);
+
+/**
+ * @brief Everything that can be computed for the GPU without an OpenGL context. Prepared on
+ *        worker threads so the render thread only has to upload data.
+ */
+struct PreparedGeometry {
+    std::array<std::vector<std::size_t>, num_vertex_blocks> block_hashes; ///< see 'util::BufferChangeTracker'
+    std::vector<std::size_t> index_hashes;
+
+    Corrade::Containers::Array<char> index_data; ///< compressed (empty if the geometry has no indices)
+    Magnum::MeshIndexType index_type = Magnum::MeshIndexType::UnsignedInt;
+    Magnum::UnsignedInt index_start = 0;
+    Magnum::UnsignedInt index_end = 0;
+
+    util::Aabb local_bounds; ///< bounds of the positions, used for culling
+
+    BatchGeometry batch_geometry; ///< only filled for small geometry
+
+    /// Only set for point clouds. Nothing else but 'local_bounds' (still needed for culling) is filled in for them.
+    std::shared_ptr<const PointCloudData> point_cloud;
+
+    // For picking. Neither is set if the item is known to be drawn as points or lines.
+    std::shared_ptr<const util::TriangleBvh> triangle_bvh; ///< built here for small meshes
+    std::shared_ptr<TriangleMesh> triangle_mesh; ///< left for a 'TriangleBvhBuilder' for large meshes
+
+    std::size_t num_bytes = 0; ///< The most that will be uploaded for this geometry
+};
+
+/// \brief 'drawn_as_triangles' is false if the item is known to be drawn as points or lines, which skips
+///        the picking data
+PreparedGeometry prepare_geometry(const proto::GeometryInfo3D& geometry, bool drawn_as_triangles = true);
+
+using PreparedGeometries = std::unordered_map<const proto::GeometryInfo3D*, PreparedGeometry>;
+
+/**
+ * @brief A scene update with all of its geometry prepared
+ */
+struct PreparedUpdate {
+    std::unique_ptr<proto::SceneUpdate> update; ///< heap allocated so 'geometry' keys stay valid when moved
+    PreparedGeometries geometry;
+    std::size_t num_bytes = 0;
+
+    // When the worker thread started and finished preparing the update
+    std::chrono::steady_clock::time_point prepare_start;
+    std::chrono::steady_clock::time_point prepare_end;
+};
+
+PreparedUpdate prepare_update(proto::SceneUpdate update);
+
+} // namespace gvs::vis
@@ -24,6 +24,7 @@
 
 // gvs
 #include "gvs/vis-client/scene/camera_package.hpp"
+#include "gvs/vis-client/scene/prepared_geometry.hpp"
 
 // generated
 #include <types.pb.h>
@@ -50,11 +51,22 @@ public:
     virtual void render(const CameraPackage& camera_package) = 0;
     virtual void configure_gui(const Magnum::Vector2i& viewport) = 0;
 
-    virtual void add_item(const proto::SceneItemInfo& info) = 0;
-    virtual void update_item(const proto::SceneItemInfo& info) = 0;
-    virtual void reset(const proto::SceneItems& items) = 0;
+    /*
+     * 'prepared' holds geometry that was prepared ahead of time (see 'prepare_update').
+     * Any geometry that isn't in it is prepared when the item is added.
+     */
+    virtual void add_item(const proto::SceneItemInfo& info, const PreparedGeometries& prepared) = 0;
+    virtual void update_item(const proto::SceneItemInfo& info, const PreparedGeometries& prepared) = 0;
+    virtual void update_transforms(const proto::TransformBatch& batch) = 0;
+    virtual void reset(const proto::SceneItems& items, const PreparedGeometries& prepared) = 0;
 
     virtual void resize(const Magnum::Vector2i& viewport) = 0;
+
+    /// \brief Selects the closest item hit by the ray, or clears the selection if nothing is hit
+    virtual void pick(const Ray& world_ray) = 0;
+
+    /// \brief True while detail is still being added to the scene (frames should keep being drawn)
+    virtual bool refining() const = 0;
 };
 
 inline SceneInterface::~SceneInterface() = default;
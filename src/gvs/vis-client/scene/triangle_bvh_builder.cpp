@@ -0,0 +1,124 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#include "triangle_bvh_builder.hpp"
+
+// standard
+#include <new>
+
+namespace gvs::vis {
+
+TriangleBvhBuilder::TriangleBvhBuilder() : worker_(&TriangleBvhBuilder::run_jobs, this) {}
+
+TriangleBvhBuilder::~TriangleBvhBuilder() {
+    {
+        std::lock_guard<std::mutex> scoped_lock(lock_);
+        stop_ = true;
+    }
+    jobs_available_.notify_all();
+    worker_.join();
+
+    cancel_all();
+}
+
+TriangleBvhFuture TriangleBvhBuilder::build(const std::string& item_id, std::shared_ptr<TriangleMesh> mesh) {
+    std::promise<std::shared_ptr<const util::TriangleBvh>> promise;
+    TriangleBvhFuture future = promise.get_future().share();
+    {
+        std::lock_guard<std::mutex> scoped_lock(lock_);
+
+        auto iter = jobs_.find(item_id);
+        if (iter == jobs_.end()) {
+            jobs_.emplace(item_id, Job{std::move(mesh), std::move(promise)});
+            order_.emplace_back(item_id);
+        } else {
+            // The replaced build keeps its place in line
+            iter->second.promise.set_value(nullptr);
+            iter->second = Job{std::move(mesh), std::move(promise)};
+        }
+    }
+    jobs_available_.notify_one();
+    return future;
+}
+
+void TriangleBvhBuilder::cancel(const std::string& item_id) {
+    std::lock_guard<std::mutex> scoped_lock(lock_);
+
+    auto iter = jobs_.find(item_id);
+    if (iter != jobs_.end()) {
+        iter->second.promise.set_value(nullptr);
+        jobs_.erase(iter);
+    }
+}
+
+void TriangleBvhBuilder::cancel_all() {
+    std::lock_guard<std::mutex> scoped_lock(lock_);
+
+    for (auto& job : jobs_) {
+        job.second.promise.set_value(nullptr);
+    }
+    jobs_.clear();
+    order_.clear();
+}
+
+TriangleBvhFuture TriangleBvhBuilder::ready(std::shared_ptr<const util::TriangleBvh> bvh) {
+    std::promise<std::shared_ptr<const util::TriangleBvh>> promise;
+    promise.set_value(std::move(bvh));
+    return promise.get_future().share();
+}
+
+std::shared_ptr<const util::TriangleBvh> TriangleBvhBuilder::build_now(TriangleMesh mesh) {
+    try {
+        return std::make_shared<const util::TriangleBvh>(std::move(mesh.positions), mesh.indices);
+    } catch (const std::bad_alloc&) {
+        return nullptr; // The item just can't be picked precisely
+    }
+}
+
+void TriangleBvhBuilder::run_jobs() {
+    std::unique_lock<std::mutex> lock(lock_);
+
+    while (true) {
+        jobs_available_.wait(lock, [this] { return stop_ or not order_.empty(); });
+
+        if (stop_) {
+            return;
+        }
+
+        auto iter = jobs_.find(order_.front());
+        order_.pop_front();
+
+        if (iter == jobs_.end()) {
+            continue; // Cancelled
+        }
+
+        Job job = std::move(iter->second);
+        jobs_.erase(iter);
+
+        lock.unlock();
+        job.promise.set_value(build_now(std::move(*job.mesh)));
+        job.mesh = nullptr;
+        lock.lock();
+    }
+}
+
+} // namespace gvs::vis
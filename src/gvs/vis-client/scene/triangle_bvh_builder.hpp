@@ -0,0 +1,99 @@
+// ///////////////////////////////////////////////////////////////////////////////////////
+// Geometry Visualization Server
+// Copyright (c) 2019 Logan Barnes - All Rights Reserved
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ///////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// project
+#include "gvs/util/triangle_bvh.hpp"
+
+// standard
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace gvs::vis {
+
+/// The positions and indices of an item's geometry, copied so its BVH can be built after the proto is gone
+struct TriangleMesh {
+    std::vector<util::Vec3f> positions;
+    std::vector<std::uint32_t> indices; ///< empty if every three positions form a triangle
+};
+
+using TriangleBvhFuture = std::shared_future<std::shared_ptr<const util::TriangleBvh>>;
+
+/**
+ * @brief Builds picking BVHs for large meshes one at a time on a single background thread so
+ *        they don't hold up drawing or the threads preparing scene updates.
+ *
+ * Only the newest mesh sent for an item is built. Sending another mesh for an item whose build
+ * hasn't started replaces the waiting one, whose future then holds null. A build that has
+ * already started runs to completion.
+ */
+class TriangleBvhBuilder {
+public:
+    TriangleBvhBuilder();
+
+    /// \brief Drops the builds that haven't started and waits for the current one
+    ~TriangleBvhBuilder();
+
+    TriangleBvhBuilder(const TriangleBvhBuilder&) = delete;
+    TriangleBvhBuilder& operator=(const TriangleBvhBuilder&) = delete;
+
+    /// \brief Queues a build for the item. The mesh data is moved out of 'mesh' when the build starts.
+    TriangleBvhFuture build(const std::string& item_id, std::shared_ptr<TriangleMesh> mesh);
+
+    /// \brief Drops the item's build if it hasn't started (its future holds null)
+    void cancel(const std::string& item_id);
+
+    /// \brief Drops every build that hasn't started
+    void cancel_all();
+
+    /// \brief A future that already holds 'bvh'
+    static TriangleBvhFuture ready(std::shared_ptr<const util::TriangleBvh> bvh);
+
+    /// \brief Builds the BVH on the calling thread. Returns null if there isn't enough memory.
+    static std::shared_ptr<const util::TriangleBvh> build_now(TriangleMesh mesh);
+
+private:
+    struct Job {
+        std::shared_ptr<TriangleMesh> mesh;
+        std::promise<std::shared_ptr<const util::TriangleBvh>> promise;
+    };
+
+    std::mutex lock_;
+    std::condition_variable jobs_available_;
+    std::unordered_map<std::string, Job> jobs_; ///< At most one waiting build per item
+    std::deque<std::string> order_; ///< Item ids in the order they were queued (may include dropped builds)
+    bool stop_ = false;
+
+    std::thread worker_;
+
+    void run_jobs();
+};
+
+} // namespace gvs::vis
@@ -24,7 +24,6 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #include "gvs/vis-client/vis_client.hpp"
 
-#include "gvs/server/scene_server.hpp"
 #include "gvs/vis-client/app/imgui_theme.hpp"
 #include "gvs/vis-client/imgui_utils.hpp"
 #include "gvs/vis-client/scene/opengl_scene.hpp"
@@ -39,8 +38,12 @@
 #include <imgui.h>
 
 // standard
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdio>
 #include <limits>
+#include <memory>
 #include <sstream>
 
 using namespace Magnum;
@@ -88,7 +91,8 @@ VisClient::VisClient(std::string initial_host_address, const Arguments& argument
       gl_version_str_(GL::Context::current().versionString()),
       gl_renderer_str_(GL::Context::current().rendererString()),
       server_address_input_(std::move(initial_host_address)),
-      grpc_client_(std::make_unique<grpcw::client::GrpcClient<Service>>()) {
+      grpc_client_(std::make_unique<grpcw::client::GrpcClient<Service>>()),
+      scene_updates_(util::OrderedTaskPool<PreparedUpdate>::default_num_threads(), [this] { reset_draw_counter(); }) {
 
     scene_ = std::make_unique<OpenGLScene>(make_scene_init_info(theme_->background, this->windowSize()));
 
@@ -114,35 +118,81 @@ VisClient::VisClient(std::string initial_host_address, const Arguments& argument
 vis::VisClient::~VisClient() = default;
 
 void vis::VisClient::update() {
-    scene_updates_.use_safely([this](std::vector<proto::SceneUpdate>& updates) {
-        for (const proto::SceneUpdate& update : updates) {
+    while (std::optional<IncomingMessages> incoming = incoming_messages_.pop()) {
+        if (incoming->replace_existing) {
+            message_log_.clear();
+        }
+        for (proto::Message& message : *incoming->messages.mutable_messages()) {
+            message_log_.add(std::move(message));
+        }
+    }
 
-            switch (update.update_case()) {
-            case proto::SceneUpdate::kAddItem:
-                scene_->add_item(update.add_item());
-                break;
+    // Merge everything that arrived since the last frame so each item is only prepared and uploaded once
+    while (std::optional<proto::SceneUpdate> incoming = incoming_updates_.pop()) {
+        pending_updates_.add(std::move(*incoming));
+    }
 
-            case proto::SceneUpdate::kUpdateItem:
-                scene_->update_item(update.update_item());
-                break;
+    if (not pending_updates_.empty()) {
+        submit_scene_updates(pending_updates_.take_combined());
+    }
 
-            case proto::SceneUpdate::kResetAllItems:
-                scene_->reset(update.reset_all_items());
-                break;
+    std::size_t uploaded_bytes = 0;
 
-            case proto::SceneUpdate::kRemoveItem:
-                break;
+    // Updates were already prepared by the worker threads so only uploads happen here
+    while (uploaded_bytes < upload_budget_bytes_) {
+        std::optional<PreparedUpdate> prepared = scene_updates_.take_next();
 
-            case proto::SceneUpdate::UPDATE_NOT_SET:
-                break;
-            }
+        if (not prepared) {
+            break;
         }
-        updates.clear();
-    });
+
+        profiler_.add_event(
+            "prepare", prepared->prepare_start, prepared->prepare_end, util::FrameProfiler::Track::Workers);
+
+        apply_scene_update(*prepared->update, prepared->geometry);
+        uploaded_bytes += prepared->num_bytes;
+    }
+
+    // Keep drawing until everything has been uploaded and refined
+    if (scene_updates_.num_pending() > 0 or scene_->refining()) {
+        reset_draw_counter();
+    }
 
     scene_->update(this->windowSize());
 }
 
+void vis::VisClient::submit_scene_updates(proto::SceneUpdate combined) {
+    auto submit = [this](proto::SceneUpdate* update) {
+        auto task_update = std::make_shared<proto::SceneUpdate>();
+        task_update->Swap(update);
+        scene_updates_.submit([task_update] { return prepare_update(std::move(*task_update)); });
+    };
+
+    if (combined.update_case() != proto::SceneUpdate::kBatch) {
+        submit(&combined);
+        return;
+    }
+
+    // Separate tasks let the workers share a burst of updates and let the upload budget spread it
+    // over several frames. The pool keeps the tasks in order.
+    proto::SceneUpdate chunk;
+    std::size_t chunk_bytes = 0;
+
+    for (proto::SceneUpdate& update : *combined.mutable_batch()->mutable_updates()) {
+        chunk_bytes += update.ByteSizeLong();
+        chunk.mutable_batch()->add_updates()->Swap(&update);
+
+        if (chunk_bytes >= max_task_bytes) {
+            submit(&chunk);
+            chunk_bytes = 0;
+        }
+    }
+
+    if (chunk.batch().updates_size() > 0) {
+        submit(&chunk);
+    }
+}
+
 void vis::VisClient::render(const CameraPackage& camera_package) const {
     scene_->render(camera_package);
 }
@@ -217,6 +267,13 @@ void vis::VisClient::configure_gui() {
         reset_draw_counter();
     }
 
+    ImGui::Checkbox("Show frame profiler", &show_profiler_);
+
+    int upload_budget_mb = static_cast<int>(upload_budget_bytes_ >> 20u);
+    if (ImGui::SliderInt("Upload MB per frame", &upload_budget_mb, 1, 512)) {
+        upload_budget_bytes_ = static_cast<std::size_t>(upload_budget_mb) << 20u;
+    }
+
     add_three_line_separator();
 
 #ifdef OptiX_FOUND
@@ -237,26 +294,59 @@ void vis::VisClient::configure_gui() {
 
     scene_->configure_gui(this->windowSize());
 
-    messages_.use_safely([&](const proto::Messages& messages) {
+    {
+        add_three_line_separator();
+
+        imgui::configure_gui("Filter", &message_filter_);
+        message_log_.set_filter(message_filter_);
+
+        if (message_log_.num_dropped() > 0u) {
+            ImGui::TextDisabled("%llu older messages were dropped",
+                                static_cast<unsigned long long>(message_log_.num_dropped()));
+        }
+
         float message_input_start_height = h - 100.f;
         float max_message_window_height = message_input_start_height - ImGui::GetCursorPos().y;
 
-        add_three_line_separator();
-
         ImGui::BeginChild("Messages", {ImGui::GetWindowSize().x, max_message_window_height});
 
-        auto text_func = (wrap_text_ ? &ImGui::TextWrapped : &ImGui::Text);
+        // Keep showing the newest messages unless the user scrolled up
+        bool follow_newest = (ImGui::GetScrollY() >= ImGui::GetScrollMaxY());
 
-        for (const auto& message : messages.messages()) {
+        auto configure_message = [&](const proto::Message& message) {
             ImGui::TextColored({0.7f, 0.7f, 0.7f, 1.f}, "%s: ", message.identifier().c_str());
             ImGui::SameLine();
-            text_func("%s", message.contents().c_str());
+            if (wrap_text_) {
+                ImGui::TextWrapped("%s", message.contents().c_str());
+            } else {
+                ImGui::Text("%s", message.contents().c_str());
+            }
+        };
+
+        if (wrap_text_) {
+            // Wrapped rows have different heights so they can't be clipped. Only the newest are shown.
+            std::size_t num_messages = message_log_.size();
+            for (std::size_t i = num_messages - std::min(num_messages, max_wrapped_messages); i < num_messages; ++i) {
+                configure_message(message_log_[i]);
+            }
+
+        } else {
+            // Only the rows that are scrolled into view are drawn
+            ImGuiListClipper clipper(static_cast<int>(message_log_.size()), ImGui::GetTextLineHeightWithSpacing());
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                    configure_message(message_log_[static_cast<std::size_t>(i)]);
+                }
+            }
+        }
+
+        if (follow_newest) {
+            ImGui::SetScrollHereY(1.f);
         }
-        ImGui::SetScrollY(ImGui::GetScrollMaxY());
         ImGui::EndChild();
 
         add_three_line_separator();
-    });
+    }
 
     bool send_message = false;
 
@@ -295,6 +385,10 @@ void vis::VisClient::configure_gui() {
 
     ImGui::End();
 
+    if (show_profiler_) {
+        configure_profiler_gui();
+    }
+
     if (not error_message_.empty()) {
         int w = this->windowSize().x();
         ImGui::SetNextWindowPos({w * 0.5f, 0.f}, 0, {0.5f, 0.f});
@@ -310,17 +404,135 @@ void vis::VisClient::configure_gui() {
     }
 }
 
+void VisClient::configure_profiler_gui() {
+    // Recorded on the render thread except for "prepare" (worker threads) and the GPU times
+    static constexpr std::array<const char*, 9> phases
+        = {"update", "prepare", "upload", "transforms", "render", "imgui", "swap", "gpu render", "gpu imgui"};
+
+    const auto& frames = profiler_.frames();
+
+    // The current frame is still being timed
+    std::size_t num_frames = (frames.empty() ? 0u : frames.size() - 1u);
+
+    int w = this->windowSize().x();
+    ImGui::SetNextWindowPos({w - 10.f, 10.f}, 0, {1.f, 0.f});
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    ImGui::Begin("Frame Profiler", &show_profiler_, ImGuiWindowFlags_AlwaysAutoResize);
+
+    auto plot = [&](const char* label, auto&& frame_time_us) {
+        profiler_plot_values_.resize(num_frames);
+
+        float max_ms = 0.f;
+        for (std::size_t i = 0; i < num_frames; ++i) {
+            profiler_plot_values_[i] = static_cast<float>(frame_time_us(frames[i]) * 1e-3);
+            max_ms = std::max(max_ms, profiler_plot_values_[i]);
+        }
+
+        float last_ms = (num_frames > 0u ? profiler_plot_values_.back() : 0.f);
+
+        char overlay[64];
+        std::snprintf(overlay,
+                      sizeof(overlay),
+                      "%.2f ms (max %.2f)",
+                      static_cast<double>(last_ms),
+                      static_cast<double>(max_ms));
+
+        ImGui::PlotLines(label,
+                         profiler_plot_values_.data(),
+                         static_cast<int>(num_frames),
+                         0,
+                         overlay,
+                         0.f,
+                         std::max(max_ms, 1.f),
+                         {250.f, 40.f});
+    };
+
+    plot("frame", [](const util::FrameProfiler::Frame& frame) { return frame.duration_us; });
+
+    for (const char* phase : phases) {
+        plot(phase, [phase](const util::FrameProfiler::Frame& frame) {
+            return util::FrameProfiler::total_us(frame, phase);
+        });
+    }
+
+    ImGui::Spacing();
+    imgui::configure_gui("Trace File", &trace_filename_);
+
+    if (ImGui::Button("Save Chrome Trace")) {
+        if (not profiler_.write_chrome_trace(trace_filename_)) {
+            error_message_ = "Failed to write the trace to '" + trace_filename_ + "'";
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        profiler_.clear();
+    }
+
+    ImGui::End();
+}
+
 void VisClient::resize(const Vector2i& viewport) {
     scene_->resize(viewport);
 }
 
+void VisClient::pick(const Ray& world_ray) {
+    scene_->pick(world_ray);
+}
+
+void VisClient::apply_scene_update(const proto::SceneUpdate& update, const PreparedGeometries& prepared) {
+    using Profiler = util::FrameProfiler;
+    auto start = Profiler::Clock::now();
+
+    auto record_upload = [&](std::string detail) {
+        profiler_.add_event("upload", start, Profiler::Clock::now(), Profiler::Track::RenderThread, std::move(detail));
+    };
+
+    switch (update.update_case()) {
+    case proto::SceneUpdate::kAddItem:
+        scene_->add_item(update.add_item(), prepared);
+        record_upload(update.add_item().id().value());
+        break;
+
+    case proto::SceneUpdate::kUpdateItem:
+        scene_->update_item(update.update_item(), prepared);
+        record_upload(update.update_item().id().value());
+        break;
+
+    case proto::SceneUpdate::kResetAllItems:
+        scene_->reset(update.reset_all_items(), prepared);
+        record_upload("reset " + std::to_string(update.reset_all_items().items_size()) + " items");
+        break;
+
+    case proto::SceneUpdate::kBatch:
+        for (const proto::SceneUpdate& batched_update : update.batch().updates()) {
+            apply_scene_update(batched_update, prepared);
+        }
+        break;
+
+    case proto::SceneUpdate::kTransforms:
+        scene_->update_transforms(update.transforms());
+        profiler_.add_event("transforms", start, Profiler::Clock::now());
+        break;
+
+    case proto::SceneUpdate::kRemoveItem:
+        break;
+
+    case proto::SceneUpdate::UPDATE_NOT_SET:
+        break;
+    }
+}
+
 void VisClient::process_message_update(const proto::Message& message) {
-    messages_.use_safely([&](proto::Messages& messages) { messages.add_messages()->CopyFrom(message); });
+    // Never blocks so network threads can't be held up by the render thread
+    IncomingMessages incoming;
+    *incoming.messages.add_messages() = message;
+    incoming_messages_.push(std::move(incoming));
     reset_draw_counter();
 }
 
-void VisClient::process_scene_update(const proto::SceneUpdate& update) {
-    scene_updates_.use_safely([&](std::vector<proto::SceneUpdate>& updates) { updates.emplace_back(update); });
+void VisClient::process_scene_update(proto::SceneUpdate update) {
+    // Never blocks so network threads can't be held up by the render thread
+    incoming_updates_.push(std::move(update));
     reset_draw_counter();
 }
 
@@ -346,7 +558,7 @@ void VisClient::get_message_state(bool redraw) {
         })) {
 
         // This is only called if the client is connected
-        messages_.use_safely([&](proto::Messages& msgs) { msgs.CopyFrom(messages); });
+        incoming_messages_.push({std::move(messages), true});
     }
 
     if (redraw) {
@@ -365,10 +577,9 @@ void VisClient::get_scene_state(bool redraw) {
         })) {
 
         // This is only called if the client is connected
-        scene_updates_.use_safely([&](std::vector<proto::SceneUpdate>& updates) {
-            updates.emplace_back();
-            updates.back().mutable_reset_all_items()->CopyFrom(scene);
-        });
+        proto::SceneUpdate update;
+        update.mutable_reset_all_items()->Swap(&scene);
+        process_scene_update(std::move(update));
     }
 
     if (redraw) {
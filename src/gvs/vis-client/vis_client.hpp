@@ -22,9 +22,13 @@
 // ///////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
-#include "gvs/util/atomic_data.hpp"
 #include "gvs/util/blocking_queue.hpp"
+#include "gvs/util/lock_free_queue.hpp"
+#include "gvs/util/message_log.hpp"
+#include "gvs/util/ordered_task_pool.hpp"
+#include "gvs/util/scene_update_aggregator.hpp"
 #include "gvs/vis-client/app/imgui_magnum_application.hpp"
+#include "gvs/vis-client/scene/prepared_geometry.hpp"
 
 // generated
 #include <scene.grpc.pb.h>
@@ -46,8 +50,18 @@ private:
 
     void resize(const Magnum::Vector2i& viewport) override;
 
+    void pick(const Ray& world_ray) override;
+
+    /// \brief A window with the recent time of each frame phase that can save a Chrome trace
+    void configure_profiler_gui();
+
+    void apply_scene_update(const proto::SceneUpdate& update, const PreparedGeometries& prepared);
+
+    /// \brief Splits a combined update into tasks for 'scene_updates_' (see 'max_task_bytes')
+    void submit_scene_updates(proto::SceneUpdate combined);
+
     void process_message_update(const proto::Message& message);
-    void process_scene_update(const proto::SceneUpdate& message);
+    void process_scene_update(proto::SceneUpdate update);
 
     void on_state_change();
     void get_message_state(bool redraw = true);
@@ -65,16 +79,33 @@ private:
 
     // Debugging
     bool run_as_fast_as_possible_ = false;
+    bool show_profiler_ = false;
+    std::string trace_filename_ = "gvs_trace.json";
+    std::vector<float> profiler_plot_values_; ///< Reused every frame
 
     // Messages
+    struct IncomingMessages {
+        proto::Messages messages;
+        bool replace_existing = false; ///< Set when all of the server's messages were requested
+    };
+    static constexpr std::size_t max_wrapped_messages = 500;
+
     bool wrap_text_ = false;
-    util::AtomicData<proto::Messages> messages_;
+    util::LockFreeQueue<IncomingMessages> incoming_messages_; ///< Filled by the network threads
+    util::MessageLog message_log_; ///< Only the most recent messages are kept
+    std::string message_filter_;
     std::string message_id_input_;
     std::string message_content_input_;
 
     // Scene
     std::unique_ptr<SceneInterface> scene_; // forward declaration
-    util::AtomicData<std::vector<proto::SceneUpdate>> scene_updates_;
+    std::size_t upload_budget_bytes_ = 64u << 20u; ///< Geometry uploaded per frame (at least one update is applied)
+    util::LockFreeQueue<proto::SceneUpdate> incoming_updates_; ///< Filled by the network threads
+    util::SceneUpdateAggregator pending_updates_; ///< Merges incoming updates on the render thread
+
+    /// Consecutive small updates are prepared in one task until they add up to this many bytes
+    static constexpr std::size_t max_task_bytes = 1u << 20u;
+    util::OrderedTaskPool<PreparedUpdate> scene_updates_; ///< Prepares geometry off the render thread
 };
 
 } // namespace gvs::vis